@@ -0,0 +1,32 @@
+/*
+ * Host build: runs the P1 threads for real, one ucontext per thread (Src/sim_port.c).
+ * It replaces the assembly of osKernelAssembly.s: osSchedulerLaunch starts currentPt, a pended PendSV calls
+ * osScheduler and switches to the new currentPt. Time only passes in sim_port_work/sim_port_tick/sim_port_cycles,
+ * called by the threads for what they compute, and in the idle thread's WFI; every tick is one expired quanta
+ * (SysTick with COUNTFLAG). SysTick->VAL counts the quanta down as DWT->CYCCNT advances, so a write of VAL
+ * (osThreadYield) restarts the quanta as on target.
+ * The thread entry is read back from the PC slot of the initial stack frame: the host programs are linked
+ * without PIE so code addresses fit the 32 bit slot as on target. With OS_STATIC_THREADS the frames of
+ * osStaticKernel.hpp hold typed pointers, read as such.
+ */
+#ifndef HOST_SIM_PORT_H
+#define HOST_SIM_PORT_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void sim_port_on_tick(void (*hook)(uint32_t tick));	// other interrupts of the board, before every SysTick
+void sim_port_tick(void);								// the rest of the quanta of the running thread
+void sim_port_work(uint32_t ticks);						// the running thread computes for ticks quanta
+void sim_port_cycles(uint32_t n);						// the running thread computes for n core cycles
+uint32_t sim_port_now(void);							// ticks since osKernelLaunch
+void sim_port_stop(void);								// osKernelLaunch returns to its caller
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HOST_SIM_PORT_H */
@@ -0,0 +1,25 @@
+/*
+ * Host build: output shared by the P1 host programs (Src/sim_report.c), linked into every one of them.
+ * A program prints check,<name>,<ok|FAIL> with sim_check and returns sim_exit_status() from main:
+ * the exit status is 1 if a check failed.
+ */
+#ifndef HOST_SIM_REPORT_H
+#define HOST_SIM_REPORT_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern int sim_consistent;								// osKernelCheck() held wherever the program looked
+
+void sim_check(const char *name, int ok);
+int sim_exit_status(void);
+uint64_t sim_monotonic_ns(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HOST_SIM_REPORT_H */
@@ -0,0 +1,123 @@
+/*
+ * Host build: register mock of the Cortex-M4 core peripherals used by osKernel.c, and of TIM2 (osTimer.c).
+ * SysTick, SCB, DWT, CoreDebug, TIM2 and RCC are plain structs in RAM, NVIC priorities, enables, pending bits
+ * and PRIMASK are recorded by Src/sim_registers.c.
+ * The simulator (Src/sim_scheduler.c) plays the hardware side: it pends and runs SysTick and PendSV.
+ * When threads really run (Src/sim_port.c), pended exceptions are taken where the core would take them:
+ * at __ISB(), __enable_irq() and __set_PRIMASK(0), through sim_exception_hook.
+ */
+#ifndef HOST_STM32F4XX_H
+#define HOST_STM32F4XX_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define __IO	volatile
+
+typedef enum
+{
+	PendSV_IRQn  = -2,
+	SysTick_IRQn = -1,
+	TIM2_IRQn    = 28
+} IRQn_Type;
+
+typedef struct
+{
+	__IO uint32_t CTRL;
+	__IO uint32_t LOAD;
+	__IO uint32_t VAL;
+	__IO uint32_t CALIB;
+} SysTick_Type;
+
+typedef struct
+{
+	__IO uint32_t CPUID;
+	__IO uint32_t ICSR;
+	__IO uint32_t VTOR;
+} SCB_Type;
+
+typedef struct
+{
+	__IO uint32_t CTRL;
+	__IO uint32_t CYCCNT;
+} DWT_Type;
+
+typedef struct
+{
+	__IO uint32_t DEMCR;
+} CoreDebug_Type;
+
+typedef struct
+{
+	__IO uint32_t CR1;
+	__IO uint32_t CR2;
+	__IO uint32_t SMCR;
+	__IO uint32_t DIER;
+	__IO uint32_t SR;
+	__IO uint32_t EGR;
+	__IO uint32_t CCMR1;
+	__IO uint32_t CCMR2;
+	__IO uint32_t CCER;
+	__IO uint32_t CNT;
+	__IO uint32_t PSC;
+	__IO uint32_t ARR;
+	__IO uint32_t RCR;
+	__IO uint32_t CCR1;
+} TIM_TypeDef;
+
+typedef struct
+{
+	__IO uint32_t AHB1ENR;
+	__IO uint32_t APB1ENR;
+	__IO uint32_t APB2ENR;
+} RCC_TypeDef;
+
+extern SysTick_Type   sim_SysTick;
+extern SCB_Type       sim_SCB;
+extern DWT_Type       sim_DWT;
+extern CoreDebug_Type sim_CoreDebug;
+extern TIM_TypeDef    sim_TIM2;
+extern RCC_TypeDef    sim_RCC;
+
+#define SysTick		(&sim_SysTick)
+#define SCB			(&sim_SCB)
+#define DWT			(&sim_DWT)
+#define CoreDebug	(&sim_CoreDebug)
+#define TIM2		(&sim_TIM2)
+#define RCC			(&sim_RCC)
+
+#define DWT_CTRL_CYCCNTENA_Msk			(1UL << 0)
+#define CoreDebug_DEMCR_TRCENA_Msk		(1UL << 24)
+
+#define SCB_ICSR_PENDSVSET_Msk	(1UL << 28)
+#define SCB_ICSR_PENDSTSET_Msk	(1UL << 26)
+
+void NVIC_SetPriority(IRQn_Type IRQn, uint32_t priority);
+uint32_t NVIC_GetPriority(IRQn_Type IRQn);
+void NVIC_EnableIRQ(IRQn_Type IRQn);
+uint32_t NVIC_GetEnableIRQ(IRQn_Type IRQn);
+void NVIC_SetPendingIRQ(IRQn_Type IRQn);
+uint32_t NVIC_GetPendingIRQ(IRQn_Type IRQn);
+void NVIC_ClearPendingIRQ(IRQn_Type IRQn);
+void __disable_irq(void);
+void __enable_irq(void);
+uint32_t __get_PRIMASK(void);
+void __set_PRIMASK(uint32_t mask);
+void __DSB(void);
+void __ISB(void);
+void __WFI(void);
+uint32_t sim_irq_disabled(void);
+uint32_t sim_irq_disable_count(void);
+
+extern void (*sim_exception_hook)(void);	// takes the pended SysTick/PendSV, NULL: they stay pended in SCB->ICSR
+extern void (*sim_wfi_hook)(void);			// time passes until the next interrupt, NULL: __WFI returns at once
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HOST_STM32F4XX_H */
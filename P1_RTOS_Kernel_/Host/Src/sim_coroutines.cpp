@@ -0,0 +1,220 @@
+/*
+ * *** Purpose:
+ * Show what osCoroutine.hpp costs against kernel threads: RAM per logical sensor loop and time per switch.
+ *
+ * *** How it works
+ * Parts 1 to 3 call the kernel (osKernel.c) on the mock registers like sim_scheduler.c, the simulator plays SysTick.
+ * 1. SIM_SENSORS sensor loops run as coroutines of one scheduler, as they would in one kernel thread. Every loop
+ *    waits its period (1 to 4 ticks), waits for the sample ready signal and filters the sample.
+ *    After SIM_TICKS ticks every loop must have run once per period (check,sensor_loops).
+ * 2. RAM: arena bytes per loop (frame incl. promise) against one thread (TCB_STACK row + tcb).
+ * 3. Switch: two coroutines that only co_await yield(), against the kernel tick (SysTick_Handler + osScheduler).
+ *    The kernel figure leaves out the register save/restore of PendSV_Handler and the exception entry/exit,
+ *    which only exist on target: it is a lower bound of a full context switch.
+ * 4. run: the kernel launches on the host port (Src/sim_port.c). Thread 0 is CoScheduler::run() with one coroutine
+ *    that waits SIM_RUN_DELAYS delays of SIM_RUN_TICKS, threads 1 and 2 wait for a notification that never comes.
+ *    Ticks only come from the idle thread's WFI: run() must let the idle thread run while nothing is ready, the
+ *    delays then end on time (check,run_delays). A run() spinning without a tick is stopped after SIM_RUN_TIMEOUT_S.
+ *
+ * *** Output
+ * check,<name>,<ok|FAIL>
+ * ram,<loops>,<arena_bytes>,<bytes_per_loop>,<thread_bytes>,<loops_per_thread_ram>
+ * benchmark,<name>,<calls>,<total_ns>,<per_call_ns>
+ */
+
+#include <cstdio>
+#include <cstdint>
+#include <csignal>
+#include <unistd.h>
+#include "osKernel.h"
+#include "sim_report.h"
+#include "sim_port.h"
+
+#define OS_CO_ARENA_BYTES	8192				// frames hold 64 bit pointers on the host, they are smaller on target
+#include "osCoroutine.hpp"
+
+/* Define macros */
+#define SIM_SENSORS			60
+#define SIM_TICKS			1200				// multiple of every period
+#define SIM_SWITCHES		10000000
+#define SIM_QUANTA			10
+#define SIM_RUN_DELAYS		5
+#define SIM_RUN_TICKS		3
+#define SIM_RUN_TIMEOUT_S	10
+
+/* Kernel functions without a prototype in osKernel.h (called from assembly or by the hardware) */
+extern "C" void osScheduler(void);
+extern "C" void SysTick_Handler(void);
+
+/* Declare private functions */
+static os::CoTask sensorLoop(uint32_t channel, uint32_t period);
+static os::CoTask switcher(uint32_t count);
+static os::CoTask runDelays(void);
+static void sim_runner(void);
+static void sim_waiter(void);
+static void sim_run_timeout(int signal_number);
+static void sim_tick(void);
+static void sim_thread(void) {}
+
+/* Declare private variables */
+static os::CoScheduler sensors;
+static os::CoScheduler switchers;
+static os::CoScheduler runner;
+static os::CoSignal sampleReady;
+static uint32_t iterations[SIM_SENSORS];
+static uint32_t filtered[SIM_SENSORS];
+static uint32_t sample;
+static volatile uint32_t switches;
+static uint32_t run_start;
+static uint32_t run_ticks[SIM_RUN_DELAYS];
+
+
+int main(void)
+{
+	bool ok = true;
+
+	osKernelInit();
+	osKernelAddThreads(sim_thread, sim_thread, sim_thread);	// currentPt for the kernel calls, not launched
+
+	/* sensor loops in one thread */
+	for(uint32_t i = 0; i < SIM_SENSORS; i++)
+	{
+		ok &= sensors.spawn(sensorLoop(i, 1 + i % 4)) == 1;
+	}
+	sim_check("spawn", ok && sensors.count() == SIM_SENSORS);
+
+	sensors.runOnce();										// every loop starts and waits its first period
+	for(uint32_t t = 0; t < SIM_TICKS; t++)
+	{
+		sim_tick();
+		while(sensors.runOnce() != 0)						// loops due on this tick now wait for the sample
+		{
+		}
+		sample = (sample + 37) % 4096;						// the sampling side: new value, then the signal
+		sampleReady.notify();
+		while(sensors.runOnce() != 0)
+		{
+		}
+	}
+
+	ok = true;
+	for(uint32_t i = 0; i < SIM_SENSORS; i++)
+	{
+		ok &= iterations[i] == SIM_TICKS / (1 + i % 4);
+	}
+	sim_check("sensor_loops", ok);
+
+	std::size_t thread_bytes = STACKSIZE * sizeof(int32_t) + sizeof(tcbType);
+	std::size_t per_loop = os::coArena.used() / SIM_SENSORS;
+	std::printf("ram,%u,%zu,%zu,%zu,%zu\n", SIM_SENSORS, os::coArena.used(), per_loop, thread_bytes, thread_bytes / per_loop);
+
+	/* switch cost */
+	std::size_t sensor_frames = os::coArena.used();
+	switchers.spawn(switcher(SIM_SWITCHES / 2));
+	switchers.spawn(switcher(SIM_SWITCHES / 2));
+	std::size_t arena_before = os::coArena.used();
+	std::size_t switcher_frames = arena_before - sensor_frames;
+	uint64_t start = sim_monotonic_ns();
+	while(switchers.count() != 0)
+	{
+		switchers.runOnce();
+	}
+	uint64_t total = sim_monotonic_ns() - start;
+	std::printf("benchmark,coroutine_switch,%u,%llu,%.2f\n", (unsigned)switches, (unsigned long long)total, (double)total / switches);
+	sim_check("switches", switches == SIM_SWITCHES);
+	sim_check("frames_released", os::coArena.used() == arena_before - switcher_frames);
+
+	start = sim_monotonic_ns();
+	for(uint32_t i = 0; i < SIM_SWITCHES; i++)
+	{
+		SysTick_Handler();
+		SCB->ICSR = 0;
+		osScheduler();										// PendSV without the register save/restore
+	}
+	total = sim_monotonic_ns() - start;
+	std::printf("benchmark,kernel_tick_without_context,%u,%llu,%.2f\n", SIM_SWITCHES, (unsigned long long)total, (double)total / SIM_SWITCHES);
+
+	/* run() with every other thread waiting */
+	std::signal(SIGALRM, sim_run_timeout);
+	alarm(SIM_RUN_TIMEOUT_S);
+	osKernelInit();
+	osKernelAddThreads(sim_runner, sim_waiter, sim_waiter);
+	osKernelLaunch(SIM_QUANTA);
+	alarm(0);
+
+	ok = true;
+	for(uint32_t i = 0; i < SIM_RUN_DELAYS; i++)
+	{
+		ok &= run_ticks[i] - run_start == (i + 1) * SIM_RUN_TICKS;
+	}
+	sim_check("run_delays", ok && tcbs[1].state == OS_THREAD_WAITING && tcbs[2].state == OS_THREAD_WAITING);
+
+	return sim_exit_status();
+}
+
+/*** coroutines */
+
+static os::CoTask sensorLoop(uint32_t channel, uint32_t period)
+{
+	while(1)
+	{
+		co_await sensors.delay(period);
+		co_await sampleReady.wait(sensors);
+		filtered[channel] = (filtered[channel] * 7 + sample) / 8;
+		iterations[channel]++;
+	}
+}
+
+static os::CoTask switcher(uint32_t count)
+{
+	for(uint32_t i = 0; i < count; i++)
+	{
+		switches = switches + 1;
+		co_await switchers.yield();
+	}
+}
+
+static os::CoTask runDelays(void)
+{
+	run_start = osKernelGetTick();
+	for(uint32_t i = 0; i < SIM_RUN_DELAYS; i++)
+	{
+		co_await runner.delay(SIM_RUN_TICKS);
+		run_ticks[i] = osKernelGetTick();
+	}
+	sim_port_stop();
+}
+
+/*** threads */
+
+static void sim_runner(void)
+{
+	runner.spawn(runDelays());
+	runner.run();
+}
+
+static void sim_waiter(void)
+{
+	osThreadNotifyWait(1, OS_WAIT_FOREVER);
+}
+
+/*** hardware side */
+
+static void sim_tick(void)
+{
+	SysTick->CTRL = SysTick->CTRL | (1U<<16);				// COUNTFLAG: the quanta expired
+	SysTick_Handler();
+	SysTick->CTRL = SysTick->CTRL & ~(1U<<16);
+	SCB->ICSR = 0;
+	osScheduler();
+}
+
+/*** output */
+
+static void sim_run_timeout(int signal_number)
+{
+	(void)signal_number;
+	std::printf("check,run_delays,FAIL\n");
+	std::fflush(stdout);
+	_exit(1);
+}
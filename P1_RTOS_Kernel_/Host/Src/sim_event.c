@@ -0,0 +1,283 @@
+/*
+ * *** Purpose:
+ * Check the event flag groups (osEvent.c) with real threads on the host port (Src/sim_port.c), and compare a control
+ * thread that waits for the flags of several sensors with one that polls their globals every quanta.
+ *
+ * *** How it works
+ * 1. Checks (thread 0 runs them, threads 1 and 2 wait on the group when told to):
+ *    - no_wait: timeout 0 returns the flags that match (ANY) or nothing (ALL with a flag missing), clears on request.
+ *    - timeout: a wait for a flag nobody sets returns 0 after its timeout quanta.
+ *    - one_pass: thread 1 waits ANY of X, thread 2 waits ALL of X and Y, Y is set already. One osEventSetFromISR(X)
+ *      from the tick (an interrupt) wakes both, each sees its flags, and X and Y are cleared after both.
+ *    osKernelCheck() must hold at every tick and after every step.
+ * 2. Sensors: thread 1 has new data every SIM_PERIOD_A ticks, thread 2 every SIM_PERIOD_B ticks, an interrupt
+ *    (the tick) every SIM_PERIOD_C ticks. The control thread (thread 0) handles every new value, for SIM_TICKS ticks:
+ *    - events: it waits with osEventWait(ANY, clear) at priority 1, the sensors set their flag.
+ *    - polling: it checks three globals and yields, at priority 0 like the sensors.
+ *    Reported: how often the control thread ran, how often for nothing, the values handled (a polled global set
+ *    twice before the check loses one) and the ticks from new data to handling.
+ *
+ * *** Output
+ * check,<name>,<ok|FAIL>
+ * dispatch,<events|polling>,<ticks>,<produced>,<handled>,<control_runs>,<useless_runs>,<avg_latency_ticks>
+ */
+
+#include  <stdio.h>
+#include  <stdint.h>
+#include  "osKernel.h"
+#include  "sim_report.h"
+#include  "osEvent.h"
+#include  "sim_port.h"
+
+/* Define macros */
+#define SIM_QUANTA			1
+#define SIM_TIMEOUT			3
+#define SIM_TICKS			3000
+#define SIM_PERIOD_A		2
+#define SIM_PERIOD_B		3
+#define SIM_PERIOD_C		5
+#define SIM_X				(1U<<0)				// check flags
+#define SIM_Y				(1U<<1)
+#define SIM_SENSORS			3					// sensor flags: 1 << sensor
+#define SIM_ALL_SENSORS		((1U<<SIM_SENSORS) - 1)
+#define SIM_GO				(1U<<0)				// notification bits
+#define SIM_DONE			(1U<<1)
+
+/* Declare private functions */
+static void sim_checker(void);
+static void sim_waiter(void);
+static void sim_control(void);
+static void sim_sensor_a(void);
+static void sim_sensor_b(void);
+static void sim_produce(uint32_t sensor);
+static void sim_handle(uint32_t flags);
+static void sim_scenario(const char *name, uint8_t use_events);
+static void sim_observe(uint32_t tick);
+
+/* Declare private variables */
+static osEventType event;
+static uint8_t sensors_running;
+static uint8_t events_mode;
+static volatile uint32_t isr_set;
+static uint32_t isr_sets;
+static uint32_t results[2];
+static uint32_t woken_tick[2];
+static volatile uint32_t new_data[SIM_SENSORS];	// polling mode
+static uint32_t data_tick[SIM_SENSORS];
+static uint32_t produced;
+static uint32_t handled;
+static uint32_t control_runs;
+static uint32_t useless_runs;
+static uint64_t latency_sum;
+
+
+int main(void)
+{
+	osKernelInit();
+	osKernelAddThreads(sim_checker, sim_waiter, sim_waiter);
+	osEventInit(&event);
+	sim_port_on_tick(sim_observe);
+	osKernelLaunch(SIM_QUANTA);
+
+	sim_scenario("events", 1);
+	sim_check("events_no_polling", useless_runs == 0 && handled == produced);
+	sim_scenario("polling", 0);
+
+	sim_check("consistent", sim_consistent);
+
+	return sim_exit_status();
+}
+
+/*** checks */
+
+static void sim_checker(void)
+{
+	uint32_t start, elapsed, bits;
+	int ok;
+
+	/* no_wait */
+	osEventSet(&event, SIM_X);
+	ok = osEventWait(&event, SIM_X | SIM_Y, OS_EVENT_ANY, 0, 0) == SIM_X;
+	ok &= osEventWait(&event, SIM_X | SIM_Y, OS_EVENT_ALL, 1, 0) == 0 && osEventGet(&event) == SIM_X;
+	ok &= osEventWait(&event, SIM_X, OS_EVENT_ALL, 1, 0) == SIM_X && osEventGet(&event) == 0;
+	sim_check("no_wait", ok && osKernelCheck());
+
+	/* timeout */
+	start = sim_port_now();
+	ok = osEventWait(&event, SIM_Y, OS_EVENT_ANY, 1, SIM_TIMEOUT) == 0;
+	elapsed = sim_port_now() - start;
+	sim_check("timeout", ok && elapsed == SIM_TIMEOUT && event.waiters == NULL && osKernelCheck());
+
+	/* one_pass */
+	osEventSet(&event, SIM_Y);
+	osThreadSetPriority(1, 1);
+	osThreadSetPriority(2, 1);
+	osThreadNotify(1, SIM_GO);					// both run at once and wait
+	osThreadNotify(2, SIM_GO);
+	isr_set = 1;
+	bits = 0;
+	while(bits != (SIM_GO | SIM_DONE))			// SIM_GO here means: thread 2 is done
+	{
+		bits |= osThreadNotifyWait(SIM_GO | SIM_DONE, OS_WAIT_FOREVER);
+	}
+	ok = isr_sets == 1 && results[0] == SIM_X && results[1] == (SIM_X | SIM_Y);
+	ok &= woken_tick[0] == woken_tick[1] && osEventGet(&event) == 0 && event.waiters == NULL;
+	osThreadSetPriority(1, 0);
+	osThreadSetPriority(2, 0);
+	sim_check("one_pass", ok && osKernelCheck());
+
+	sim_port_stop();
+}
+
+static void sim_waiter(void)
+{
+	uint32_t index = osThreadGetId() - 1;
+
+	osThreadNotifyWait(SIM_GO, OS_WAIT_FOREVER);
+	if(index == 0)
+	{
+		results[0] = osEventWait(&event, SIM_X, OS_EVENT_ANY, 1, OS_WAIT_FOREVER);
+	}
+	else
+	{
+		results[1] = osEventWait(&event, SIM_X | SIM_Y, OS_EVENT_ALL, 1, OS_WAIT_FOREVER);
+	}
+	woken_tick[index] = sim_port_now();
+	osThreadNotify(0, index == 0 ? SIM_DONE : SIM_GO);
+	while(1)
+	{
+		osThreadNotifyWait(0, OS_WAIT_FOREVER);
+	}
+}
+
+/*** sensors and control */
+
+static void sim_scenario(const char *name, uint8_t use_events)
+{
+	events_mode = use_events;
+	produced = handled = control_runs = useless_runs = 0;
+	latency_sum = 0;
+	for(int i = 0; i < SIM_SENSORS; i++)
+	{
+		new_data[i] = 0;
+	}
+	osEventInit(&event);
+
+	osKernelAddThreads(sim_control, sim_sensor_a, sim_sensor_b);
+	if(use_events)
+	{
+		osThreadSetPriority(0, 1);
+	}
+	sensors_running = 1;
+	osKernelLaunch(SIM_QUANTA);
+	sensors_running = 0;
+
+	printf("dispatch,%s,%u,%u,%u,%u,%u,%.3f\n", name, SIM_TICKS, produced, handled, control_runs, useless_runs,
+		   handled ? (double)latency_sum / handled : 0.0);
+}
+
+static void sim_control(void)
+{
+	uint32_t flags;
+
+	while(1)
+	{
+		if(events_mode)
+		{
+			flags = osEventWait(&event, SIM_ALL_SENSORS, OS_EVENT_ANY, 1, OS_WAIT_FOREVER);
+		}
+		else
+		{
+			flags = 0;
+			for(int i = 0; i < SIM_SENSORS; i++)
+			{
+				if(new_data[i])
+				{
+					new_data[i] = 0;
+					flags |= 1U << i;
+				}
+			}
+		}
+		control_runs++;
+		if(flags == 0)
+		{
+			useless_runs++;
+		}
+		sim_handle(flags);
+		if(!events_mode)
+		{
+			osThreadYield();					// the rest of the quanta to the sensors
+		}
+	}
+}
+
+static void sim_sensor_a(void)
+{
+	while(1)
+	{
+		sim_port_work(SIM_PERIOD_A);
+		sim_produce(0);
+		if(sim_port_now() >= SIM_TICKS)
+		{
+			sim_port_stop();
+		}
+	}
+}
+
+static void sim_sensor_b(void)
+{
+	while(1)
+	{
+		sim_port_work(SIM_PERIOD_B);
+		sim_produce(1);
+	}
+}
+
+/* New data of a sensor: its flag, or its global when polled. Thread or interrupt. */
+static void sim_produce(uint32_t sensor)
+{
+	produced++;
+	data_tick[sensor] = sim_port_now();
+	if(!events_mode)
+	{
+		new_data[sensor] = 1;
+	}
+	else if(sensor == 2)
+	{
+		osEventSetFromISR(&event, 1U << sensor);
+	}
+	else
+	{
+		osEventSet(&event, 1U << sensor);
+	}
+}
+
+static void sim_handle(uint32_t flags)
+{
+	for(int i = 0; i < SIM_SENSORS; i++)
+	{
+		if(flags & (1U << i))
+		{
+			handled++;
+			latency_sum += sim_port_now() - data_tick[i];
+		}
+	}
+}
+
+/*** hardware side */
+
+/* The tick is the interrupt of sensor C, and of the one_pass check */
+static void sim_observe(uint32_t tick)
+{
+	if(isr_set)
+	{
+		isr_set = 0;
+		isr_sets++;
+		osEventSetFromISR(&event, SIM_X);
+	}
+	if(sensors_running && tick % SIM_PERIOD_C == 0)
+	{
+		sim_produce(2);
+	}
+	sim_consistent &= osKernelCheck();
+}
@@ -0,0 +1,134 @@
+/*
+ * *** Purpose:
+ * Check the kernel idle thread (osKernel.c) on the host port (Src/sim_port.c): it must run only when no thread is
+ * ready, sleep in WFI, and its idle cycles must give the right CPU load (osKernelCpuLoad).
+ *
+ * *** How it works
+ * The three threads compute a few ticks and then sleep with osThreadNotifyWait(0, ticks), so the CPU is idle
+ * part of the time. WFI lets one tick pass, the tick hook is the observer:
+ * 1. idle_only: whenever the idle thread holds the CPU, no thread is ready.
+ * 2. idle_hook: osIdleHook (defined here) runs once per WFI.
+ * 3. cpu_load: osKernelCpuLoad over SIM_TICKS ticks against the busy ticks counted by the hook.
+ * osKernelCheck() must hold at every tick.
+ *
+ * *** Output
+ * check,<name>,<ok|FAIL>
+ * load,<ticks>,<busy_ticks>,<expected_permille>,<measured_permille>
+ */
+
+#include  <stdio.h>
+#include  <stdint.h>
+#include  "osKernel.h"
+#include  "sim_port.h"
+#include  "sim_report.h"
+
+/* Define macros */
+#define SIM_QUANTA			1
+#define SIM_TICKS			1200
+#define SIM_SLEEP			0					// notification mask that never matches: the wait is a sleep
+
+/* Declare private functions */
+static void sim_task0(void);
+static void sim_task1(void);
+static void sim_task2(void);
+static void sim_observe(uint32_t tick);
+
+/* Declare private variables */
+static volatile uint32_t measuring;
+static uint32_t ticks;
+static uint32_t busy_ticks;
+static uint32_t idle_ticks;
+static uint32_t hook_calls;
+static uint32_t measured;
+static int idle_only = 1;
+
+
+int main(void)
+{
+	uint32_t expected;
+
+	osKernelInit();
+	osKernelAddThreads(sim_task0, sim_task1, sim_task2);
+	sim_port_on_tick(sim_observe);
+	osKernelLaunch(SIM_QUANTA);
+
+	expected = (uint32_t)((uint64_t)busy_ticks * 1000 / ticks);
+	printf("load,%u,%u,%u,%u\n", ticks, busy_ticks, expected, measured);
+	sim_check("idle_only", idle_only && idle_ticks > 0);
+	sim_check("idle_hook", hook_calls == idle_ticks);
+	sim_check("cpu_load", measured >= expected && measured <= expected + 1);	// per mille, rounded up by osKernelCpuLoad
+	sim_check("consistent", sim_consistent);
+
+	return sim_exit_status();
+}
+
+/* Replaces the weak default of the kernel */
+void osIdleHook(void)
+{
+	if(measuring)
+	{
+		hook_calls++;
+	}
+}
+
+/*** threads */
+
+static void sim_task0(void)
+{
+	osKernelCpuLoad();							// start of the window
+	measuring = 1;
+	while(1)
+	{
+		sim_port_work(1);
+		osThreadNotifyWait(SIM_SLEEP, 4);
+	}
+}
+
+static void sim_task1(void)
+{
+	while(1)
+	{
+		sim_port_work(1);
+		osThreadNotifyWait(SIM_SLEEP, 6);
+	}
+}
+
+static void sim_task2(void)
+{
+	while(1)
+	{
+		sim_port_work(2);
+		if(ticks >= SIM_TICKS)
+		{
+			measuring = 0;
+			measured = osKernelCpuLoad();
+			sim_port_stop();
+		}
+		osThreadNotifyWait(SIM_SLEEP, 10);
+	}
+}
+
+/*** hardware side */
+
+/* The tick belongs to the thread that holds the CPU when it ends */
+static void sim_observe(uint32_t tick)
+{
+	if(!measuring)
+	{
+		return;
+	}
+	ticks++;
+	if(currentPt == &tcbs[OS_IDLE_THREAD])
+	{
+		idle_ticks++;
+		for(int i = 0; i < NUM_OF_THREADS; i++)
+		{
+			idle_only &= tcbs[i].state != OS_THREAD_READY;
+		}
+	}
+	else
+	{
+		busy_ticks++;
+	}
+	sim_consistent &= osKernelCheck();
+}
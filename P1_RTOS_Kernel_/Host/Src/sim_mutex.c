@@ -0,0 +1,263 @@
+/*
+ * *** Purpose:
+ * Show that a kernel mutex (osMutex.h) bounds how long the pump control thread waits for the UART held by the
+ * low priority logger, and what an uncontended lock/unlock costs.
+ *
+ * *** How it works
+ * The threads run for real on the host port (Src/sim_port.c), time passes as they compute (sim_port_work).
+ * Threads released later are parked at priority 0 below the logger and get their priority at their release tick.
+ * 1. inversion: logger (priority 1) holds the UART for SIM_LOGGER_HOLD ticks. At tick 2 the pump (3) asks for it,
+ *    at tick 3 a busy thread (2) starts SIM_BUSY_TICKS ticks of work that never blocks.
+ *    With priority inheritance the logger runs at 3 and the pump waits at most SIM_LOGGER_HOLD ticks (bounded).
+ *    Built with OS_MUTEX_PRIORITY_INHERITANCE=0 (make mutex runs both) the busy thread runs first (unbounded).
+ * 2. handover: logger holds the UART, then a priority 2 and a priority 3 thread block on it, in that order.
+ *    The logger inherits 3 (stays 1 without inheritance), the priority 3 thread gets the UART first,
+ *    every priority drops back after unlock.
+ * 3. uncontended: SIM_CALLS lock/unlock pairs by one thread must not disable interrupts or pend SysTick/PendSV.
+ * osKernelCheck() must hold at every step of the scenarios.
+ *
+ * *** Output
+ * check,<name>,<ok|FAIL>
+ * scenario,<inheritance|no_inheritance>,<pump_blocked_ticks>,<bound_ticks>
+ * benchmark,<name>,<calls>,<total_ns>,<per_call_ns>
+ */
+
+#include  <stdio.h>
+#include  <stdint.h>
+#include  "osKernel.h"
+#include  "sim_report.h"
+#include  "osMutex.h"
+#include  "sim_port.h"
+
+/* Define macros */
+#define SIM_QUANTA			1
+#define SIM_LOGGER_HOLD		4
+#define SIM_BUSY_TICKS		50
+#define SIM_CALLS			10000000
+
+#define LOGGER				0					// thread numbers, the logger runs first
+#define MEDIUM				1
+#define HIGH				2
+
+/* Declare private functions */
+static void inversion_logger(void);
+static void inversion_busy(void);
+static void inversion_pump(void);
+static void inversion_release(uint32_t tick);
+static void handover_logger(void);
+static void handover_medium(void);
+static void handover_high(void);
+static void handover_release(uint32_t tick);
+static void sim_parked(void);
+
+/* Declare private variables */
+static osMutexType uart;
+static volatile uint32_t released[NUM_OF_THREADS];
+static uint32_t busy_done;
+static uint32_t pump_blocked;
+static uint32_t busy_before_pump;
+static uint32_t order[NUM_OF_THREADS];
+static uint32_t order_count;
+static int scenario_ok;
+
+
+int main(void)
+{
+	uint64_t start, total;
+	uint32_t disables;
+	int ok;
+
+	osKernelInit();
+
+	/* uncontended: no kernel entry */
+	osKernelAddThreads(sim_parked, sim_parked, sim_parked);
+	osMutexInit(&uart);
+	disables = sim_irq_disable_count();
+	SCB->ICSR = 0;
+	start = sim_monotonic_ns();
+	for(uint32_t i = 0; i < SIM_CALLS; i++)
+	{
+		osMutexLock(&uart);
+		osMutexUnlock(&uart);
+	}
+	total = sim_monotonic_ns() - start;
+	printf("benchmark,mutex_lock_unlock_uncontended,%u,%llu,%.2f\n", SIM_CALLS, (unsigned long long)total, (double)total / SIM_CALLS);
+	ok = sim_irq_disable_count() == disables;
+	ok &= SCB->ICSR == 0;
+	ok &= uart.owner == 0 && currentPt->held == NULL;
+	sim_check("uncontended_no_kernel_entry", ok);
+
+	/* inversion */
+	osKernelAddThreads(inversion_logger, inversion_busy, inversion_pump);
+	osThreadSetPriority(LOGGER, 1);
+	osMutexInit(&uart);
+	scenario_ok = osKernelCheck();
+	sim_port_on_tick(inversion_release);
+	osKernelLaunch(SIM_QUANTA);
+
+	printf("scenario,%s,%u,%u\n", OS_MUTEX_PRIORITY_INHERITANCE ? "inheritance" : "no_inheritance", pump_blocked, SIM_LOGGER_HOLD);
+	sim_check("inversion_consistent", scenario_ok);
+#if OS_MUTEX_PRIORITY_INHERITANCE
+	sim_check("inversion_bounded", pump_blocked <= SIM_LOGGER_HOLD && busy_before_pump == 0);
+	sim_check("inversion_priority_restored", tcbs[LOGGER].priority == 1);
+#else
+	sim_check("inversion_unbounded", pump_blocked > SIM_BUSY_TICKS && busy_before_pump == 1);
+#endif
+
+	/* handover */
+	osKernelAddThreads(handover_logger, handover_medium, handover_high);
+	osThreadSetPriority(LOGGER, 1);
+	osMutexInit(&uart);
+	for(int i = 0; i < NUM_OF_THREADS; i++)
+	{
+		released[i] = 0;
+	}
+	scenario_ok = osKernelCheck();
+	sim_port_on_tick(handover_release);
+	osKernelLaunch(SIM_QUANTA);
+
+	ok = scenario_ok && order_count == 3;
+	ok &= order[0] == LOGGER && order[1] == HIGH && order[2] == MEDIUM;
+	for(int i = 0; i < NUM_OF_THREADS; i++)
+	{
+		ok &= tcbs[i].priority == tcbs[i].basePriority && tcbs[i].held == NULL;
+	}
+	ok &= uart.owner == 0 && uart.waiters == NULL;
+	ok &= osKernelCheck();
+	sim_check("handover", ok);
+
+	return sim_exit_status();
+}
+
+/*** scenario 1: inversion */
+
+static void inversion_logger(void)
+{
+	while(1)
+	{
+		osMutexLock(&uart);
+		sim_port_work(SIM_LOGGER_HOLD);			// prints a log line
+		osMutexUnlock(&uart);
+		scenario_ok &= osKernelCheck();
+		sim_port_work(1);
+	}
+}
+
+static void inversion_busy(void)
+{
+	while(!released[MEDIUM])
+	{
+		osThreadYield();
+	}
+	sim_port_work(SIM_BUSY_TICKS);
+	busy_done = 1;
+	osThreadSetPriority(MEDIUM, 0);				// done, parked again
+	while(1)
+	{
+		osThreadYield();
+	}
+}
+
+static void inversion_pump(void)
+{
+	uint32_t start;
+
+	while(!released[HIGH])
+	{
+		osThreadYield();
+	}
+	start = sim_port_now();
+	osMutexLock(&uart);
+	pump_blocked = sim_port_now() - start;
+	busy_before_pump = busy_done;
+	scenario_ok &= osKernelCheck();
+	sim_port_work(1);							// sends the pump status
+	osMutexUnlock(&uart);
+	sim_port_stop();
+}
+
+/* The events that start the pump (tick 2) and the busy thread (tick 3) */
+static void inversion_release(uint32_t tick)
+{
+	if(tick == 2)
+	{
+		released[HIGH] = 1;
+		osThreadSetPriority(HIGH, 3);
+	}
+	if(tick == 3)
+	{
+		released[MEDIUM] = 1;
+		osThreadSetPriority(MEDIUM, 2);
+	}
+}
+
+/*** scenario 2: handover */
+
+static void handover_logger(void)
+{
+	osMutexLock(&uart);
+	order[order_count++] = LOGGER;
+	sim_port_work(SIM_LOGGER_HOLD);				// the medium (tick 1) and the high thread (tick 2) block meanwhile
+	scenario_ok &= tcbs[LOGGER].priority == (OS_MUTEX_PRIORITY_INHERITANCE ? 3 : 1) && uart.waiters == &tcbs[HIGH] && tcbs[HIGH].nextWaiter == &tcbs[MEDIUM];
+	osMutexUnlock(&uart);
+	while(1)
+	{
+		if(order_count == 3)
+		{
+			sim_port_stop();
+		}
+		sim_port_work(1);
+	}
+}
+
+static void handover_medium(void)
+{
+	while(!released[MEDIUM])
+	{
+		osThreadYield();
+	}
+	osMutexLock(&uart);
+	order[order_count++] = MEDIUM;
+	osMutexUnlock(&uart);
+	scenario_ok &= osKernelCheck();
+	osThreadSetPriority(MEDIUM, 0);				// parked again so the logger can finish
+	while(1)
+	{
+		osThreadYield();
+	}
+}
+
+static void handover_high(void)
+{
+	while(!released[HIGH])
+	{
+		osThreadYield();
+	}
+	osMutexLock(&uart);
+	order[order_count++] = HIGH;
+	osMutexUnlock(&uart);
+	scenario_ok &= osKernelCheck() && tcbs[LOGGER].priority == 1;
+	osThreadSetPriority(HIGH, 0);
+	while(1)
+	{
+		osThreadYield();
+	}
+}
+
+static void handover_release(uint32_t tick)
+{
+	if(tick == 1)
+	{
+		released[MEDIUM] = 1;
+		osThreadSetPriority(MEDIUM, 2);
+	}
+	if(tick == 2)
+	{
+		released[HIGH] = 1;
+		osThreadSetPriority(HIGH, 3);
+	}
+}
+
+static void sim_parked(void)
+{
+}
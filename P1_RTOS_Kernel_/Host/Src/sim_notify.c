@@ -0,0 +1,188 @@
+/*
+ * *** Purpose:
+ * Check the thread notifications of osKernel.c (osThreadNotify, osThreadNotifyFromISR, osThreadNotifyWait) with
+ * real threads on the host port (Src/sim_port.c), and measure the path from an interrupt to the woken thread.
+ *
+ * *** How it works
+ * task0 (priority 1) waits for the ADC like in main.c (ADC_NOTIFY 1), task1 and task2 (priority 0) compute.
+ * The simulated ADC end of conversion interrupt runs on the tick hook every SIM_ADC_PERIOD ticks.
+ * 1. isr_wake: every sample reaches task0 in the tick of its interrupt, before task1/task2 run again.
+ * 2. timeout: a wait without notification returns 0 after its timeout quanta, the others run meanwhile.
+ * 3. yield_timeout: the same while task1 and task2 compute a quarter quanta and yield, back to back like main.c.
+ *    osThreadYield restarts the quanta, the cycles it cut off must still add up to the ticks of the timeout.
+ * 4. pending_bits: bits sent before the wait are kept, the wait takes only the bits of its mask.
+ * 5. latency: SIM_SAMPLES interrupts, host time from the handler entry to task0 running (the target figure in
+ *    cycles comes from main.c, ADC_LATENCY_BENCHMARK 1).
+ * osKernelCheck() must hold in every thread.
+ *
+ * *** Output
+ * check,<name>,<ok|FAIL>
+ * latency,<samples>,<avg_ns>,<max_ns>
+ * benchmark,<name>,<calls>,<total_ns>,<per_call_ns>
+ */
+
+#include  <stdio.h>
+#include  <stdint.h>
+#include  "osKernel.h"
+#include  "sim_port.h"
+#include  "sim_report.h"
+
+/* Define macros */
+#define SIM_QUANTA			1
+#define SIM_ADC_PERIOD		3
+#define SIM_SAMPLES			100000
+#define SIM_TIMEOUT			5
+#define SIM_CALLS			10000000
+#define SIM_YIELD_PARTS		4					// yield_timeout: a yield every quarter quanta
+#define SIM_YIELD_LIMIT		(SIM_TIMEOUT * SIM_YIELD_PARTS * 10)	// yields before the run ends, time stands still
+
+#define ADC_SAMPLE_READY	(1U<<0)
+#define SIM_OTHER_BIT		(1U<<1)
+#define TASK0				0
+
+/* Declare private functions */
+static void sim_task0(void);
+static void sim_task1(void);
+static void sim_task2(void);
+static void sim_compute(void);
+static void sim_adc_isr(uint32_t tick);
+
+/* Declare private variables */
+static volatile uint32_t adc_sample;
+static volatile uint32_t adc_isr_count;
+static uint64_t adc_isr_ns;
+static uint64_t latency_sum;
+static uint64_t latency_max;
+static uint32_t samples;
+static uint32_t others_count;
+static int wake_ok = 1;
+static int timeout_ok;
+static int yield_ok;
+static volatile uint32_t yielding;
+static uint32_t yields;
+static int pending_ok;
+
+
+int main(void)
+{
+	uint64_t start, total;
+	uint32_t i;
+
+	osKernelInit();
+
+	/* notify and wait without switch: the bits are already there */
+	osKernelAddThreads(sim_task0, sim_task1, sim_task2);
+	start = sim_monotonic_ns();
+	for(i = 0; i < SIM_CALLS; i++)
+	{
+		osThreadNotify(TASK0, ADC_SAMPLE_READY);
+		osThreadNotifyWait(ADC_SAMPLE_READY, 0);
+	}
+	total = sim_monotonic_ns() - start;
+	printf("benchmark,notify_and_take,%u,%llu,%.2f\n", SIM_CALLS, (unsigned long long)total, (double)total / SIM_CALLS);
+
+	osKernelAddThreads(sim_task0, sim_task1, sim_task2);
+	osThreadSetPriority(TASK0, 1);
+	sim_port_on_tick(sim_adc_isr);
+	osKernelLaunch(SIM_QUANTA);
+
+	sim_check("pending_bits", pending_ok);
+	sim_check("timeout", timeout_ok);
+	sim_check("yield_timeout", yield_ok);
+	sim_check("isr_wake", wake_ok && samples == SIM_SAMPLES);
+	sim_check("consistent", sim_consistent);
+	printf("latency,%u,%.2f,%llu\n", samples, (double)latency_sum / samples, (unsigned long long)latency_max);
+
+	return sim_exit_status();
+}
+
+/*** threads */
+
+static void sim_task0(void)
+{
+	uint32_t bits, start;
+	uint64_t latency;
+
+	/* pending_bits: sent before the wait */
+	osThreadNotify(TASK0, ADC_SAMPLE_READY | SIM_OTHER_BIT);
+	pending_ok = osThreadNotifyWait(ADC_SAMPLE_READY, 0) == ADC_SAMPLE_READY;
+	pending_ok &= osThreadNotifyWait(ADC_SAMPLE_READY, 0) == 0;
+	pending_ok &= osThreadNotifyWait(SIM_OTHER_BIT, 0) == SIM_OTHER_BIT;
+
+	/* yield_timeout: nothing is sent, the others yield */
+	yielding = 1;
+	start = osKernelGetTick();
+	bits = osThreadNotifyWait(SIM_OTHER_BIT, SIM_TIMEOUT);
+	yield_ok = bits == 0 && osKernelGetTick() - start == SIM_TIMEOUT && yields >= SIM_TIMEOUT * SIM_YIELD_PARTS;
+	yielding = 0;
+
+	/* timeout: nothing is sent, the interrupt starts with the first sample */
+	start = osKernelGetTick();
+	others_count = 0;
+	bits = osThreadNotifyWait(SIM_OTHER_BIT, SIM_TIMEOUT);
+	timeout_ok = bits == 0 && osKernelGetTick() - start == SIM_TIMEOUT && others_count == SIM_TIMEOUT;
+
+	/* isr_wake and latency */
+	adc_isr_count = 0;
+	while(samples < SIM_SAMPLES)
+	{
+		others_count = 0;
+		bits = osThreadNotifyWait(ADC_SAMPLE_READY, OS_WAIT_FOREVER);
+		latency = sim_monotonic_ns() - adc_isr_ns;
+		wake_ok &= bits == ADC_SAMPLE_READY && adc_sample == adc_isr_count;
+		wake_ok &= samples == 0 || others_count == SIM_ADC_PERIOD;	// one task1/task2 quanta per tick, none after the interrupt
+		latency_sum += latency;
+		if(latency > latency_max) latency_max = latency;
+		samples++;
+		sim_consistent &= osKernelCheck();
+	}
+	sim_port_stop();
+}
+
+static void sim_task1(void)
+{
+	while(1)
+	{
+		others_count++;
+		sim_consistent &= osKernelCheck();
+		sim_compute();
+	}
+}
+
+static void sim_task2(void)
+{
+	while(1)
+	{
+		others_count++;
+		sim_compute();
+	}
+}
+
+/* One quanta of work, or a part of it and the rest given away during yield_timeout */
+static void sim_compute(void)
+{
+	if(!yielding)
+	{
+		sim_port_work(1);
+		return;
+	}
+	if(++yields > SIM_YIELD_LIMIT)
+	{
+		sim_port_stop();						// no tick comes anymore: yield_timeout fails
+	}
+	sim_port_cycles((SysTick->LOAD + 1) / SIM_YIELD_PARTS);
+	osThreadYield();
+}
+
+/*** hardware side */
+
+/* ADC end of conversion, same body as ADC_IRQHandler in main.c */
+static void sim_adc_isr(uint32_t tick)
+{
+	if(timeout_ok && tick % SIM_ADC_PERIOD == 0)
+	{
+		adc_isr_ns = sim_monotonic_ns();
+		adc_sample = ++adc_isr_count;
+		osThreadNotifyFromISR(TASK0, ADC_SAMPLE_READY);
+	}
+}
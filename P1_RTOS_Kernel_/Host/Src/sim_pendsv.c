@@ -0,0 +1,534 @@
+/*
+ * *** Purpose:
+ * Run the inline scheduling decision of PendSV_Handler (Src/osKernelAssembly.s, OS_SCHEDULER_ASM 1) as Cortex-M4
+ * machine code and check that it picks the same thread as osScheduler (osKernel.c), which every other host
+ * program uses in its place.
+ *
+ * *** How it works
+ * make pendsv assembles osKernelAssembly.s with llvm-mc for the Cortex-M4 and extracts .text.PendSV_Handler as a
+ * raw binary (argument of the program). currentPt and osIdlePt are set to the absolute addresses SIM_CURRENTPT_ADDR
+ * and SIM_IDLEPT_ADDR before assembling, so the literal pool needs no relocation.
+ * 1. A Thumb interpreter runs the handler from its first instruction up to BX LR. It only knows the instructions
+ *    the handler uses; any other one stops the run and fails the check.
+ * 2. Its memory holds the tcbs in the target layout (TCB_STACKPT, TCB_NEXTPT, TCB_PRIORITY, TCB_STATE of
+ *    osKernel.h), a small stack per thread with r4-r11 and the two pointers.
+ * 3. The same tcbs are set on the host and osScheduler() decides; both results are compared.
+ * Checks:
+ * - decision: every combination of state (ready, blocked, waiting) and priority (0..NUM_OF_THREADS-1) of the
+ *   threads, on the full ring and on the ring without one exited thread, from every thread of the ring and from
+ *   the idle thread: same currentPt, same tcbs[OS_IDLE_THREAD].nextPt if nothing is ready.
+ * - context: SP saved into the old currentPt->stackPt, SP and r4-r11 of the new thread restored, interrupts enabled.
+ * - round_robin: SIM_TICKS decisions from osKernelAddThreads, as in sim_scheduler.c, without resynchronising.
+ * Estimate: the instructions the handler executed and their cycles from the Cortex-M4 timing table (TRM 3.3.1),
+ * with a pipeline refill of 1 cycle (zero wait state SRAM, see OS_RAM_FUNCTIONS) and no pipelined loads.
+ * These are counted, not measured: DWT->CYCCNT on the board (RUN_SWITCH_BENCHMARK) remains the reference.
+ *
+ * *** Output
+ * check,<name>,<ok|FAIL>
+ * estimate,<name>,<runs>,<min_instructions>,<max_instructions>,<min_cycles>,<max_cycles>
+ */
+
+#include  <stdio.h>
+#include  <stdlib.h>
+#include  <stdint.h>
+#include  <string.h>
+#include  "osKernel.h"
+#include  "sim_report.h"
+
+/* Define macros */
+#ifndef SIM_CURRENTPT_ADDR
+#define SIM_CURRENTPT_ADDR	0x20000F00U			// as the .set of the Makefile
+#endif
+#ifndef SIM_IDLEPT_ADDR
+#define SIM_IDLEPT_ADDR		0x20000F04U
+#endif
+#define SIM_RAM_BASE		0x20000000U
+#define SIM_RAM_SIZE		0x1000U
+#define SIM_TCB_BASE		SIM_RAM_BASE
+#define SIM_TCB_SIZE		0x20U				// up to TCB_STATE, the assembly reads nothing else
+#define SIM_STACK_BASE		0x20000400U
+#define SIM_STACK_SIZE		0x80U
+#define SIM_CODE_SIZE		0x400U
+#define SIM_EXC_RETURN		0xFFFFFFFDU			// thread mode, process stack
+#define SIM_MAX_STEPS		1000
+#define SIM_REFILL			1					// pipeline refill of a taken branch (P of the TRM)
+#define SIM_TICKS			3001
+#define SIM_STATES			3					// ready, blocked, waiting
+
+/* Declare private types */
+typedef struct{
+	uint32_t r[16];
+	uint32_t n, z, c, v;
+	uint32_t primask;
+	uint32_t instructions;
+	uint32_t cycles;
+	const char *fault;
+} cpuType;
+
+typedef struct{
+	uint32_t runs;
+	uint32_t min_instructions, max_instructions;
+	uint32_t min_cycles, max_cycles;
+} estimateType;
+
+/* Declare private functions */
+static uint32_t sim_read(cpuType *cpu, uint32_t addr);
+static void sim_write(cpuType *cpu, uint32_t addr, uint32_t value);
+static uint32_t sim_condition(const cpuType *cpu, uint32_t cond);
+static void sim_compare(cpuType *cpu, uint32_t a, uint32_t b);
+static void sim_execute(cpuType *cpu);
+static uint32_t sim_tcb_addr(const tcbType *pt);
+static uint32_t sim_tcb_index(uint32_t addr);
+static void sim_load(void);
+static uint32_t sim_pendsv(cpuType *cpu);
+static int sim_same_decision(void);
+static uint32_t sim_decision_vectors(void);
+static void sim_estimate_add(estimateType *e, const cpuType *cpu);
+static void sim_estimate_print(const char *name, const estimateType *e);
+static void sim_task0(void);
+static void sim_task1(void);
+static void sim_task2(void);
+
+/* Kernel function without a prototype in osKernel.h (called from assembly) */
+void osScheduler(void);
+
+/* Declare private variables */
+static uint8_t code[SIM_CODE_SIZE];
+static uint32_t code_size;
+static uint32_t ram[SIM_RAM_SIZE / 4];
+static uint32_t context_ok = 1;
+static uint32_t faults;
+static estimateType estimate_all;
+static estimateType estimate_round_robin;
+static void (*const sim_tasks[NUM_OF_THREADS])(void) = { sim_task0, sim_task1, sim_task2 };
+
+
+/* The threads never start on the host */
+void osSchedulerLaunch(void)
+{
+}
+
+int main(int argc, char *argv[])
+{
+	FILE *f;
+	uint32_t i, ok;
+	cpuType cpu;
+
+	if(argc != 2 || (f = fopen(argv[1], "rb")) == NULL)
+	{
+		fprintf(stderr, "usage: %s <PendSV_Handler binary>, see make pendsv\n", argv[0]);
+		return 2;
+	}
+	code_size = (uint32_t)fread(code, 1, sizeof(code), f);
+	fclose(f);
+
+	/* decision and context */
+	osKernelInit();
+	osKernelAddThreads(sim_tasks[0], sim_tasks[1], sim_tasks[2]);
+	ok = sim_decision_vectors();
+	sim_check("decision", ok);
+	sim_check("context", context_ok);
+
+	/* round_robin: the handler keeps its own currentPt from one decision to the next */
+	osKernelInit();
+	osKernelAddThreads(sim_tasks[0], sim_tasks[1], sim_tasks[2]);
+	sim_load();
+	ok = 1;
+	for(i = 0; i < SIM_TICKS; i++)
+	{
+		ok &= sim_pendsv(&cpu);
+		osScheduler();
+		ok &= sim_same_decision();
+		sim_estimate_add(&estimate_round_robin, &cpu);
+	}
+	sim_check("round_robin", ok && osKernelCheck());
+
+	sim_estimate_print("pendsv_asm", &estimate_all);
+	sim_estimate_print("pendsv_asm_round_robin", &estimate_round_robin);
+	return sim_exit_status();
+}
+
+/*** vectors */
+
+/* All states and priorities, on the full ring and without one thread, from every thread of the ring and idle */
+static uint32_t sim_decision_vectors(void)
+{
+	uint32_t ok = 1;
+	uint32_t combinations = 1;
+	uint32_t missing, combination, start, i, value;
+	uint32_t ring[NUM_OF_THREADS];
+	uint32_t length;
+	cpuType cpu;
+
+	for(i = 0; i < NUM_OF_THREADS; i++)
+	{
+		combinations *= SIM_STATES * NUM_OF_THREADS;
+	}
+	for(missing = 0; missing <= NUM_OF_THREADS; missing++)	// NUM_OF_THREADS: full ring
+	{
+		length = 0;
+		for(i = 0; i < NUM_OF_THREADS; i++)
+		{
+			if(i != missing)
+			{
+				ring[length++] = i;
+			}
+		}
+		for(combination = 0; combination < combinations; combination++)
+		{
+			value = combination;
+			for(i = 0; i < NUM_OF_THREADS; i++)
+			{
+				tcbs[i].state = value % SIM_STATES;		// OS_THREAD_READY, _BLOCKED, _WAITING
+				value /= SIM_STATES;
+				tcbs[i].priority = value % NUM_OF_THREADS;
+				value /= NUM_OF_THREADS;
+			}
+			if(missing < NUM_OF_THREADS)
+			{
+				tcbs[missing].state = OS_THREAD_EXITED;
+				tcbs[missing].nextPt = NULL;
+			}
+			for(i = 0; i < length; i++)
+			{
+				tcbs[ring[i]].nextPt = &tcbs[ring[(i + 1) % length]];
+			}
+			for(start = 0; start < 2 * length; start++)		// from ring[start], then from idle before ring[start]
+			{
+				if(start < length)
+				{
+					currentPt = &tcbs[ring[start]];
+				}
+				else
+				{
+					currentPt = &tcbs[OS_IDLE_THREAD];
+					currentPt->nextPt = &tcbs[ring[start - length]];
+				}
+				sim_load();
+				ok &= sim_pendsv(&cpu);
+				osScheduler();
+				ok &= sim_same_decision();
+				sim_estimate_add(&estimate_all, &cpu);
+			}
+		}
+	}
+	return ok;
+}
+
+/* Copies the host tcbs and currentPt into the memory of the handler, target layout */
+static void sim_load(void)
+{
+	uint32_t i, tcb, stack;
+
+	memset(ram, 0, sizeof(ram));
+	for(i = 0; i <= NUM_OF_THREADS; i++)
+	{
+		tcb = SIM_TCB_BASE + i * SIM_TCB_SIZE;
+		stack = SIM_STACK_BASE + (i + 1) * SIM_STACK_SIZE - 8 * 4;
+		sim_write(NULL, tcb + TCB_STACKPT, stack);
+		sim_write(NULL, tcb + TCB_NEXTPT, sim_tcb_addr(tcbs[i].nextPt));
+		sim_write(NULL, tcb + TCB_PRIORITY, tcbs[i].priority);
+		sim_write(NULL, tcb + TCB_STATE, tcbs[i].state);
+		for(uint32_t r = 0; r < 8; r++)
+		{
+			sim_write(NULL, stack + 4 * r, (i << 8) | (r + 4));	// r4-r11 of thread i
+		}
+	}
+	sim_write(NULL, SIM_CURRENTPT_ADDR, sim_tcb_addr(currentPt));
+	sim_write(NULL, SIM_IDLEPT_ADDR, sim_tcb_addr(&tcbs[OS_IDLE_THREAD]));
+}
+
+/* One PendSV: the thread runs on a stack of its own with r4-r11 = 0xAAAA0004.., returns 0 on a fault */
+static uint32_t sim_pendsv(cpuType *cpu)
+{
+	uint32_t old = sim_read(NULL, SIM_CURRENTPT_ADDR);
+	uint32_t sp = sim_read(NULL, old + TCB_STACKPT) + 8 * 4;	// the thread runs above its r4-r11
+	uint32_t steps, next, i;
+
+	memset(cpu, 0, sizeof(*cpu));
+	for(i = 0; i < 8; i++)
+	{
+		cpu->r[4 + i] = 0xAAAA0004U + i;
+	}
+	cpu->r[13] = sp;
+	cpu->r[14] = SIM_EXC_RETURN;
+	for(steps = 0; steps < SIM_MAX_STEPS && cpu->fault == NULL && cpu->r[15] != SIM_EXC_RETURN; steps++)
+	{
+		sim_execute(cpu);
+	}
+	if(cpu->fault != NULL || steps == SIM_MAX_STEPS)
+	{
+		if(faults++ == 0)							// the first one, the other runs stop at the same place
+		{
+			fprintf(stderr, "pendsv: %s at 0x%03x\n", cpu->fault ? cpu->fault : "no return", (unsigned)cpu->r[15]);
+		}
+		return 0;
+	}
+
+	/* context: the old SP saved below r4-r11, the new thread's stack popped (the same one if it stays) */
+	next = sim_read(NULL, SIM_CURRENTPT_ADDR);
+	context_ok &= sim_read(NULL, old + TCB_STACKPT) == sp - 8 * 4;
+	for(i = 0; i < 8; i++)
+	{
+		context_ok &= sim_read(NULL, sp - 8 * 4 + 4 * i) == 0xAAAA0004U + i;
+		context_ok &= cpu->r[4 + i] == (next == old ? 0xAAAA0004U + i : (sim_tcb_index(next) << 8) | (i + 4));
+	}
+	context_ok &= cpu->r[13] == sim_read(NULL, next + TCB_STACKPT) + 8 * 4;
+	context_ok &= cpu->primask == 0;
+	return 1;
+}
+
+/* After osScheduler() on the host */
+static int sim_same_decision(void)
+{
+	uint32_t next = sim_read(NULL, SIM_CURRENTPT_ADDR);
+	int ok = next == sim_tcb_addr(currentPt);
+
+	if(currentPt == &tcbs[OS_IDLE_THREAD])
+	{
+		ok &= sim_read(NULL, next + TCB_NEXTPT) == sim_tcb_addr(currentPt->nextPt);
+	}
+	return ok;
+}
+
+static uint32_t sim_tcb_addr(const tcbType *pt)
+{
+	return pt ? SIM_TCB_BASE + (uint32_t)(pt - tcbs) * SIM_TCB_SIZE : 0;
+}
+
+static uint32_t sim_tcb_index(uint32_t addr)
+{
+	return (addr - SIM_TCB_BASE) / SIM_TCB_SIZE;
+}
+
+/*** Cortex-M4, the instructions of PendSV_Handler */
+
+static uint32_t sim_read(cpuType *cpu, uint32_t addr)
+{
+	if(addr < SIM_CODE_SIZE && addr + 4 <= code_size && (addr & 3) == 0)
+	{
+		return code[addr] | (code[addr+1] << 8) | (code[addr+2] << 16) | ((uint32_t)code[addr+3] << 24);
+	}
+	if(addr >= SIM_RAM_BASE && addr < SIM_RAM_BASE + SIM_RAM_SIZE && (addr & 3) == 0)
+	{
+		return ram[(addr - SIM_RAM_BASE) / 4];
+	}
+	if(cpu != NULL)
+	{
+		cpu->fault = "bus fault (read)";
+	}
+	return 0;
+}
+
+static void sim_write(cpuType *cpu, uint32_t addr, uint32_t value)
+{
+	if(addr >= SIM_RAM_BASE && addr < SIM_RAM_BASE + SIM_RAM_SIZE && (addr & 3) == 0)
+	{
+		ram[(addr - SIM_RAM_BASE) / 4] = value;
+	}
+	else if(cpu != NULL)
+	{
+		cpu->fault = "bus fault (write)";
+	}
+}
+
+static uint32_t sim_condition(const cpuType *cpu, uint32_t cond)
+{
+	switch(cond)
+	{
+	case 0x0: return cpu->z;								// EQ
+	case 0x1: return !cpu->z;								// NE
+	case 0x2: return cpu->c;								// CS
+	case 0x3: return !cpu->c;								// CC
+	case 0x4: return cpu->n;								// MI
+	case 0x5: return !cpu->n;								// PL
+	case 0x6: return cpu->v;								// VS
+	case 0x7: return !cpu->v;								// VC
+	case 0x8: return cpu->c && !cpu->z;						// HI
+	case 0x9: return !cpu->c || cpu->z;						// LS
+	case 0xA: return cpu->n == cpu->v;						// GE
+	case 0xB: return cpu->n != cpu->v;						// LT
+	case 0xC: return !cpu->z && cpu->n == cpu->v;			// GT
+	case 0xD: return cpu->z || cpu->n != cpu->v;			// LE
+	default:  return 1;
+	}
+}
+
+static void sim_compare(cpuType *cpu, uint32_t a, uint32_t b)
+{
+	uint32_t result = a - b;
+
+	cpu->n = result >> 31;
+	cpu->z = result == 0;
+	cpu->c = a >= b;
+	cpu->v = ((a ^ b) & (a ^ result)) >> 31;
+}
+
+/* One instruction at PC: its effect, its count and its cycles */
+static void sim_execute(cpuType *cpu)
+{
+	uint32_t pc = cpu->r[15];
+	uint32_t hw, hw2, rn, rt, imm, i, count, taken = 0;
+	uint32_t cycles = 1;
+
+	if(pc + 2 > code_size)
+	{
+		cpu->fault = "fetch outside the handler";
+		return;
+	}
+	hw = code[pc] | (code[pc+1] << 8);
+	cpu->instructions++;
+	if((hw >> 11) == 0x1D || (hw >> 11) == 0x1E || (hw >> 11) == 0x1F)
+	{
+		/* 32 bit */
+		hw2 = code[pc+2] | (code[pc+3] << 8);
+		cpu->r[15] = pc + 4;
+		rn = hw & 0xF;
+		rt = hw2 >> 12;
+		if(hw == 0xE92D)								// PUSH.W (STMDB SP!)
+		{
+			count = 0;
+			for(i = 0; i < 16; i++)
+			{
+				count += (hw2 >> i) & 1;
+			}
+			cpu->r[13] -= 4 * count;
+			for(i = 0, imm = cpu->r[13]; i < 16; i++)
+			{
+				if(hw2 & (1U << i))
+				{
+					sim_write(cpu, imm, cpu->r[i]);
+					imm += 4;
+				}
+			}
+			cycles = 1 + count;
+		}
+		else if(hw == 0xE8BD && !(hw2 & (1U << 13)) && !(hw2 & (1U << 15)))	// POP.W (LDMIA SP!), no SP, no PC
+		{
+			count = 0;
+			for(i = 0, imm = cpu->r[13]; i < 16; i++)
+			{
+				if(hw2 & (1U << i))
+				{
+					cpu->r[i] = sim_read(cpu, imm);
+					imm += 4;
+					count++;
+				}
+			}
+			cpu->r[13] = imm;
+			cycles = 1 + count;
+		}
+		else if((hw & 0xFFF0) == 0xF8C0 && rn != 15)	// STR.W Rt, [Rn, #imm12]
+		{
+			sim_write(cpu, cpu->r[rn] + (hw2 & 0xFFF), cpu->r[rt]);
+			cycles = 2;
+		}
+		else if((hw & 0xFFF0) == 0xF8D0 && rn != 15 && rt != 15)	// LDR.W Rt, [Rn, #imm12]
+		{
+			cpu->r[rt] = sim_read(cpu, cpu->r[rn] + (hw2 & 0xFFF));
+			cycles = 2;
+		}
+		else
+		{
+			cpu->fault = "instruction not simulated";
+		}
+		cpu->cycles += cycles;
+		return;
+	}
+
+	/* 16 bit */
+	cpu->r[15] = pc + 2;
+	if((hw & 0xF800) == 0x4800)							// LDR Rt, [PC, #imm8]
+	{
+		cpu->r[(hw >> 8) & 7] = sim_read(cpu, ((pc + 4) & ~3U) + (hw & 0xFF) * 4);
+		cycles = 2;
+	}
+	else if((hw & 0xF800) == 0x6800)					// LDR Rt, [Rn, #imm5]
+	{
+		cpu->r[hw & 7] = sim_read(cpu, cpu->r[(hw >> 3) & 7] + ((hw >> 6) & 0x1F) * 4);
+		cycles = 2;
+	}
+	else if((hw & 0xF800) == 0x6000)					// STR Rt, [Rn, #imm5]
+	{
+		sim_write(cpu, cpu->r[(hw >> 3) & 7] + ((hw >> 6) & 0x1F) * 4, cpu->r[hw & 7]);
+		cycles = 2;
+	}
+	else if((hw & 0xFF00) == 0x4600)					// MOV Rd, Rm
+	{
+		rt = ((hw >> 4) & 8) | (hw & 7);
+		if(rt == 15)
+		{
+			cpu->fault = "instruction not simulated";
+		}
+		cpu->r[rt] = cpu->r[(hw >> 3) & 0xF];
+	}
+	else if((hw & 0xF800) == 0x2000)					// MOVS Rd, #imm8
+	{
+		imm = hw & 0xFF;
+		cpu->r[(hw >> 8) & 7] = imm;
+		cpu->n = 0;
+		cpu->z = imm == 0;
+	}
+	else if((hw & 0xF800) == 0x2800)					// CMP Rn, #imm8
+	{
+		sim_compare(cpu, cpu->r[(hw >> 8) & 7], hw & 0xFF);
+	}
+	else if((hw & 0xFFC0) == 0x4280)					// CMP Rn, Rm
+	{
+		sim_compare(cpu, cpu->r[hw & 7], cpu->r[(hw >> 3) & 7]);
+	}
+	else if((hw & 0xF000) == 0xD000 && ((hw >> 8) & 0xF) < 0xE)	// B<cond> label
+	{
+		if(sim_condition(cpu, (hw >> 8) & 0xF))
+		{
+			cpu->r[15] = pc + 4 + (uint32_t)((int32_t)(int8_t)(hw & 0xFF) * 2);
+			taken = 1;
+		}
+	}
+	else if((hw & 0xF500) == 0xB100)					// CBZ / CBNZ Rn, label
+	{
+		imm = (((hw >> 9) & 1) << 6) | (((hw >> 3) & 0x1F) << 1);
+		if((cpu->r[hw & 7] == 0) != ((hw >> 11) & 1))
+		{
+			cpu->r[15] = pc + 4 + imm;
+			taken = 1;
+		}
+	}
+	else if((hw & 0xFFEF) == 0xB662)					// CPSIE I / CPSID I
+	{
+		cpu->primask = (hw >> 4) & 1;
+	}
+	else if(hw == 0x4770)								// BX LR: exception return
+	{
+		cpu->r[15] = cpu->r[14];
+		taken = 1;
+	}
+	else
+	{
+		cpu->fault = "instruction not simulated";
+	}
+	cpu->cycles += cycles + (taken ? SIM_REFILL : 0);
+}
+
+/*** output */
+
+static void sim_estimate_add(estimateType *e, const cpuType *cpu)
+{
+	if(e->runs == 0 || cpu->instructions < e->min_instructions) e->min_instructions = cpu->instructions;
+	if(e->runs == 0 || cpu->instructions > e->max_instructions) e->max_instructions = cpu->instructions;
+	if(e->runs == 0 || cpu->cycles < e->min_cycles) e->min_cycles = cpu->cycles;
+	if(e->runs == 0 || cpu->cycles > e->max_cycles) e->max_cycles = cpu->cycles;
+	e->runs++;
+}
+
+static void sim_estimate_print(const char *name, const estimateType *e)
+{
+	printf("estimate,%s,%u,%u,%u,%u,%u\n", name, e->runs, e->min_instructions, e->max_instructions,
+			e->min_cycles, e->max_cycles);
+}
+
+/*** threads, never run on the host */
+
+static void sim_task0(void) {}
+static void sim_task1(void) {}
+static void sim_task2(void) {}
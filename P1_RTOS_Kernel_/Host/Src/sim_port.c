@@ -0,0 +1,184 @@
+/*
+ * Host build: thread port of the P1 kernel on ucontext, see Inc/sim_port.h.
+ */
+#define _XOPEN_SOURCE 700
+#include  <stdio.h>
+#include  <stdlib.h>
+#include  <ucontext.h>
+#include  "osKernel.h"
+#include  "sim_port.h"
+
+/* Define macros */
+#define SIM_PORT_STACK		(64 * 1024)				// host stack of a thread, TCB_STACK stays untouched
+#define SIM_COUNTFLAG		(1U<<16)
+
+/* Kernel functions without a prototype in osKernel.h (called from assembly or by the hardware) */
+void osScheduler(void);
+void SysTick_Handler(void);
+
+/* Declare private functions */
+static void sim_port_exceptions(void);
+static uint32_t sim_port_left(void);
+static void sim_port_thread_start(void);
+static void sim_port_thread_make(int i);
+static int sim_port_frame_unused(const tcbType *pt);
+
+/* Declare private variables */
+static ucontext_t launcher;
+static ucontext_t contexts[NUM_OF_THREADS + 1];		// and the idle thread
+static uint8_t stacks[NUM_OF_THREADS + 1][SIM_PORT_STACK];
+static void (*tick_hook)(uint32_t tick);
+static uint32_t ticks;
+static uint32_t in_exception;
+
+
+/* Replaces the assembly launch: start currentPt, return when a thread calls sim_port_stop */
+void osSchedulerLaunch(void)
+{
+	for(int i = 0; i <= OS_IDLE_THREAD; i++)
+	{
+		sim_port_thread_make(i);
+	}
+	ticks = 0;
+	SCB->ICSR = 0;
+	sim_exception_hook = sim_port_exceptions;
+	sim_wfi_hook = sim_port_tick;				// the idle thread sleeps until the next tick
+	swapcontext(&launcher, &contexts[currentPt - tcbs]);
+	sim_exception_hook = NULL;
+	sim_wfi_hook = NULL;
+}
+
+void sim_port_on_tick(void (*hook)(uint32_t tick))
+{
+	tick_hook = hook;
+}
+
+void sim_port_tick(void)
+{
+	ticks++;
+	DWT->CYCCNT += sim_port_left();				// up to the end of the quanta, a full one after a reload
+	SysTick->VAL = 0;
+	if(tick_hook != NULL)
+	{
+		in_exception++;
+		tick_hook(ticks);
+		in_exception--;
+	}
+	SysTick->CTRL |= SIM_COUNTFLAG;
+	SCB->ICSR |= SCB_ICSR_PENDSTSET_Msk;
+	if(!sim_irq_disabled())
+	{
+		sim_port_exceptions();
+	}
+}
+
+void sim_port_work(uint32_t n)
+{
+	for(uint32_t i = 0; i < n; i++)
+	{
+		sim_port_tick();
+	}
+}
+
+void sim_port_cycles(uint32_t n)
+{
+	while(n >= sim_port_left())
+	{
+		n -= sim_port_left();
+		sim_port_tick();
+	}
+	DWT->CYCCNT += n;
+	SysTick->VAL = sim_port_left() - n;			// counts down, LOAD + 1 cycles from one reload to the next
+}
+
+uint32_t sim_port_now(void)
+{
+	return ticks;
+}
+
+void sim_port_stop(void)
+{
+	swapcontext(&contexts[currentPt - tcbs], &launcher);
+}
+
+/*** exceptions: SysTick first (higher priority), then PendSV */
+
+static void sim_port_exceptions(void)
+{
+	if(in_exception)
+	{
+		return;									// exceptions do not preempt each other here, the pend stays
+	}
+	in_exception++;
+	while(SCB->ICSR & (SCB_ICSR_PENDSTSET_Msk | SCB_ICSR_PENDSVSET_Msk))
+	{
+		if(SCB->ICSR & SCB_ICSR_PENDSTSET_Msk)
+		{
+			SCB->ICSR &= ~SCB_ICSR_PENDSTSET_Msk;
+			SysTick_Handler();
+			SysTick->CTRL &= ~SIM_COUNTFLAG;	// cleared by the read in the handler
+			continue;
+		}
+		SCB->ICSR &= ~SCB_ICSR_PENDSVSET_Msk;
+
+		tcbType *previous = currentPt;			// PendSV_Handler: save context, osScheduler, restore context
+		osScheduler();
+		if(currentPt != previous)
+		{
+			if(sim_port_frame_unused(currentPt))
+			{
+				sim_port_thread_make(currentPt - tcbs);	// initial frame: a new thread (osThreadCreate) in this slot
+			}
+			in_exception--;
+			swapcontext(&contexts[previous - tcbs], &contexts[currentPt - tcbs]);
+			in_exception++;
+		}
+	}
+	in_exception--;
+}
+
+/* Cycles to the end of the quanta: VAL counts down to 0, 0 reloads LOAD (osKernelLaunch and osThreadYield write 0) */
+static uint32_t sim_port_left(void)
+{
+	return SysTick->VAL ? SysTick->VAL : SysTick->LOAD + 1;
+}
+
+static void sim_port_thread_make(int i)
+{
+	getcontext(&contexts[i]);
+	contexts[i].uc_stack.ss_sp = stacks[i];
+	contexts[i].uc_stack.ss_size = sizeof(stacks[i]);
+	contexts[i].uc_link = NULL;
+	makecontext(&contexts[i], sim_port_thread_start, 0);
+}
+
+static void sim_port_thread_start(void)
+{
+#if OS_STATIC_THREADS
+	osStackFrameType *frame = (osStackFrameType *)(void *)currentPt->stackPt;	// typed, see osStaticKernel.hpp
+	void (*entry)(void) = frame->pc;
+	void (*exit)(void) = frame->lr;
+
+	frame->pc = NULL;							// the frame is used, as the hardware unstacks it on target
+#else
+	void (*entry)(void) = (void (*)(void))(uintptr_t)(uint32_t)currentPt->stackPt[14];	// PC of the initial frame
+	void (*exit)(void) = (void (*)(void))(uintptr_t)(uint32_t)currentPt->stackPt[13];	// LR: osThreadExit
+
+	currentPt->stackPt[14] = 0;					// the frame is used, as the hardware unstacks it on target
+#endif
+	in_exception = 0;							// the first switch to a thread leaves PendSV here
+	entry();
+	exit();
+	fprintf(stderr, "sim_port: thread %d returned from its exit\n", (int)(currentPt - tcbs));
+	abort();
+}
+
+/* An initial frame the thread has not started from yet */
+static int sim_port_frame_unused(const tcbType *pt)
+{
+#if OS_STATIC_THREADS
+	return ((const osStackFrameType *)(const void *)pt->stackPt)->pc != NULL;
+#else
+	return pt->stackPt[14] != 0;
+#endif
+}
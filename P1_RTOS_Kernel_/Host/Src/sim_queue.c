@@ -0,0 +1,286 @@
+/*
+ * *** Purpose:
+ * Check the kernel message queues (osQueue.c) with real threads on the host port (Src/sim_port.c) and compare
+ * single item transfers with batches: time and kernel entries per item.
+ *
+ * *** How it works
+ * Thread 0 sends and runs the checks, thread 1 (and thread 2 for the priority check) receive, started for each
+ * step with a notification. The queue holds SIM_CAPACITY items of 32 bits.
+ * 1. fifo_single: SIM_ITEMS items one by one, the sender waits whenever the queue is full; they arrive in order.
+ * 2. fifo_batch: batches of SIM_SEND_BATCH (more than the capacity, the send waits in the middle) received in
+ *    batches of up to SIM_RECEIVE_BATCH; in order.
+ * 3. no_wait: timeout 0 on an empty or full queue returns at once.
+ * 4. timeout: a receive and a send time out after their timeout quanta (the idle thread lets time pass).
+ * 5. priority: two waiting receivers, the higher priority one gets the first item and preempts the sender.
+ * 6. isr: osQueueSendFromISR from the tick (an interrupt) wakes the waiting receiver.
+ * osKernelCheck() must hold at every tick and after every step.
+ * Benchmark: SIM_BENCH_ITEMS items from thread 0 to thread 1, single items against batches of SIM_BENCH_BATCH:
+ * clock_gettime, and kernel entries (__disable_irq calls, sim_irq_disable_count) per item.
+ *
+ * *** Output
+ * check,<name>,<ok|FAIL>
+ * benchmark,<name>,<calls>,<total_ns>,<per_call_ns>
+ * entries,<name>,<items>,<disable_irq>,<per_item>
+ */
+
+#include  <stdio.h>
+#include  <stdint.h>
+#include  "osKernel.h"
+#include  "sim_report.h"
+#include  "osQueue.h"
+#include  "sim_port.h"
+
+/* Define macros */
+#define SIM_QUANTA			1
+#define SIM_CAPACITY		64
+#define SIM_ITEMS			1000
+#define SIM_SEND_BATCH		100
+#define SIM_RECEIVE_BATCH	7
+#define SIM_TIMEOUT			3
+#define SIM_BENCH_ITEMS		1000000
+#define SIM_BENCH_BATCH		16
+#define SIM_GO				(1U<<0)				// notification bits
+#define SIM_DONE			(1U<<1)
+
+typedef enum
+{
+	SIM_FIFO_SINGLE,
+	SIM_FIFO_BATCH,
+	SIM_TIMEOUT_RECEIVE,
+	SIM_PRIORITY,
+	SIM_ISR,
+	SIM_BENCH_SINGLE,
+	SIM_BENCH_BATCHES
+} SimStep;
+
+/* Declare private functions */
+static void sim_sender(void);
+static void sim_receiver(void);
+static void sim_second_receiver(void);
+static void sim_run(SimStep next);
+static void sim_bench(const char *name, SimStep next, uint32_t batch);
+static void sim_observe(uint32_t tick);
+
+/* Declare private variables */
+static uint32_t buffer[SIM_CAPACITY];
+static osQueueType queue;
+static volatile SimStep step;
+static volatile uint32_t in_order;
+static volatile uint32_t elapsed;
+static volatile uint32_t received;
+static uint32_t winners[2];
+static volatile uint32_t winner_count;
+static volatile uint32_t isr_send;
+static uint32_t isr_value = 4711;
+
+
+int main(void)
+{
+	osKernelInit();
+	osKernelAddThreads(sim_sender, sim_receiver, sim_second_receiver);
+	osQueueInit(&queue, buffer, sizeof(uint32_t), SIM_CAPACITY);
+	sim_port_on_tick(sim_observe);
+	osKernelLaunch(SIM_QUANTA);
+
+	sim_check("consistent", sim_consistent);
+
+	return sim_exit_status();
+}
+
+/*** threads */
+
+static void sim_sender(void)
+{
+	uint32_t items[SIM_SEND_BATCH];
+	uint32_t i, value, start;
+	int ok;
+
+	/* fifo_single */
+	ok = 1;
+	sim_run(SIM_FIFO_SINGLE);
+	for(i = 0; i < SIM_ITEMS; i++)
+	{
+		ok &= osQueueSend(&queue, &i, OS_WAIT_FOREVER);
+	}
+	osThreadNotifyWait(SIM_DONE, OS_WAIT_FOREVER);
+	sim_check("fifo_single", ok && in_order && received == SIM_ITEMS && osQueueCount(&queue) == 0 && osKernelCheck());
+
+	/* fifo_batch */
+	ok = 1;
+	sim_run(SIM_FIFO_BATCH);
+	for(value = 0; value < SIM_ITEMS; )
+	{
+		for(i = 0; i < SIM_SEND_BATCH; i++)
+		{
+			items[i] = value + i;
+		}
+		ok &= osQueueSendBatch(&queue, items, SIM_SEND_BATCH, OS_WAIT_FOREVER) == SIM_SEND_BATCH;
+		value += SIM_SEND_BATCH;
+	}
+	osThreadNotifyWait(SIM_DONE, OS_WAIT_FOREVER);
+	sim_check("fifo_batch", ok && in_order && received == SIM_ITEMS && osQueueCount(&queue) == 0 && osKernelCheck());
+
+	/* no_wait */
+	ok = osQueueReceive(&queue, &value, 0) == 0;
+	for(i = 0; i < SIM_CAPACITY; i++)
+	{
+		items[i] = i;
+	}
+	ok &= osQueueSendBatch(&queue, items, SIM_CAPACITY, 0) == SIM_CAPACITY;
+	ok &= osQueueSend(&queue, &value, 0) == 0 && osQueueSendFromISR(&queue, &value, 1) == 0;
+	sim_check("no_wait", ok && osQueueCount(&queue) == SIM_CAPACITY);
+
+	/* timeout */
+	start = sim_port_now();
+	ok = osQueueSend(&queue, &value, SIM_TIMEOUT) == 0;
+	ok &= sim_port_now() - start == SIM_TIMEOUT;
+	ok &= osQueueReceiveBatch(&queue, items, SIM_SEND_BATCH, 0) == SIM_CAPACITY;
+	sim_run(SIM_TIMEOUT_RECEIVE);
+	osThreadNotifyWait(SIM_DONE, OS_WAIT_FOREVER);
+	sim_check("timeout", ok && received == 0 && elapsed == SIM_TIMEOUT && osKernelCheck());
+
+	/* priority */
+	osThreadSetPriority(1, 2);
+	osThreadSetPriority(2, 1);
+	sim_run(SIM_PRIORITY);
+	osThreadNotify(2, SIM_GO);					// both run at once (higher priority) and wait on the queue
+	value = 1;
+	osQueueSend(&queue, &value, OS_WAIT_FOREVER);
+	ok = winner_count == 1 && winners[0] == 1;	// preempted: thread 1 took it before the send returned
+	value = 2;
+	osQueueSend(&queue, &value, OS_WAIT_FOREVER);
+	ok &= winner_count == 2 && winners[1] == 2;
+	osThreadNotifyWait(SIM_DONE, OS_WAIT_FOREVER);
+	osThreadSetPriority(1, 0);
+	osThreadSetPriority(2, 0);
+	sim_check("priority", ok && osKernelCheck());
+
+	/* isr */
+	sim_run(SIM_ISR);
+	isr_send = 1;
+	osThreadNotifyWait(SIM_DONE, OS_WAIT_FOREVER);
+	sim_check("isr", in_order && isr_send == 0 && osKernelCheck());
+
+	/* benchmark */
+	sim_bench("single", SIM_BENCH_SINGLE, 1);
+	sim_bench("batch", SIM_BENCH_BATCHES, SIM_BENCH_BATCH);
+	sim_check("after_benchmark", osQueueCount(&queue) == 0 && osKernelCheck());
+
+	sim_port_stop();
+}
+
+static void sim_bench(const char *name, SimStep next, uint32_t batch)
+{
+	uint32_t items[SIM_BENCH_BATCH];
+	uint32_t entries = sim_irq_disable_count();
+	uint64_t start = sim_monotonic_ns();
+	uint64_t total;
+
+	sim_run(next);
+	for(uint32_t i = 0; i < SIM_BENCH_ITEMS; i += batch)
+	{
+		for(uint32_t j = 0; j < batch; j++)
+		{
+			items[j] = i + j;
+		}
+		if(batch == 1)
+		{
+			osQueueSend(&queue, items, OS_WAIT_FOREVER);
+		}
+		else
+		{
+			osQueueSendBatch(&queue, items, batch, OS_WAIT_FOREVER);
+		}
+	}
+	osThreadNotifyWait(SIM_DONE, OS_WAIT_FOREVER);
+	total = sim_monotonic_ns() - start;
+	entries = sim_irq_disable_count() - entries;
+
+	printf("benchmark,queue_%s,%u,%llu,%.2f\n", name, SIM_BENCH_ITEMS, (unsigned long long)total, (double)total / SIM_BENCH_ITEMS);
+	printf("entries,queue_%s,%u,%u,%.3f\n", name, SIM_BENCH_ITEMS, entries, (double)entries / SIM_BENCH_ITEMS);
+	sim_check(name, in_order && received == SIM_BENCH_ITEMS);
+}
+
+/* Start the next step in the receiver */
+static void sim_run(SimStep next)
+{
+	step = next;
+	in_order = 1;
+	received = 0;
+	osThreadNotify(1, SIM_GO);
+}
+
+static void sim_receiver(void)
+{
+	uint32_t items[SIM_BENCH_BATCH];
+	uint32_t value, n, start, total;
+
+	while(1)
+	{
+		osThreadNotifyWait(SIM_GO, OS_WAIT_FOREVER);
+		switch(step)
+		{
+		case SIM_FIFO_SINGLE:
+		case SIM_BENCH_SINGLE:
+			total = step == SIM_FIFO_SINGLE ? SIM_ITEMS : SIM_BENCH_ITEMS;
+			while(received < total)
+			{
+				osQueueReceive(&queue, &value, OS_WAIT_FOREVER);
+				in_order &= value == received;
+				received++;
+			}
+			break;
+		case SIM_FIFO_BATCH:
+		case SIM_BENCH_BATCHES:
+			total = step == SIM_FIFO_BATCH ? SIM_ITEMS : SIM_BENCH_ITEMS;
+			while(received < total)
+			{
+				n = osQueueReceiveBatch(&queue, items, step == SIM_FIFO_BATCH ? SIM_RECEIVE_BATCH : SIM_BENCH_BATCH, OS_WAIT_FOREVER);
+				for(uint32_t i = 0; i < n; i++)
+				{
+					in_order &= items[i] == received;
+					received++;
+				}
+			}
+			break;
+		case SIM_TIMEOUT_RECEIVE:
+			start = sim_port_now();
+			received = osQueueReceive(&queue, &value, SIM_TIMEOUT);
+			elapsed = sim_port_now() - start;
+			break;
+		case SIM_PRIORITY:
+			osQueueReceive(&queue, &value, OS_WAIT_FOREVER);
+			winners[winner_count++] = 1;
+			break;
+		case SIM_ISR:
+			osQueueReceive(&queue, &value, OS_WAIT_FOREVER);
+			in_order = value == isr_value;
+			break;
+		}
+		osThreadNotify(0, SIM_DONE);
+	}
+}
+
+static void sim_second_receiver(void)
+{
+	uint32_t value;
+
+	while(1)
+	{
+		osThreadNotifyWait(SIM_GO, OS_WAIT_FOREVER);
+		osQueueReceive(&queue, &value, OS_WAIT_FOREVER);
+		winners[winner_count++] = 2;
+	}
+}
+
+/*** hardware side */
+
+/* The tick is the interrupt that feeds the queue in the isr step */
+static void sim_observe(uint32_t tick)
+{
+	if(isr_send && queue.receivers != NULL)
+	{
+		isr_send = osQueueSendFromISR(&queue, &isr_value, 1) != 1;
+	}
+	sim_consistent &= osKernelCheck();
+}
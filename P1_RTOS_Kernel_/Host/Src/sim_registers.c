@@ -0,0 +1,119 @@
+/*
+ * Host build: register instances, NVIC priorities, the interrupt mask and the point where pended exceptions are taken.
+ */
+#include  "stm32f4xx.h"
+
+SysTick_Type   sim_SysTick;
+SCB_Type       sim_SCB;
+DWT_Type       sim_DWT;
+CoreDebug_Type sim_CoreDebug;
+TIM_TypeDef    sim_TIM2;
+RCC_TypeDef    sim_RCC;
+
+#define SIM_NVIC_IRQS	32						// device interrupts up to TIM2
+
+static uint32_t priority[2 + SIM_NVIC_IRQS];	// PendSV, SysTick, then the device interrupts
+static uint32_t enabled;
+static uint32_t pending;
+static uint32_t primask;
+static uint32_t disable_count;				// __disable_irq calls, i.e. kernel entries of the mutex slow paths
+
+void (*sim_exception_hook)(void);
+void (*sim_wfi_hook)(void);
+
+void NVIC_SetPriority(IRQn_Type IRQn, uint32_t value)
+{
+	priority[IRQn + 2] = value;
+}
+
+uint32_t NVIC_GetPriority(IRQn_Type IRQn)
+{
+	return priority[IRQn + 2];
+}
+
+void NVIC_EnableIRQ(IRQn_Type IRQn)
+{
+	enabled |= 1U << IRQn;
+}
+
+uint32_t NVIC_GetEnableIRQ(IRQn_Type IRQn)
+{
+	return (enabled >> IRQn) & 1U;
+}
+
+void NVIC_SetPendingIRQ(IRQn_Type IRQn)
+{
+	pending |= 1U << IRQn;
+}
+
+uint32_t NVIC_GetPendingIRQ(IRQn_Type IRQn)
+{
+	return (pending >> IRQn) & 1U;
+}
+
+void NVIC_ClearPendingIRQ(IRQn_Type IRQn)
+{
+	pending &= ~(1U << IRQn);
+}
+
+void __disable_irq(void)
+{
+	primask = 1;
+	disable_count++;
+}
+
+void __enable_irq(void)
+{
+	primask = 0;
+	if(sim_exception_hook != NULL)
+	{
+		sim_exception_hook();
+	}
+}
+
+uint32_t __get_PRIMASK(void)
+{
+	return primask;
+}
+
+void __set_PRIMASK(uint32_t mask)
+{
+	if(mask)
+	{
+		primask = 1;
+	}
+	else
+	{
+		__enable_irq();
+	}
+}
+
+void __DSB(void)
+{
+}
+
+void __ISB(void)
+{
+	if(sim_exception_hook != NULL && !primask)
+	{
+		sim_exception_hook();
+	}
+}
+
+void __WFI(void)
+{
+	if(sim_wfi_hook != NULL)
+	{
+		sim_wfi_hook();
+	}
+}
+
+uint32_t sim_irq_disabled(void)
+{
+	return primask;
+}
+
+uint32_t sim_irq_disable_count(void)
+{
+	return disable_count;
+}
@@ -0,0 +1,34 @@
+/*
+ * Host build: output of the P1 host programs, see Inc/sim_report.h.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include  <stdio.h>
+#include  <time.h>
+#include  "sim_report.h"
+
+int sim_consistent = 1;
+
+static uint32_t failures;
+
+
+void sim_check(const char *name, int ok)
+{
+	printf("check,%s,%s\n", name, ok ? "ok" : "FAIL");
+	if(!ok)
+	{
+		failures++;
+	}
+}
+
+int sim_exit_status(void)
+{
+	return failures ? 1 : 0;
+}
+
+uint64_t sim_monotonic_ns(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+}
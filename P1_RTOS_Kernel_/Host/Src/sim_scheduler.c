@@ -0,0 +1,185 @@
+/*
+ * *** Purpose:
+ * Run the P1 scheduler (osKernel.c, compiled unchanged) on Linux: check its decisions tick by tick and measure
+ * their cost, so a change of the scheduler can be validated without the board.
+ *
+ * *** How it works
+ * The simulator plays the Cortex-M4: SysTick and SCB are mock registers (Inc/stm32f4xx.h).
+ * 1. sim_tick() is one SysTick interrupt: it calls SysTick_Handler, and if PendSV was pended it runs what
+ *    PendSV_Handler does besides saving and restoring registers, which is calling osScheduler.
+ *    An expired quanta sets COUNTFLAG for the handler, a yield does not.
+ * 2. The threads never run: only the kernel data (tcbs, currentPt, TCB_STACK) is observed.
+ * Checks, after every step osKernelCheck() must hold:
+ * - add_threads: initial stack frames (thumb bit, PC), ring order, interrupts enabled again.
+ * - launch: SysTick reload for the quanta, control bits, SysTick and PendSV priorities.
+ * - round_robin: every tick pends exactly one PendSV and moves to the next thread.
+ * - quanta: over SIM_TICKS ticks every thread gets the same number of quanta (+-1), osKernelGetTick counts them.
+ * - yield: osThreadYield restarts the quanta and pends SysTick, which switches to the next thread without a tick.
+ * Benchmark: osScheduler alone, and the full tick (SysTick_Handler + PendSV), clock_gettime over SIM_CALLS calls.
+ *
+ * *** Output
+ * check,<name>,<ok|FAIL>
+ * benchmark,<name>,<calls>,<total_ns>,<per_call_ns>
+ */
+
+#include  <stdio.h>
+#include  <stdlib.h>
+#include  <stdint.h>
+#include  "osKernel.h"
+#include  "sim_report.h"
+
+/* Define macros */
+#define SIM_QUANTA			10
+#define SIM_BUS_FREQ		16000000
+#define SIM_TICKS			3001				// not a multiple of NUM_OF_THREADS, the quanta differ by one
+#define SIM_CALLS			10000000
+
+/* Kernel functions without a prototype in osKernel.h (called from assembly or by the hardware) */
+void osScheduler(void);
+void SysTick_Handler(void);
+
+/* Declare private functions */
+static void sim_task0(void);
+static void sim_task1(void);
+static void sim_task2(void);
+static void sim_tick(void);
+static void sim_systick(uint32_t expired);
+static uint32_t sim_thread_index(void);
+static void sim_benchmark(const char *name, void (*call)(void));
+
+/* Declare private variables */
+static uint32_t launched;
+static uint32_t pendsv_count;
+static void (*const sim_tasks[NUM_OF_THREADS])(void) = { sim_task0, sim_task1, sim_task2 };
+
+
+/* Replaces the assembly launch: the first thread would start here */
+void osSchedulerLaunch(void)
+{
+	launched++;
+}
+
+int main(void)
+{
+	uint32_t quanta[NUM_OF_THREADS] = {0};
+	uint32_t i, previous, min, max;
+	int ok;
+
+	/* add_threads */
+	osKernelInit();
+	ok = osKernelAddThreads(sim_tasks[0], sim_tasks[1], sim_tasks[2]) == 1;
+	for(i = 0; i < NUM_OF_THREADS; i++)
+	{
+		ok &= tcbs[i].stackPt == &TCB_STACK[i][STACKSIZE-16];
+		ok &= TCB_STACK[i][STACKSIZE-1] == (1U<<24);
+		ok &= TCB_STACK[i][STACKSIZE-2] == (int32_t)(intptr_t)sim_tasks[i];
+		ok &= tcbs[i].nextPt == &tcbs[(i + 1) % NUM_OF_THREADS];
+	}
+	ok &= currentPt == &tcbs[0];
+	ok &= !sim_irq_disabled();
+	ok &= osKernelCheck();
+	sim_check("add_threads", ok);
+
+	/* launch */
+	osKernelLaunch(SIM_QUANTA);
+	ok = SysTick->LOAD == SIM_QUANTA * (SIM_BUS_FREQ / 1000) - 1;
+	ok &= SysTick->CTRL == ((1U<<0) | (1U<<1) | (1U<<2));
+	ok &= SysTick->VAL == 0;
+	ok &= NVIC_GetPriority(SysTick_IRQn) == 7;
+	ok &= NVIC_GetPriority(PendSV_IRQn) == 15;
+	ok &= launched == 1;
+	sim_check("launch", ok);
+
+	/* round_robin and quanta */
+	ok = 1;
+	for(i = 0; i < SIM_TICKS; i++)
+	{
+		previous = sim_thread_index();
+		quanta[previous]++;
+		pendsv_count = 0;
+		sim_tick();
+		ok &= pendsv_count == 1;
+		ok &= sim_thread_index() == (previous + 1) % NUM_OF_THREADS;
+		ok &= osKernelCheck();
+	}
+	sim_check("round_robin", ok);
+
+	min = max = quanta[0];
+	for(i = 1; i < NUM_OF_THREADS; i++)
+	{
+		if(quanta[i] < min) min = quanta[i];
+		if(quanta[i] > max) max = quanta[i];
+	}
+	sim_check("quanta", (max - min <= 1) && (quanta[0] + quanta[1] + quanta[2] == SIM_TICKS) && (osKernelGetTick() == SIM_TICKS));
+
+	/* yield */
+	previous = sim_thread_index();
+	SysTick->VAL = 1234;
+	osThreadYield();
+	ok = SysTick->VAL == 0;
+	ok &= (SCB->ICSR & SCB_ICSR_PENDSTSET_Msk) != 0;
+	SCB->ICSR = 0;									// the hardware takes the pended SysTick
+	sim_systick(0);
+	ok &= sim_thread_index() == (previous + 1) % NUM_OF_THREADS;
+	ok &= osKernelGetTick() == SIM_TICKS;
+	ok &= osKernelCheck();
+	sim_check("yield", ok);
+
+	/* benchmark */
+	sim_benchmark("osScheduler", osScheduler);
+	sim_benchmark("tick", sim_tick);
+	sim_check("after_benchmark", osKernelCheck());
+
+	return sim_exit_status();
+}
+
+/*** hardware side */
+
+/* One expired quanta */
+static void sim_tick(void)
+{
+	sim_systick(1);
+}
+
+/* One SysTick interrupt, followed by the PendSV it pends (lowest priority, runs right after) */
+static void sim_systick(uint32_t expired)
+{
+	if(expired)
+	{
+		SysTick->CTRL |= (1U<<16);				// COUNTFLAG, cleared by the read in the handler
+	}
+	SysTick_Handler();
+	SysTick->CTRL &= ~(1U<<16);
+	if(SCB->ICSR & SCB_ICSR_PENDSVSET_Msk)
+	{
+		SCB->ICSR = 0;
+		pendsv_count++;
+		osScheduler();							// PendSV_Handler: save context, osScheduler, restore context
+	}
+}
+
+static uint32_t sim_thread_index(void)
+{
+	return (uint32_t)(currentPt - tcbs);
+}
+
+/*** threads, never run on the host */
+
+static void sim_task0(void) {}
+static void sim_task1(void) {}
+static void sim_task2(void) {}
+
+/*** output */
+
+static void sim_benchmark(const char *name, void (*call)(void))
+{
+	uint64_t start = sim_monotonic_ns();
+	uint64_t total;
+
+	for(uint32_t i = 0; i < SIM_CALLS; i++)
+	{
+		call();
+	}
+	total = sim_monotonic_ns() - start;
+	printf("benchmark,%s,%u,%llu,%.2f\n", name, SIM_CALLS, (unsigned long long)total, (double)total / SIM_CALLS);
+}
@@ -0,0 +1,125 @@
+/*
+ * *** Purpose:
+ * Report the CPU share every thread achieves against its target, with per thread slices (round robin) or with
+ * weights (OS_SCHEDULER_FAIR 1, make slices builds and runs both).
+ *
+ * *** How it works
+ * The three threads run on the host port (Src/sim_port.c) as a synthetic load:
+ * - busy:   thread 0 and 1 compute all the time,
+ * - bursty: thread 2 computes SIM_BURST ticks, then sleeps SIM_SLEEP ticks (osThreadNotifyWait).
+ * Round robin:    slices 1, 2, 4 quanta, all weights 1. The busy threads share in proportion to their slices.
+ * Weighted fair:  weights 5, 3, 2, all slices 1. The busy threads share in proportion to their weights, the bursty
+ *                 one gets what it asks for as long as that is below its weighted share.
+ * The tick hook charges every tick to the running thread over SIM_TICKS ticks.
+ * Target share of the busy threads: slice (or weight) / sum of the busy threads, times what the bursty one leaves.
+ * A share is ok within SIM_TOLERANCE per mille of its target.
+ *
+ * *** Output
+ * check,<name>,<ok|FAIL>
+ * share,<round_robin|weighted_fair>,<thread>,<slice>,<weight>,<target_permille>,<achieved_permille>
+ */
+
+#include  <stdio.h>
+#include  <stdint.h>
+#include  "osKernel.h"
+#include  "sim_port.h"
+#include  "sim_report.h"
+
+/* Define macros */
+#define SIM_QUANTA			1
+#define SIM_TICKS			20000
+#define SIM_BURST			1
+#define SIM_SLEEP			9					// the bursty thread asks for 1 tick in 10
+#define SIM_TOLERANCE		10
+#define SIM_NEVER			0					// notification mask that never matches: the wait is a sleep
+
+/* Declare private functions */
+static void sim_busy(void);
+static void sim_bursty(void);
+static void sim_observe(uint32_t tick);
+
+/* Declare private variables */
+#if OS_SCHEDULER_FAIR
+static const uint32_t slices[NUM_OF_THREADS] = { 1, 1, 1 };
+static const uint32_t weights[NUM_OF_THREADS] = { 5, 3, 2 };
+#else
+static const uint32_t slices[NUM_OF_THREADS] = { 1, 2, 4 };
+static const uint32_t weights[NUM_OF_THREADS] = { 1, 1, 1 };
+#endif
+static uint32_t charged[NUM_OF_THREADS + 1];
+static uint32_t ticks;
+
+
+int main(void)
+{
+	uint32_t target[NUM_OF_THREADS], achieved, bursty, busy_sum;
+	int ok = 1;
+
+	osKernelInit();
+	osKernelAddThreads(sim_busy, sim_busy, sim_bursty);
+	for(uint32_t i = 0; i < NUM_OF_THREADS; i++)
+	{
+		osThreadSetSlice(i, slices[i]);
+		osThreadSetWeight(i, weights[i]);
+	}
+	sim_port_on_tick(sim_observe);
+	osKernelLaunch(SIM_QUANTA);
+
+	/* the bursty thread asks for SIM_BURST in SIM_BURST + SIM_SLEEP ticks, the busy ones share the rest */
+	bursty = 1000 * SIM_BURST / (SIM_BURST + SIM_SLEEP);
+	busy_sum = OS_SCHEDULER_FAIR ? weights[0] + weights[1] : slices[0] + slices[1];
+	target[2] = bursty;
+	for(uint32_t i = 0; i < 2; i++)
+	{
+		target[i] = (1000 - bursty) * (OS_SCHEDULER_FAIR ? weights[i] : slices[i]) / busy_sum;
+	}
+
+	for(uint32_t i = 0; i < NUM_OF_THREADS; i++)
+	{
+		achieved = (uint32_t)((uint64_t)charged[i] * 1000 / ticks);
+		printf("share,%s,%u,%u,%u,%u,%u\n", OS_SCHEDULER_FAIR ? "weighted_fair" : "round_robin", i, slices[i], weights[i],
+			   target[i], achieved);
+		ok &= achieved + SIM_TOLERANCE >= target[i] && achieved <= target[i] + SIM_TOLERANCE;
+	}
+	sim_check("shares", ok);
+	sim_check("no_idle", charged[OS_IDLE_THREAD] == 0);
+	sim_check("consistent", sim_consistent);
+
+	return sim_exit_status();
+}
+
+/*** threads */
+
+static void sim_busy(void)
+{
+	while(1)
+	{
+		if(ticks >= SIM_TICKS)
+		{
+			sim_port_stop();
+		}
+		sim_port_work(1);
+	}
+}
+
+static void sim_bursty(void)
+{
+	while(1)
+	{
+		sim_port_work(SIM_BURST);
+		osThreadNotifyWait(SIM_NEVER, SIM_SLEEP);
+	}
+}
+
+/*** hardware side */
+
+/* The tick belongs to the thread that holds the CPU when it ends */
+static void sim_observe(uint32_t tick)
+{
+	if(ticks < SIM_TICKS)
+	{
+		ticks++;
+		charged[currentPt - tcbs]++;
+		sim_consistent &= osKernelCheck();
+	}
+}
@@ -0,0 +1,154 @@
+/*
+ * *** Purpose:
+ * Check the compile time thread table (osStaticKernel.hpp) and compare the kernel boot from it with the boot through
+ * osKernelAddThreads. Built twice: p1_static (every file with OS_STATIC_THREADS 1, the table below) and
+ * p1_static_dynamic (the same three threads from osKernelAddThreads and osThreadSetPriority).
+ *
+ * *** How it works
+ * 1. image (static only): a constructor of priority 101 looks at tcbs before any dynamic initializer of the
+ *    program. It must find the ring 0 -> 1 -> 2 -> 0 with its prevPt, the priorities and stacks of the table, every
+ *    stackPt at a frame with PC = thread function, LR = osThreadExit and the thumb bit, the idle thread with its
+ *    frame going on at thread 0, currentPt = thread 0, and osKernelCheck() must hold.
+ * 2. run: the kernel launches on the host port (Src/sim_port.c). Thread 0 (priority 1) runs first and joins
+ *    threads 1 and 2, which return from their functions into osThreadExit (the LR of their frames).
+ * 3. boot: the kernel setup before osKernelLaunch, SIM_BOOTS times: osKernelInit (static) against osKernelInit,
+ *    osKernelAddThreads and osThreadSetPriority (dynamic). Then once the time from the start of the setup to the
+ *    first line of thread 0; it includes osKernelLaunch and the contexts of the host port.
+ *
+ * *** Output
+ * check,<name>,<ok|FAIL>
+ * boot,<static|dynamic>,<boots>,<setup_total_ns>,<setup_per_boot_ns>,<setup_to_first_thread_ns>
+ */
+
+#include  <stdio.h>
+#include  <stdint.h>
+#include  "osKernel.h"
+#include  "sim_port.h"
+#include  "sim_report.h"
+
+/* Define macros */
+#define SIM_QUANTA			1
+#define SIM_BOOTS			100000
+#define SIM_PRIORITY		1					// thread 0
+
+/* Declare private functions */
+static void sim_first(void);
+static void sim_returning(void);
+static void sim_boot(void);
+static void sim_observe(uint32_t tick);
+
+#if OS_STATIC_THREADS
+#include  "osStaticKernel.hpp"
+
+/* Rows of different stack sizes, thread 0 above the others */
+constexpr os::ThreadConfig sim_threads[] = {
+	{sim_first, 256, SIM_PRIORITY},
+	{sim_returning, 128, 0},
+	{sim_returning, 400, 0},
+};
+
+OS_STATIC_KERNEL(sim_threads);
+
+static int image_ok;
+
+template<std::size_t I>
+static int sim_image_thread(void)
+{
+	auto &stack = os::detail::threadStack<sim_threads, I>;
+	const tcbType &t = tcbs[I];
+	int ok;
+
+	ok = t.stackPt == &stack.frame.r4_r11[0] && stack.frame.pc == sim_threads[I].task;
+	ok &= stack.frame.lr == osThreadExit && stack.frame.xpsr == (1U<<24) && stack.frame.r4_r11[0] == (int32_t)0xAAAAAAAA;
+	ok &= t.nextPt == &tcbs[(I + 1) % NUM_OF_THREADS] && t.prevPt == &tcbs[(I + NUM_OF_THREADS - 1) % NUM_OF_THREADS];
+	ok &= t.priority == sim_threads[I].priority && t.basePriority == sim_threads[I].priority;
+	ok &= t.state == OS_THREAD_READY && t.waitTicks == OS_WAIT_FOREVER && t.slice == 1 && t.sliceLeft == 1;
+	ok &= t.fairFactor == OS_FAIR_SCALE && t.stackBase == &stack.free[0] && t.stackWords * sizeof(int32_t) == sizeof(stack);
+	return ok;
+}
+
+/* Before main and before every dynamic initializer: only constant initialization has happened */
+__attribute__((constructor(101))) static void sim_image(void)
+{
+	const tcbType &idle = tcbs[OS_IDLE_THREAD];
+
+	image_ok = sim_image_thread<0>() && sim_image_thread<1>() && sim_image_thread<2>();
+	image_ok &= idle.nextPt == &tcbs[0] && idle.stackPt == &os::detail::idleStack.frame.r4_r11[0];
+	image_ok &= os::detail::idleStack.frame.pc == osIdleThread && currentPt == &tcbs[0] && osKernelCheck();
+}
+#endif
+
+/* Declare private variables */
+static const char *variant = OS_STATIC_THREADS ? "static" : "dynamic";
+static uint64_t boot_start;
+static uint64_t first_thread;
+static uint32_t returned;
+static int joined;
+
+
+int main(void)
+{
+	uint64_t start, total;
+
+#if OS_STATIC_THREADS
+	sim_check("image", image_ok);
+#endif
+
+	start = sim_monotonic_ns();
+	for(uint32_t i = 0; i < SIM_BOOTS; i++)
+	{
+		sim_boot();
+	}
+	total = sim_monotonic_ns() - start;
+
+#if OS_STATIC_THREADS
+	sim_check("image_after_boot", image_ok && osKernelCheck());
+#endif
+
+	sim_port_on_tick(sim_observe);
+	boot_start = sim_monotonic_ns();
+	sim_boot();
+	osKernelLaunch(SIM_QUANTA);
+
+	sim_check("run", joined && returned == 2 && first_thread != 0);
+	sim_check("consistent", sim_consistent);
+	printf("boot,%s,%u,%llu,%.2f,%llu\n", variant, SIM_BOOTS, (unsigned long long)total, (double)total / SIM_BOOTS,
+		   (unsigned long long)(first_thread - boot_start));
+
+	return sim_exit_status();
+}
+
+/* Everything the program runs before osKernelLaunch */
+static void sim_boot(void)
+{
+	osKernelInit();
+#if !OS_STATIC_THREADS
+	osKernelAddThreads(sim_first, sim_returning, sim_returning);
+	osThreadSetPriority(0, SIM_PRIORITY);
+#endif
+}
+
+/*** threads */
+
+static void sim_first(void)
+{
+	first_thread = sim_monotonic_ns();
+
+	joined = osThreadGetId() == 0 && osThreadJoin(1) && osThreadJoin(2);
+	joined &= tcbs[1].state == OS_THREAD_FREE && tcbs[2].state == OS_THREAD_FREE && osKernelCheck();
+
+	sim_port_stop();
+}
+
+static void sim_returning(void)
+{
+	sim_port_work(1);
+	returned++;
+}
+
+/*** hardware side */
+
+static void sim_observe(uint32_t tick)
+{
+	sim_consistent &= osKernelCheck();
+}
@@ -0,0 +1,145 @@
+/*
+ * *** Purpose:
+ * Check thread creation, exit and join of the kernel (osThreadCreate/Exit/Join in osKernel.c) on the host port
+ * (Src/sim_port.c), and measure what a short lived thread costs: create, run, exit, join.
+ *
+ * *** How it works
+ * osKernelAddThreads takes all NUM_OF_THREADS slots: a supervisor (thread 0), a worker that returns after a few
+ * ticks (thread 1) and a background thread that computes forever (thread 2). The supervisor runs the checks:
+ * 1. pool_full: osThreadCreate fails while every slot is in use.
+ * 2. join_blocks: osThreadJoin waits (OS_THREAD_JOINING, seen by the tick hook) until the worker returned,
+ *    the return from the thread function reaches osThreadExit through the LR of the initial frame.
+ * 3. recycled: the next osThreadCreate gets the freed slot; with a higher priority the new thread runs at once.
+ * 4. join_exited: it calls osThreadExit itself, the join returns without waiting.
+ * 5. join_invalid: joining itself, a free slot, the idle thread or OS_THREAD_NONE returns 0.
+ * osKernelCheck() must hold at every tick and after every step.
+ * Benchmark: SIM_ROUNDS times create (higher priority, runs at once), empty thread function, exit, join.
+ * The host port switches with swapcontext and makes a new context for a new thread: the figure includes both,
+ * which the target does not pay.
+ *
+ * *** Output
+ * check,<name>,<ok|FAIL>
+ * benchmark,<name>,<calls>,<total_ns>,<per_call_ns>
+ */
+
+#include  <stdio.h>
+#include  <stdint.h>
+#include  "osKernel.h"
+#include  "sim_port.h"
+#include  "sim_report.h"
+
+/* Define macros */
+#define SIM_QUANTA			1
+#define SIM_WORK			3					// ticks of the first worker
+#define SIM_ROUNDS			100000
+
+/* Declare private functions */
+static void sim_supervisor(void);
+static void sim_worker(void);
+static void sim_worker_exit(void);
+static void sim_worker_empty(void);
+static void sim_background(void);
+static void sim_observe(uint32_t tick);
+
+/* Declare private variables */
+static volatile uint32_t worker_done;
+static volatile uint32_t worker_exit_ran;
+static volatile uint32_t empty_runs;
+static uint32_t joining_ticks;
+
+
+int main(void)
+{
+	osKernelInit();
+	osKernelAddThreads(sim_supervisor, sim_worker, sim_background);
+	sim_port_on_tick(sim_observe);
+	osKernelLaunch(SIM_QUANTA);
+
+	sim_check("consistent", sim_consistent);
+
+	return sim_exit_status();
+}
+
+/*** threads */
+
+static void sim_supervisor(void)
+{
+	uint32_t thread, rounds, same_slot;
+	uint64_t start, total;
+	int ok;
+
+	/* pool_full */
+	sim_check("pool_full", osThreadCreate(sim_worker_empty, 1) == OS_THREAD_NONE && osKernelCheck());
+
+	/* join_blocks */
+	ok = osThreadJoin(1) == 1;
+	ok &= worker_done == 1 && joining_ticks > 0;
+	ok &= tcbs[1].state == OS_THREAD_FREE && tcbs[0].state == OS_THREAD_READY;
+	sim_check("join_blocks", ok && osKernelCheck());
+
+	/* recycled */
+	thread = osThreadCreate(sim_worker_exit, 1);
+	sim_check("recycled", thread == 1 && worker_exit_ran == 1 && tcbs[1].state == OS_THREAD_EXITED && osKernelCheck());
+
+	/* join_exited */
+	joining_ticks = 0;
+	ok = osThreadJoin(thread) == 1;
+	sim_check("join_exited", ok && joining_ticks == 0 && tcbs[1].state == OS_THREAD_FREE && osKernelCheck());
+
+	/* join_invalid */
+	ok = osThreadJoin(osThreadGetId()) == 0 && osThreadJoin(1) == 0;
+	ok &= osThreadJoin(OS_IDLE_THREAD) == 0 && osThreadJoin(OS_THREAD_NONE) == 0;
+	sim_check("join_invalid", ok && tcbs[OS_IDLE_THREAD].state == OS_THREAD_READY && osKernelCheck());
+
+	/* benchmark */
+	same_slot = 1;
+	start = sim_monotonic_ns();
+	for(rounds = 0; rounds < SIM_ROUNDS; rounds++)
+	{
+		thread = osThreadCreate(sim_worker_empty, 1);
+		same_slot &= thread == 1;
+		same_slot &= osThreadJoin(thread);
+	}
+	total = sim_monotonic_ns() - start;
+	printf("benchmark,create_run_exit_join,%u,%llu,%.2f\n", SIM_ROUNDS, (unsigned long long)total, (double)total / SIM_ROUNDS);
+	sim_check("rounds", same_slot && empty_runs == SIM_ROUNDS && osKernelCheck());
+
+	sim_port_stop();
+}
+
+/* Returns: the initial LR takes it to osThreadExit */
+static void sim_worker(void)
+{
+	sim_port_work(SIM_WORK);
+	worker_done++;
+}
+
+static void sim_worker_exit(void)
+{
+	worker_exit_ran++;
+	osThreadExit();
+}
+
+static void sim_worker_empty(void)
+{
+	empty_runs++;
+}
+
+static void sim_background(void)
+{
+	while(1)
+	{
+		sim_port_work(1);
+	}
+}
+
+/*** hardware side */
+
+static void sim_observe(uint32_t tick)
+{
+	if(tcbs[0].state == OS_THREAD_JOINING)
+	{
+		joining_ticks++;
+	}
+	sim_consistent &= osKernelCheck();
+}
@@ -0,0 +1,307 @@
+/*
+ * *** Purpose:
+ * Check the microsecond timers of osTimer.c on a simulated TIM2 and report their wakeup error, so the timer queue
+ * can be changed without the board.
+ *
+ * *** How it works
+ * The simulator plays TIM2 (mock registers, Inc/stm32f4xx.h): sim_advance() counts CNT up one microsecond at a
+ * time, sets CC1IF when CNT reaches CCR1 and calls TIM2_IRQHandler when CC1IE is set or the interrupt was pended,
+ * unless interrupts are masked. Checks:
+ * - init: 1 MHz prescaler, free running 32 bits, interrupt priority, compare interrupt off with an empty queue.
+ * - order: SIM_TIMERS timers with pseudo random delays, started out of order, fire in expiry order, each exactly
+ *   at its expiry; equal expiries fire in start order.
+ * - wrap: timers across the 32 bit wrap of CNT.
+ * - stop: stopping the first timer moves the compare to the next; a fired or stale id does not stop anything.
+ * - pool_full: OS_TIMER_COUNT timers pending, the next start fails; so does a delay above OS_TIMER_MAX_US.
+ * - zero: a timer that is due when started pends the interrupt itself (no compare match will come).
+ * - notify: osTimerStartNotify sets OS_TIMER_WAKE of the thread at the expiry.
+ * Wakeup error: a callback that starts itself again with a pseudo random delay (SIM_MIN_US..SIM_MAX_US), as a valve
+ * timing loop would, SIM_SAMPLES times. Once without other interrupts, once with masked windows of 1..SIM_MASK_MAX us
+ * started with probability 1/SIM_MASK_EVERY per microsecond (other interrupts, critical sections): the
+ * error is the time the compare interrupt waits. Interrupt entry and the callback itself take no simulated time:
+ * on target add their cycles (Src/timer_benchmark.c).
+ * Benchmark: osTimerStart + osTimerStop with OS_TIMER_COUNT - 1 timers pending, clock_gettime over SIM_CALLS calls.
+ *
+ * *** Output
+ * check,<name>,<ok|FAIL>
+ * error,<none|masked>,<us>,<count>				histogram, the last bucket counts SIM_HIST us and more
+ * wakeup,<none|masked>,<samples>,<avg_us>,<max_us>
+ * benchmark,<name>,<calls>,<total_ns>,<per_call_ns>
+ */
+
+#include  <stdio.h>
+#include  <stdint.h>
+#include  "osKernel.h"
+#include  "sim_report.h"
+#include  "osTimer.h"
+
+/* Define macros */
+#define SIM_TIMERS			OS_TIMER_COUNT
+#define SIM_SAMPLES			100000
+#define SIM_MIN_US			50
+#define SIM_MAX_US			2000
+#define SIM_MASK_EVERY		200
+#define SIM_MASK_MAX		8
+#define SIM_HIST			10
+#define SIM_CALLS			10000000
+#define SIM_CC1IE			(1U<<1)
+#define SIM_CC1IF			(1U<<1)
+
+/* Kernel functions without a prototype in osKernel.h (called from assembly or by the hardware) */
+void TIM2_IRQHandler(void);
+void osSchedulerLaunch(void) {}
+
+/* Declare private functions */
+static void sim_record(void);
+static void sim_first(void);
+static void sim_second(void);
+static void sim_valve(void);
+static void sim_advance(uint32_t us);
+static void sim_irq(void);
+static uint32_t sim_random(void);
+static void sim_wakeup(const char *name, uint32_t mask_every);
+static void sim_thread(void) {}
+
+/* Declare private variables */
+static uint32_t fired[SIM_TIMERS];
+static uint32_t fired_count;
+static uint32_t order[2];
+static uint32_t order_count;
+static uint32_t expected;
+static uint32_t samples;
+static uint32_t histogram[SIM_HIST + 1];
+static uint64_t error_sum;
+static uint32_t error_max;
+static uint32_t masked;
+static uint32_t mask_every;
+static uint32_t seed = 12345;
+
+
+int main(void)
+{
+	uint32_t expiry[SIM_TIMERS];
+	uint32_t ids[SIM_TIMERS];
+	uint32_t i, j, id, stale, delay;
+	uint64_t start, total;
+	int ok;
+
+	osKernelInit();
+	osKernelAddThreads(sim_thread, sim_thread, sim_thread);	// tcbs for osTimerStartNotify, never launched
+
+	/* init */
+	osTimerInit();
+	ok = TIM2->PSC == 15 && TIM2->ARR == 0xFFFFFFFF && (TIM2->CR1 & 1U);
+	ok &= NVIC_GetPriority(TIM2_IRQn) == OS_TIMER_IRQ_PRIORITY && NVIC_GetEnableIRQ(TIM2_IRQn);
+	ok &= (TIM2->DIER & SIM_CC1IE) == 0 && (RCC->APB1ENR & 1U);
+	sim_check("init", ok);
+
+	/* order */
+	ok = 1;
+	TIM2->CNT = 1000;
+	for(i = 0; i < SIM_TIMERS; i++)
+	{
+		delay = SIM_MIN_US + sim_random() % (SIM_MAX_US - SIM_MIN_US);
+		expiry[i] = TIM2->CNT + delay;
+		ok &= osTimerStart(delay, sim_record) != OS_TIMER_NONE;
+		sim_advance(1);
+	}
+	for(i = 1; i < SIM_TIMERS; i++)							// expected firing order
+	{
+		for(j = i; j > 0 && expiry[j - 1] > expiry[j]; j--)
+		{
+			uint32_t swap = expiry[j];
+			expiry[j] = expiry[j - 1];
+			expiry[j - 1] = swap;
+		}
+	}
+	sim_advance(SIM_MAX_US + SIM_TIMERS);
+	ok &= fired_count == SIM_TIMERS;
+	for(i = 0; i < SIM_TIMERS; i++)
+	{
+		ok &= fired[i] == expiry[i];
+	}
+	osTimerStart(100, sim_second);
+	osTimerStart(100, sim_first);
+	sim_advance(100);
+	ok &= order_count == 2 && order[0] == 2 && order[1] == 1;
+	ok &= (TIM2->DIER & SIM_CC1IE) == 0;
+	sim_check("order", ok);
+
+	/* wrap */
+	fired_count = 0;
+	TIM2->CNT = 0xFFFFFFF0;
+	osTimerStart(40, sim_record);
+	osTimerStart(5, sim_record);
+	osTimerStart(20, sim_record);
+	sim_advance(40);
+	sim_check("wrap", fired_count == 3 && fired[0] == 0xFFFFFFF5 && fired[1] == 0x00000004 && fired[2] == 0x00000018);
+
+	/* stop */
+	fired_count = 0;
+	ids[0] = osTimerStart(100, sim_record);
+	ids[1] = osTimerStart(50, sim_record);
+	ids[2] = osTimerStart(200, sim_record);
+	ok = osTimerStop(ids[1]) == 1 && TIM2->CCR1 == TIM2->CNT + 100;
+	sim_advance(100);
+	ok &= fired_count == 1 && osTimerStop(ids[0]) == 0 && osTimerStop(ids[1]) == 0;
+	stale = ids[0];
+	ids[3] = osTimerStart(10, sim_record);					// takes the slot of ids[0] again
+	ok &= (ids[3] & 0xFF) == (stale & 0xFF) && osTimerStop(stale) == 0;
+	sim_advance(100);
+	ok &= fired_count == 3 && osTimerStop(OS_TIMER_NONE) == 0;
+	sim_check("stop", ok);
+
+	/* pool_full */
+	for(i = 0; i < OS_TIMER_COUNT; i++)
+	{
+		ids[i] = osTimerStart(1000, sim_record);
+	}
+	ok = osTimerStart(1000, sim_record) == OS_TIMER_NONE;
+	for(i = 0; i < OS_TIMER_COUNT; i++)
+	{
+		ok &= ids[i] != OS_TIMER_NONE && osTimerStop(ids[i]) == 1;
+	}
+	ok &= osTimerStart(OS_TIMER_MAX_US + 1, sim_record) == OS_TIMER_NONE;
+	sim_check("pool_full", ok && (TIM2->DIER & SIM_CC1IE) == 0);
+
+	/* zero */
+	fired_count = 0;
+	osTimerStart(0, sim_record);
+	ok = NVIC_GetPendingIRQ(TIM2_IRQn) == 1;
+	sim_irq();
+	sim_check("zero", ok && fired_count == 1 && fired[0] == TIM2->CNT);
+
+	/* notify */
+	tcbs[1].notify = 0;
+	osTimerStartNotify(300, 1);
+	sim_advance(299);
+	ok = (tcbs[1].notify & OS_TIMER_WAKE) == 0;
+	sim_advance(1);
+	sim_check("notify", ok && (tcbs[1].notify & OS_TIMER_WAKE) != 0);
+
+	/* wakeup error */
+	sim_wakeup("none", 0);
+	sim_check("exact", error_max == 0);
+	sim_wakeup("masked", SIM_MASK_EVERY);
+	sim_check("bounded", error_max <= SIM_MASK_MAX);
+
+	/* benchmark */
+	for(i = 0; i < OS_TIMER_COUNT - 1; i++)
+	{
+		ids[i] = osTimerStart(1000 + i * 10, sim_record);
+	}
+	start = sim_monotonic_ns();
+	for(i = 0; i < SIM_CALLS; i++)
+	{
+		id = osTimerStart(1000 + (i & 63) * 2, sim_record);	// lands between the pending ones
+		osTimerStop(id);
+	}
+	total = sim_monotonic_ns() - start;
+	printf("benchmark,start_stop_%u_pending,%u,%llu,%.2f\n", OS_TIMER_COUNT - 1, SIM_CALLS, (unsigned long long)total, (double)total / SIM_CALLS);
+
+	return sim_exit_status();
+}
+
+/*** callbacks, in TIM2_IRQHandler */
+
+static void sim_record(void)
+{
+	if(fired_count < SIM_TIMERS)
+	{
+		fired[fired_count] = TIM2->CNT;
+	}
+	fired_count++;
+}
+
+static void sim_first(void)
+{
+	order[order_count++] = 1;
+}
+
+static void sim_second(void)
+{
+	order[order_count++] = 2;
+}
+
+/* One valve event: measure, then start the next one */
+static void sim_valve(void)
+{
+	uint32_t error = TIM2->CNT - expected;
+	uint32_t delay;
+
+	histogram[error < SIM_HIST ? error : SIM_HIST]++;
+	error_sum += error;
+	if(error > error_max) error_max = error;
+	if(++samples < SIM_SAMPLES)
+	{
+		delay = SIM_MIN_US + sim_random() % (SIM_MAX_US - SIM_MIN_US);
+		expected = TIM2->CNT + delay;
+		osTimerStart(delay, sim_valve);
+	}
+}
+
+static void sim_wakeup(const char *name, uint32_t every)
+{
+	samples = 0;
+	error_sum = 0;
+	error_max = 0;
+	for(uint32_t i = 0; i <= SIM_HIST; i++)
+	{
+		histogram[i] = 0;
+	}
+	mask_every = every;
+	expected = TIM2->CNT + SIM_MIN_US;
+	osTimerStart(SIM_MIN_US, sim_valve);
+	while(samples < SIM_SAMPLES)
+	{
+		sim_advance(1);
+	}
+	mask_every = 0;
+
+	for(uint32_t i = 0; i <= SIM_HIST; i++)
+	{
+		printf("error,%s,%u,%u\n", name, i, histogram[i]);
+	}
+	printf("wakeup,%s,%u,%.3f,%u\n", name, samples, (double)error_sum / samples, error_max);
+}
+
+/*** hardware side */
+
+/* TIM2 counts us microseconds, the compare interrupt is taken when interrupts are not masked */
+static void sim_advance(uint32_t us)
+{
+	for(uint32_t i = 0; i < us; i++)
+	{
+		TIM2->CNT = TIM2->CNT + 1;
+		if(TIM2->CNT == TIM2->CCR1)
+		{
+			TIM2->SR |= SIM_CC1IF;
+		}
+		if(masked != 0)
+		{
+			masked--;							// the interrupt waits for the end of the window
+			continue;
+		}
+		sim_irq();
+		if(mask_every != 0 && sim_random() % mask_every == 0)
+		{
+			masked = 1 + sim_random() % SIM_MASK_MAX;	// the next microseconds are masked
+		}
+	}
+}
+
+static void sim_irq(void)
+{
+	if(((TIM2->SR & SIM_CC1IF) && (TIM2->DIER & SIM_CC1IE)) || NVIC_GetPendingIRQ(TIM2_IRQn))
+	{
+		NVIC_ClearPendingIRQ(TIM2_IRQn);
+		TIM2_IRQHandler();
+	}
+}
+
+/* Park-Miller, the same sequence on every run */
+static uint32_t sim_random(void)
+{
+	seed = (uint32_t)((uint64_t)seed * 48271 % 0x7FFFFFFF);
+	return seed;
+}
@@ -5,5 +5,8 @@
 
 void pa1_adc_init();
 uint32_t adc_read(void);
+void pa1_adc_interrupt_init(void);
+void adc_start_single(void);
+uint32_t adc_result(void);
 
 #endif /* ADC_H_ */
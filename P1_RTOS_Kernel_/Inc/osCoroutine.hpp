@@ -0,0 +1,331 @@
+#ifndef __OS_COROUTINE__
+#define __OS_COROUTINE__
+
+/*
+ * Stackless coroutine tasks (C++20) inside one kernel thread.
+ *
+ * A kernel thread needs a full TCB_STACK row (STACKSIZE words). A coroutine only keeps the variables that live
+ * across a co_await, in a frame taken from a static arena (os::coArena), so many sensor loops fit in one thread:
+ *
+ *   os::CoScheduler sensors;
+ *   os::CoSignal sampleReady;
+ *
+ *   os::CoTask sensorLoop(uint32_t channel, uint32_t period)
+ *   {
+ *       while(1)
+ *       {
+ *           co_await sensors.delay(period);			// kernel ticks (quanta)
+ *           co_await sampleReady.wait(sensors);		// notified by the thread or interrupt that samples
+ *           ...
+ *       }
+ *   }
+ *
+ *   void task0_sensors(void)						// one kernel thread runs all of them
+ *   {
+ *       for(uint32_t i = 0; i < 50; i++) sensors.spawn(sensorLoop(i, 1 + i % 4));
+ *       sensors.run();
+ *   }
+ *
+ * Awaitables: delay(ticks), tick() (next quanta), yield() (after the other ready coroutines), CoSignal::wait().
+ * The scheduler runs every ready coroutine, then sleeps until the next tick (osThreadNotifyWait, timeout 1): a delay
+ * ends on its tick, a CoSignal::notify is seen on the next tick at the latest.
+ * Only the thread that runs the scheduler may spawn and await; CoSignal::notify may be called from anywhere.
+ * Frames are never allocated from the heap: a full arena makes spawn() return 0. No exceptions are used.
+ */
+
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include "osKernel.h"
+
+#ifndef OS_CO_ARENA_BYTES
+#define OS_CO_ARENA_BYTES		4096				// all coroutine frames of the program
+#endif
+
+namespace os {
+
+/* Frame memory: bump allocation, released frames are kept on a free list and reused by frames of the same size */
+class CoArena
+{
+public:
+	void *allocate(std::size_t size) noexcept
+	{
+		size = roundUp(size);
+		for(FreeBlock **link = &freeList; *link != nullptr; link = &(*link)->next)
+		{
+			if((*link)->size == size)
+			{
+				FreeBlock *block = *link;
+				*link = block->next;
+				inUse += size;
+				return block;
+			}
+		}
+		if(top + size > sizeof(memory))
+		{
+			return nullptr;
+		}
+		void *frame = &memory[top];
+		top += size;
+		inUse += size;
+		return frame;
+	}
+
+	void release(void *frame, std::size_t size) noexcept
+	{
+		FreeBlock *block = static_cast<FreeBlock *>(frame);
+		block->size = roundUp(size);
+		block->next = freeList;
+		freeList = block;
+		inUse -= block->size;
+	}
+
+	std::size_t used() const { return inUse; }
+	std::size_t reserved() const { return top; }
+	static constexpr std::size_t capacity() { return OS_CO_ARENA_BYTES; }
+
+private:
+	struct FreeBlock
+	{
+		FreeBlock *next;
+		std::size_t size;
+	};
+
+	static constexpr std::size_t roundUp(std::size_t size)
+	{
+		return (size + alignof(std::max_align_t) - 1) & ~(alignof(std::max_align_t) - 1);
+	}
+
+	alignas(std::max_align_t) uint8_t memory[OS_CO_ARENA_BYTES];
+	std::size_t top = 0;
+	std::size_t inUse = 0;
+	FreeBlock *freeList = nullptr;
+};
+
+inline CoArena coArena;
+
+/* Return type of a coroutine task */
+class CoTask
+{
+public:
+	struct promise_type
+	{
+		promise_type *next = nullptr;				// ready, delayed or signal list of the scheduler
+		uint32_t wake = 0;							// tick to resume at when delayed, signal count seen when waiting
+
+		CoTask get_return_object() noexcept { return CoTask(this); }
+		static CoTask get_return_object_on_allocation_failure() noexcept { return CoTask(nullptr); }
+		std::suspend_always initial_suspend() noexcept { return {}; }	// starts when the scheduler first runs it
+		std::suspend_always final_suspend() noexcept { return {}; }		// the scheduler frees the frame
+		void return_void() noexcept {}
+		void unhandled_exception() noexcept { while(1); }
+
+		static void *operator new(std::size_t size) noexcept { return coArena.allocate(size); }
+		static void operator delete(void *frame, std::size_t size) noexcept { coArena.release(frame, size); }
+	};
+
+	explicit CoTask(promise_type *promise) : promise(promise) {}
+	promise_type *get() const { return promise; }
+
+private:
+	promise_type *promise;
+};
+
+using CoPromise = CoTask::promise_type;
+using CoHandle = std::coroutine_handle<CoPromise>;
+
+class CoSignal;
+
+class CoScheduler
+{
+public:
+	/* Queue a new task, 1 if its frame fitted in the arena */
+	uint8_t spawn(CoTask task)
+	{
+		if(task.get() == nullptr)
+		{
+			return 0;
+		}
+		makeReady(task.get());
+		tasks++;
+		return 1;
+	}
+
+	/* Thread body: never returns. Not osThreadYield when idle: it restarts the quanta, so with every other thread
+	 * waiting no tick would ever come and no delay would end */
+	void run()
+	{
+		while(1)
+		{
+			if(!runOnce())
+			{
+				osThreadNotifyWait(0, 1);			// nothing ready: no bit can wake it, the next tick does
+			}
+		}
+	}
+
+	/* Wake the delayed tasks that are due and the waiters of notified signals, then resume every ready task once.
+	 * Returns the number of resumed tasks. */
+	uint32_t runOnce();
+
+	uint32_t now() const { return osKernelGetTick(); }
+	uint32_t count() const { return tasks; }
+
+	struct DelayAwaiter
+	{
+		CoScheduler &scheduler;
+		uint32_t ticks;
+
+		bool await_ready() const noexcept { return ticks == 0; }
+		void await_suspend(CoHandle handle) noexcept { scheduler.sleep(&handle.promise(), scheduler.now() + ticks); }
+		void await_resume() const noexcept {}
+	};
+
+	struct YieldAwaiter
+	{
+		CoScheduler &scheduler;
+
+		bool await_ready() const noexcept { return false; }
+		void await_suspend(CoHandle handle) noexcept { scheduler.makeReady(&handle.promise()); }
+		void await_resume() const noexcept {}
+	};
+
+	DelayAwaiter delay(uint32_t ticks) { return DelayAwaiter{*this, ticks}; }
+	DelayAwaiter tick() { return DelayAwaiter{*this, 1}; }
+	YieldAwaiter yield() { return YieldAwaiter{*this}; }
+
+private:
+	friend class CoSignal;
+
+	void makeReady(CoPromise *promise)
+	{
+		promise->next = nullptr;
+		if(readyTail != nullptr) readyTail->next = promise; else readyHead = promise;
+		readyTail = promise;
+	}
+
+	/* Delayed list sorted by wake tick, wrap safe */
+	void sleep(CoPromise *promise, uint32_t wake)
+	{
+		CoPromise **link = &delayed;
+		promise->wake = wake;
+		while(*link != nullptr && (int32_t)((*link)->wake - wake) <= 0)
+		{
+			link = &(*link)->next;
+		}
+		promise->next = *link;
+		*link = promise;
+	}
+
+	void watch(CoSignal *signal);
+
+	CoPromise *readyHead = nullptr;
+	CoPromise *readyTail = nullptr;
+	CoPromise *delayed = nullptr;
+	CoSignal *signals = nullptr;
+	uint32_t tasks = 0;
+};
+
+/* Event for coroutines, e.g. sample ready: notify() wakes every task that waits since before the notify,
+ * on the next pass of the scheduler */
+class CoSignal
+{
+public:
+	void notify() { posted = posted + 1; }			// one notifier (thread or interrupt), single word write
+
+	struct WaitAwaiter
+	{
+		CoSignal &signal;
+		CoScheduler &scheduler;
+
+		bool await_ready() const noexcept { return false; }
+		void await_suspend(CoHandle handle) noexcept
+		{
+			CoPromise *promise = &handle.promise();
+			promise->wake = signal.posted;
+			promise->next = signal.waiters;
+			signal.waiters = promise;
+			scheduler.watch(&signal);
+		}
+		void await_resume() const noexcept {}
+	};
+
+	WaitAwaiter wait(CoScheduler &scheduler) { return WaitAwaiter{*this, scheduler}; }
+
+private:
+	friend class CoScheduler;
+
+	volatile uint32_t posted = 0;
+	CoPromise *waiters = nullptr;
+	CoSignal *nextWatched = nullptr;
+	uint8_t watched = 0;
+};
+
+inline void CoScheduler::watch(CoSignal *signal)
+{
+	if(!signal->watched)
+	{
+		signal->nextWatched = signals;
+		signals = signal;
+		signal->watched = 1;
+	}
+}
+
+inline uint32_t CoScheduler::runOnce()
+{
+	uint32_t resumed = 0;
+	uint32_t tick = now();
+
+	while(delayed != nullptr && (int32_t)(delayed->wake - tick) <= 0)
+	{
+		CoPromise *promise = delayed;
+		delayed = promise->next;
+		makeReady(promise);
+	}
+
+	for(CoSignal *signal = signals; signal != nullptr; signal = signal->nextWatched)
+	{
+		uint32_t posted = signal->posted;
+		CoPromise **link = &signal->waiters;
+		while(*link != nullptr)
+		{
+			CoPromise *promise = *link;
+			if(promise->wake != posted)
+			{
+				*link = promise->next;
+				makeReady(promise);
+			}
+			else
+			{
+				link = &promise->next;
+			}
+		}
+	}
+
+	CoPromise *last = readyTail;					// tasks made ready while resuming wait for the next pass
+	while(readyHead != nullptr)
+	{
+		CoPromise *promise = readyHead;
+		readyHead = promise->next;
+		if(readyHead == nullptr) readyTail = nullptr;
+
+		CoHandle handle = CoHandle::from_promise(*promise);
+		handle.resume();
+		resumed++;
+		if(handle.done())
+		{
+			handle.destroy();
+			tasks--;
+		}
+		if(promise == last)
+		{
+			break;
+		}
+	}
+
+	return resumed;
+}
+
+} // namespace os
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef __OS_EVENT__
+#define __OS_EVENT__
+
+/*
+ * Event flag groups: 32 flags a thread can wait for, any one of a mask or all of them, e.g. new sensor data:
+ *
+ *   osEventType sensorEvents;					// osEventInit(&sensorEvents) before osKernelLaunch
+ *
+ *   osEventSet(&sensorEvents, LEVEL_READY);	// sensor thread, or osEventSetFromISR in its interrupt
+ *
+ *   flags = osEventWait(&sensorEvents, LEVEL_READY | FLOW_READY, OS_EVENT_ANY, 1, OS_WAIT_FOREVER);	// control thread
+ *
+ * The waiting thread does not run until its condition holds or its timeout quanta expire, no polling.
+ * A set checks every waiter in one pass and readies all whose condition holds; the flags they asked to clear are
+ * cleared after the pass, so waiters woken by the same set all see them. A woken thread of higher priority than
+ * the running one runs at once. Threads only, except osEventSetFromISR, osEventClear and osEventGet.
+ */
+
+#include "osKernel.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define OS_EVENT_ANY			0				// one flag of the mask is enough
+#define OS_EVENT_ALL			1				// every flag of the mask
+
+typedef struct osEvent{
+	volatile uint32_t flags;
+	struct osEventWaiter *waiters;				// on the stacks of the waiting threads, highest priority first
+} osEventType;
+
+void osEventInit(osEventType *event);
+void osEventSet(osEventType *event, uint32_t flags);
+void osEventSetFromISR(osEventType *event, uint32_t flags);
+uint32_t osEventClear(osEventType *event, uint32_t flags);
+uint32_t osEventGet(osEventType *event);
+uint32_t osEventWait(osEventType *event, uint32_t mask, uint8_t mode, uint8_t clear, uint32_t timeout);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
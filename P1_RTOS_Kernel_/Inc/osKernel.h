@@ -1,13 +1,158 @@
 #ifndef __OS_KERNEL__
 #define __OS_KERNEL__
 
+// Also included by osKernelAssembly.s: the assembler only sees the macros
+#ifndef __ASSEMBLER__
 #include <stdint.h>
+#include <stddef.h>
 #include "stm32f4xx.h"
+#endif
+
+// 1: PendSV_Handler selects the next thread inline in assembly, 0: it calls osScheduler (C), same decision
+#ifndef OS_SCHEDULER_ASM
+#define OS_SCHEDULER_ASM	1
+#endif
+
+// 1: weighted fair scheduling, among equal priorities the ready thread with the least virtual runtime runs
+// (CPU cycles divided by its weight, osThreadSetWeight). 0: round robin. Always decided in C (osScheduler).
+#ifndef OS_SCHEDULER_FAIR
+#define OS_SCHEDULER_FAIR	0
+#endif
+#define OS_FAIR_SCALE		256					// maximum weight, virtual runtime = cycles * OS_FAIR_SCALE / weight
+
+// 1: tcbs, stacks and initial frames come from a compile time table (osStaticKernel.hpp), no osKernelAddThreads
+// or osThreadCreate. 0: built at run time from TCB_STACK.
+#ifndef OS_STATIC_THREADS
+#define OS_STATIC_THREADS	0
+#endif
+
+// 1: the hot paths (RAMFUNC, PendSV_Handler) run from SRAM. 0: they stay in flash, to compare the interrupt to
+// thread latency of both placements (main.c ADC_LATENCY_BENCHMARK)
+#ifndef OS_RAM_FUNCTIONS
+#define OS_RAM_FUNCTIONS	1
+#endif
+
+#ifndef NUM_OF_THREADS
+#define NUM_OF_THREADS		3					// each thread is going to be a tcb (see struct tcb), raise for osThreadCreate
+#endif
+#define STACKSIZE			400					// 100 X 32 bit values = 100 x 4 bytes = 400 bytes
+#define OS_IDLE_THREAD		NUM_OF_THREADS		// tcbs[OS_IDLE_THREAD] is the kernel idle thread, not on the ring
+#define IDLE_STACKSIZE		64					// idle thread: frame, WFI loop and osIdleHook
+
+#define OS_THREAD_READY		0
+#define OS_THREAD_BLOCKED		1				// waits for a mutex (osMutex.h), skipped by osScheduler
+#define OS_THREAD_WAITING		2				// waits for notification bits, a queue (osQueue.h) or its timeout, skipped by osScheduler
+#define OS_THREAD_JOINING		3				// waits in osThreadJoin for a thread to exit
+#define OS_THREAD_EXITED		4				// returned or called osThreadExit, off the ring until joined
+#define OS_THREAD_FREE			5				// unused slot on the free list, osThreadCreate takes it
+
+#define OS_THREAD_NONE			0xFFFFFFFFU		// osThreadCreate: no free slot
+
+#define OS_WAIT_FOREVER			0xFFFFFFFFU		// timeout of osThreadNotifyWait
+
+// Byte offsets in struct tcb used by the assembly, checked against the struct in osKernel.c
+#define TCB_STACKPT			0
+#define TCB_NEXTPT			4
+#define TCB_PRIORITY		8
+#define TCB_STATE			16
+
+#ifndef __ASSEMBLER__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Kernel hot paths run from SRAM (.ramfunc, copied by the startup code) without flash wait states
+#if OS_RAM_FUNCTIONS
+#ifndef RAMFUNC
+#define RAMFUNC		__attribute__((section(".ramfunc"), noinline))
+#endif
+#else
+#define RAMFUNC
+#endif
+
+struct osMutex;
+
+struct tcb{										// create a thread control block (tcb)
+	int32_t *stackPt;							// must stay first: PendSV_Handler reads and writes [currentPt]
+	struct tcb *nextPt;
+	uint32_t priority;							// effective priority, higher runs first; raised by priority inheritance
+	uint32_t basePriority;						// priority set by osThreadSetPriority
+	uint32_t state;								// OS_THREAD_READY, _BLOCKED, _WAITING, _JOINING, _EXITED or _FREE
+	struct osMutex *blockedOn;					// mutex the thread waits for
+	struct tcb *nextWaiter;						// waiter list of that mutex or queue, highest priority first
+	struct osMutex *held;						// mutexes the thread owns
+	uint32_t notify;							// notification bits, set by osThreadNotify, taken by osThreadNotifyWait
+	uint32_t notifyMask;						// bits that end the wait
+	uint32_t waitTicks;							// quanta left until the wait times out, OS_WAIT_FOREVER: none
+	uint32_t slice;								// quanta per turn (osThreadSetSlice), 1 by default
+	uint32_t sliceLeft;							// quanta left in the current turn
+	uint32_t fairFactor;						// OS_FAIR_SCALE / weight
+	uint64_t vruntime;							// weighted CPU cycles (OS_SCHEDULER_FAIR)
+	struct tcb *prevPt;							// ring backwards, for O(1) insert and remove
+	struct tcb *joiner;							// thread waiting in osThreadJoin for this one
+	struct tcb *nextFree;						// free list of unused tcbs (and their TCB_STACK rows)
+	int32_t *stackBase;							// lowest word of the thread stack, for osKernelCheck
+	uint32_t stackWords;						// size of the thread stack
+};
+
+typedef struct tcb tcbType;						// short alias for struct tcb type
+
+// Initial context at the top of a thread stack, as PendSV_Handler restores it: r4-r11, then the hardware frame.
+// 16 words on the target (checked in osKernel.c); osStaticKernel.hpp builds it with typed function pointers.
+typedef struct osStackFrame{
+	int32_t r4_r11[8];
+	int32_t r0_r3_r12[5];
+	void (*lr)(void);							// osThreadExit: a thread function that returns exits
+	void (*pc)(void);							// thread function
+	uint32_t xpsr;								// thumb bit
+} osStackFrameType;
+
+extern tcbType tcbs[NUM_OF_THREADS + 1];
+extern tcbType *currentPt;
+extern tcbType *const osIdlePt;					// &tcbs[OS_IDLE_THREAD], for the assembly
+#if !OS_STATIC_THREADS
+extern int32_t TCB_STACK[NUM_OF_THREADS][STACKSIZE];
+#endif
 
 void osKernelInit(void);
 void osKernelLaunch(uint32_t quanta);
+#if !OS_STATIC_THREADS
 uint8_t osKernelAddThreads(void (*task0)(void), void (*task1)(void), void (*task2)(void));
+#endif
+uint8_t osKernelCheck(void);
+uint32_t osKernelGetTick(void);
+uint64_t osKernelIdleCycles(void);
+uint32_t osKernelCpuLoad(void);
+void osIdleHook(void);							// weak, override to add work or a deeper sleep mode before WFI
+void osIdleThread(void);						// function of tcbs[OS_IDLE_THREAD]
 
 void osThreadYield(void);
+void osThreadSetPriority(uint32_t thread, uint32_t priority);
+void osThreadSetSlice(uint32_t thread, uint32_t quanta);
+void osThreadSetWeight(uint32_t thread, uint32_t weight);
+uint32_t osThreadGetId(void);
+
+// Threads on demand: tcb and stack come from the free list, no allocation. A thread ends by returning from its
+// function or by osThreadExit; its slot is reused after osThreadJoin. Threads must not exit holding a mutex.
+#if !OS_STATIC_THREADS
+uint32_t osThreadCreate(void (*task)(void), uint32_t priority);
+#endif
+void osThreadExit(void);
+uint8_t osThreadJoin(uint32_t thread);
+
+// Per thread notification word: an interrupt or a thread wakes one thread without a semaphore object
+void osThreadNotify(uint32_t thread, uint32_t bits);
+void osThreadNotifyFromISR(uint32_t thread, uint32_t bits);
+uint32_t osThreadNotifyWait(uint32_t mask, uint32_t timeout);
+
+// Kernel internal: switch without restarting the quanta, for the waiting loops of the blocking calls
+void osKernelSwitch(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __ASSEMBLER__ */
 
 #endif
@@ -0,0 +1,46 @@
+#ifndef __OS_MUTEX__
+#define __OS_MUTEX__
+
+/*
+ * Kernel mutexes with owner tracking and priority inheritance, e.g. for the UART shared by the threads:
+ *
+ *   osMutexType uartMutex;						// osMutexInit(&uartMutex) before osKernelLaunch
+ *
+ *   osMutexLock(&uartMutex);
+ *   ... print ...
+ *   osMutexUnlock(&uartMutex);
+ *
+ * Uncontended, lock and unlock are one exclusive load/store on the owner word and never enter the kernel
+ * (no interrupt disable, no SysTick/PendSV). A thread that finds the mutex owned blocks: it is queued by priority
+ * and the owner, and the owner of the mutex that owner waits for and so on, inherit its priority until they unlock.
+ * A higher priority thread therefore waits at most for the critical sections of the lower priority owners,
+ * never for unrelated threads of medium priority.
+ * Unlock hands the mutex to the first waiter. Not recursive, threads only (not from interrupts).
+ */
+
+#include "osKernel.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef OS_MUTEX_PRIORITY_INHERITANCE
+#define OS_MUTEX_PRIORITY_INHERITANCE	1		// 0: waiters are still queued by priority, owners keep their priority
+#endif
+
+typedef struct osMutex{
+	volatile uintptr_t owner;					// tcb of the owner, 0 if free; bit 0 set while threads wait
+	tcbType *waiters;							// blocked threads, highest priority first, FIFO among equals
+	struct osMutex *nextHeld;					// next mutex held by the same owner
+} osMutexType;
+
+void osMutexInit(osMutexType *mutex);
+void osMutexLock(osMutexType *mutex);
+uint8_t osMutexTryLock(osMutexType *mutex);
+void osMutexUnlock(osMutexType *mutex);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
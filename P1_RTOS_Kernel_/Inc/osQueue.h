@@ -0,0 +1,49 @@
+#ifndef __OS_QUEUE__
+#define __OS_QUEUE__
+
+/*
+ * Kernel message queues of fixed size items, e.g. samples from the reading thread to the processing thread:
+ *
+ *   static uint32_t sampleBuffer[64];
+ *   osQueueType samples;						// osQueueInit(&samples, sampleBuffer, sizeof(uint32_t), 64)
+ *
+ *   osQueueSend(&samples, &value, OS_WAIT_FOREVER);				// producer
+ *   n = osQueueReceiveBatch(&samples, block, 16, OS_WAIT_FOREVER);	// consumer: 1 to 16 samples at once
+ *
+ * Items are copied into and out of the ring buffer given to osQueueInit. Every call is one kernel entry (one
+ * critical section) whatever the number of items, so a batch of N costs the kernel overhead of one item.
+ * Interrupts stay disabled during the copy: keep batch * item size small against the interrupt latency budget.
+ * A sender waits while the queue is full, a receiver while it is empty, up to timeout quanta (0: do not wait,
+ * OS_WAIT_FOREVER); the waiters are queued by priority, FIFO among equals. A woken thread of higher priority runs
+ * at once. osQueueSendFromISR never waits. Threads only, except osQueueSendFromISR and osQueueCount.
+ */
+
+#include "osKernel.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct osQueue{
+	uint8_t *buffer;							// capacity * itemSize bytes
+	uint32_t itemSize;
+	uint32_t capacity;							// items
+	uint32_t head;								// next item to receive
+	volatile uint32_t count;					// items in the queue
+	tcbType *senders;							// threads waiting for space
+	tcbType *receivers;							// threads waiting for items
+} osQueueType;
+
+void osQueueInit(osQueueType *queue, void *buffer, uint32_t itemSize, uint32_t capacity);
+uint8_t osQueueSend(osQueueType *queue, const void *item, uint32_t timeout);
+uint8_t osQueueReceive(osQueueType *queue, void *item, uint32_t timeout);
+uint32_t osQueueSendBatch(osQueueType *queue, const void *items, uint32_t n, uint32_t timeout);
+uint32_t osQueueReceiveBatch(osQueueType *queue, void *items, uint32_t max, uint32_t timeout);
+uint32_t osQueueSendFromISR(osQueueType *queue, const void *items, uint32_t n);
+uint32_t osQueueCount(osQueueType *queue);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
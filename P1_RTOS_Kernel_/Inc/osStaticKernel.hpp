@@ -0,0 +1,131 @@
+#ifndef __OS_STATIC_KERNEL__
+#define __OS_STATIC_KERNEL__
+
+/*
+ * Thread table fixed at compile time (C++17).
+ *
+ * osKernelAddThreads builds the tcb ring, the stacks and their initial frames at run time. With OS_STATIC_THREADS
+ * the compiler builds them from a table instead: tcbs, stacks and frames are initialized data, the startup code
+ * copies them with the rest of .data and nothing runs between reset and osKernelLaunch but osKernelInit.
+ *
+ *   // every file is compiled with -DOS_STATIC_THREADS=1, NUM_OF_THREADS is the number of rows
+ *   constexpr os::ThreadConfig osThreads[] = {
+ *       {task0_read_sensor_data, 256, 1},		// function, stack words, priority; the ring follows the rows
+ *       {task1_process_sensor_data, 400, 0},
+ *       {task2_control_pump, 128, 0},
+ *   };
+ *   OS_STATIC_KERNEL(osThreads);				// in one C++ file, defines tcbs
+ *
+ *   int main(void) { osKernelInit(); osKernelLaunch(QUANTA); }
+ *
+ * A wrong table does not compile (static_assert): row count, missing function, stack below OS_STATIC_MIN_STACK or
+ * not a multiple of 8 bytes. Thread 0 runs first, every thread starts with slice 1 and weight 1 like
+ * osKernelAddThreads. The stacks move from .bss to .data: flash grows by their size.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include "osKernel.h"
+
+static_assert(OS_STATIC_THREADS, "osStaticKernel.hpp needs OS_STATIC_THREADS 1 for every file");
+
+#ifndef OS_STATIC_MIN_STACK
+#define OS_STATIC_MIN_STACK		64					// words: the initial frame and a few calls
+#endif
+
+namespace os {
+
+struct ThreadConfig
+{
+	void (*task)(void);
+	uint32_t stackWords;							// 32 bit words, the initial frame included
+	uint32_t priority;								// higher runs first, as osThreadSetPriority
+};
+
+namespace detail {
+
+/* A thread stack with its initial frame on top, where osKernelStackInit writes it */
+template<uint32_t Words>
+struct alignas(8) ThreadStack
+{
+	static_assert(Words >= OS_STATIC_MIN_STACK, "thread stack below OS_STATIC_MIN_STACK words");
+	static_assert(Words % 2 == 0, "thread stack must keep the 8 byte alignment of the frame");
+
+	int32_t free[Words - 16];
+	osStackFrameType frame;
+};
+
+constexpr int32_t fill = static_cast<int32_t>(0xAAAAAAAAu);	// r0-r12, as osKernelStackInit
+
+constexpr osStackFrameType initialFrame(void (*task)(void))
+{
+	return {{fill, fill, fill, fill, fill, fill, fill, fill}, {fill, fill, fill, fill, fill}, osThreadExit, task, 1U<<24};
+}
+
+template<const auto &Table, std::size_t I>
+inline ThreadStack<Table[I].stackWords> threadStack = {{}, initialFrame(Table[I].task)};
+
+inline ThreadStack<IDLE_STACKSIZE> idleStack = {{}, initialFrame(osIdleThread)};
+
+/* The fields osKernelStackInit sets, the links given */
+template<uint32_t Words>
+constexpr tcbType makeTcb(ThreadStack<Words> &stack, uint32_t priority, tcbType *next, tcbType *prev)
+{
+	tcbType t{};
+
+	t.stackPt = &stack.frame.r4_r11[0];
+	t.nextPt = next;
+	t.prevPt = prev;
+	t.priority = priority;
+	t.basePriority = priority;
+	t.state = OS_THREAD_READY;
+	t.waitTicks = OS_WAIT_FOREVER;
+	t.slice = 1;
+	t.sliceLeft = 1;
+	t.fairFactor = OS_FAIR_SCALE;
+	t.stackBase = &stack.free[0];
+	t.stackWords = sizeof(stack) / sizeof(int32_t);
+	return t;
+}
+
+/* Row I of the table: ring I -> I + 1, back to 0 after the last row */
+template<const auto &Table, std::size_t I>
+constexpr tcbType threadTcb()
+{
+	static_assert(Table[I].task != nullptr, "thread without a function");
+
+	return makeTcb(threadStack<Table, I>, Table[I].priority, &tcbs[(I + 1) % NUM_OF_THREADS],
+				   &tcbs[(I + NUM_OF_THREADS - 1) % NUM_OF_THREADS]);
+}
+
+/* The idle thread is not on the ring, it continues at thread 0 */
+template<const auto &Table>
+constexpr tcbType idleTcb()
+{
+	static_assert(std::extent_v<std::remove_reference_t<decltype(Table)>> == NUM_OF_THREADS,
+				  "the thread table needs NUM_OF_THREADS rows");
+
+	return makeTcb(idleStack, 0, &tcbs[0], nullptr);
+}
+
+} // namespace detail
+} // namespace os
+
+// One initializer per row, NUM_OF_THREADS must be a plain number; add a line for more threads
+#define OS_STATIC_TCBS_1(t)		::os::detail::threadTcb<t, 0>(),
+#define OS_STATIC_TCBS_2(t)		OS_STATIC_TCBS_1(t) ::os::detail::threadTcb<t, 1>(),
+#define OS_STATIC_TCBS_3(t)		OS_STATIC_TCBS_2(t) ::os::detail::threadTcb<t, 2>(),
+#define OS_STATIC_TCBS_4(t)		OS_STATIC_TCBS_3(t) ::os::detail::threadTcb<t, 3>(),
+#define OS_STATIC_TCBS_5(t)		OS_STATIC_TCBS_4(t) ::os::detail::threadTcb<t, 4>(),
+#define OS_STATIC_TCBS_6(t)		OS_STATIC_TCBS_5(t) ::os::detail::threadTcb<t, 5>(),
+#define OS_STATIC_TCBS_7(t)		OS_STATIC_TCBS_6(t) ::os::detail::threadTcb<t, 6>(),
+#define OS_STATIC_TCBS_8(t)		OS_STATIC_TCBS_7(t) ::os::detail::threadTcb<t, 7>(),
+#define OS_STATIC_CAT(a, b)		OS_STATIC_CAT_(a, b)
+#define OS_STATIC_CAT_(a, b)	a##b
+
+// Defines tcbs (C linkage, declared in osKernel.h) from the table; every initializer is a constant expression
+#define OS_STATIC_KERNEL(table) \
+	tcbType tcbs[NUM_OF_THREADS + 1] = {OS_STATIC_CAT(OS_STATIC_TCBS_, NUM_OF_THREADS)(table) ::os::detail::idleTcb<table>()}
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef __OS_TIMER__
+#define __OS_TIMER__
+
+/*
+ * Microsecond one-shot timers on TIM2, for deadlines finer than the SysTick quanta (milliseconds), e.g. valve timing:
+ *
+ *   osTimerInit();								// before osKernelLaunch
+ *
+ *   osTimerStart(350, valveClose);				// valveClose() runs in TIM2_IRQHandler 350 us from now
+ *   osTimerSleepUs(120);						// the calling thread waits 120 us
+ *
+ * TIM2 counts free running at 1 MHz over its full 32 bits. Pending timers wait in a queue sorted by expiry,
+ * compare channel 1 is set to the first one: one interrupt per expiry, none while the queue is empty.
+ * Callbacks run in TIM2_IRQHandler (OS_TIMER_IRQ_PRIORITY) with interrupts enabled; they may start timers again
+ * and call osThreadNotifyFromISR. A thread woken by osTimerSleepUs preempts lower priority threads at once.
+ * Timers come from a static pool of OS_TIMER_COUNT, no allocation. All functions may be called from threads
+ * and from interrupts. Resolution 1 us: a timer started during a microsecond fires up to 1 us early.
+ */
+
+#include "osKernel.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef OS_TIMER_COUNT
+#define OS_TIMER_COUNT			8				// timers pending at the same time, at most 254
+#endif
+#define OS_TIMER_IRQ_PRIORITY	5				// before the ADC (6) and SysTick
+#define OS_TIMER_MAX_US			0x7FFFFFFFU		// half the counter range, the comparison is wrap safe
+#define OS_TIMER_NONE			0xFFFFFFFFU		// osTimerStart: no free timer
+#define OS_TIMER_WAKE			(1U<<31)		// notification bit of osTimerSleepUs and osTimerStartNotify
+
+void osTimerInit(void);
+uint32_t osTimerNow(void);
+uint32_t osTimerStart(uint32_t us, void (*callback)(void));
+uint32_t osTimerStartNotify(uint32_t us, uint32_t thread);
+uint8_t osTimerStop(uint32_t timer);
+uint8_t osTimerSleepUs(uint32_t us);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
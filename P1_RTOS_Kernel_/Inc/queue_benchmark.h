@@ -0,0 +1,8 @@
+#ifndef __QUEUE_BENCHMARK_H__
+#define __QUEUE_BENCHMARK_H__
+
+#include <stdint.h>
+
+uint8_t queue_benchmark_add_threads(void);
+
+#endif
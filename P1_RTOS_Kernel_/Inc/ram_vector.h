@@ -0,0 +1,11 @@
+#ifndef RAM_VECTOR_H_
+#define RAM_VECTOR_H_
+
+#include <stdint.h>
+
+// Vector table in SRAM (.ram_vector, see STM32F401RETX_FLASH.ld): exception entry fetches the handler address
+// without flash wait states. Optional, main.c RAM_VECTOR_TABLE.
+void ram_vector_table_init(void);
+uint8_t ram_vector_table_active(void);
+
+#endif /* RAM_VECTOR_H_ */
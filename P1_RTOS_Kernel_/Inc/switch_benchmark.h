@@ -0,0 +1,8 @@
+#ifndef __SWITCH_BENCHMARK_H__
+#define __SWITCH_BENCHMARK_H__
+
+#include <stdint.h>
+
+uint8_t switch_benchmark_add_threads(void);
+
+#endif
@@ -0,0 +1,8 @@
+#ifndef __TIMER_BENCHMARK_H__
+#define __TIMER_BENCHMARK_H__
+
+#include <stdint.h>
+
+uint8_t timer_benchmark_add_threads(void);
+
+#endif
@@ -10,6 +10,9 @@
 #define CR2_SWSTART		(1U<<30)
 #define SR_EOC			(1U<<1)
 #define CR2_CONT		(1U<<1)
+#define CR1_EOCIE		(1U<<5)
+#define SMPR2_SMP1_480	(7U<<3)		// channel 1 sample time 480 ADC cycles, ~60 us per conversion
+#define ADC_IRQ_PRIORITY	6
 
 void pa1_adc_init()
 {
@@ -46,6 +49,35 @@ void pa1_adc_init()
 	start_conversion();
 }
 
+/* Interrupt mode: single conversions started by adc_start_single(), ADC_IRQHandler runs at end of conversion
+ * and reads the result with adc_result() (which clears EOC). The handler is defined by the application. */
+void pa1_adc_interrupt_init(void)
+{
+	RCC->AHB1ENR |= GPIOAEN;
+	GPIOA->MODER |= (1U<<2);
+	GPIOA->MODER |= (1U<<3);
+
+	RCC->APB2ENR |= ADC1EN;
+	ADC1->SQR3 = ADC_CH1;
+	ADC1->SQR1 = ADC_SEQ_LEN_1;
+	ADC1->SMPR2 |= SMPR2_SMP1_480;	// a sample every ~60 us instead of ~2 us, the thread woken per sample keeps up
+	ADC1->CR1 |= CR1_EOCIE;
+	ADC1->CR2 |= CR2_ADON;
+
+	NVIC_SetPriority(ADC_IRQn, ADC_IRQ_PRIORITY);
+	NVIC_EnableIRQ(ADC_IRQn);
+}
+
+void adc_start_single(void)
+{
+	ADC1->CR2 |= CR2_SWSTART;
+}
+
+uint32_t adc_result(void)
+{
+	return (ADC1->DR);
+}
+
 void start_conversion(void)
 {
 	// Enable continuous conversion
@@ -19,10 +19,35 @@
 #include "adc1.h"
 #include "gpio_out.h"
 #include "osKernel.h"
+#include "switch_benchmark.h"
+#include "timer_benchmark.h"
+#include "queue_benchmark.h"
+#include "ram_vector.h"
 
 // Declare Scheduling and Context Switching Parameters
 #define QUANTA 10
 
+// ADC_NOTIFY 1: the ADC end of conversion interrupt wakes task0 with a notification (osThreadNotifyFromISR),
+// task0 runs at priority 1 and sleeps between samples. 0: task0 polls the ADC in continuous mode.
+#define ADC_NOTIFY					1
+#define ADC_SAMPLE_READY			(1U<<0)		// notification bit of task0
+#define TASK0						0
+// ADC_LATENCY_BENCHMARK 1: task0 prints the ISR to thread latency every ADC_LATENCY_SAMPLES samples (ADC_NOTIFY 1),
+// with the placement of the hot paths and of the vector table. Flash against SRAM: build once with OS_RAM_FUNCTIONS 0
+// and once with 1 (-D for every file), each with RAM_VECTOR_TABLE 0 and 1.
+#define ADC_LATENCY_BENCHMARK		0
+#define ADC_LATENCY_SAMPLES			1000
+// RAM_VECTOR_TABLE 1: the vector table is copied to SRAM and VTOR points at it (ram_vector.c)
+#ifndef RAM_VECTOR_TABLE
+#define RAM_VECTOR_TABLE			0
+#endif
+// RUN_SWITCH_BENCHMARK 1: the threads of switch_benchmark.c replace the application (cycles per context switch)
+#define RUN_SWITCH_BENCHMARK		0
+// RUN_TIMER_BENCHMARK 1: the threads of timer_benchmark.c replace the application (wakeup error of osTimer.c)
+#define RUN_TIMER_BENCHMARK			0
+// RUN_QUEUE_BENCHMARK 1: the threads of queue_benchmark.c replace the application (cycles per queued item)
+#define RUN_QUEUE_BENCHMARK			0
+
 // Declare prototype functions for the threads
 void task0_read_sensor_data(void);			// function to read data from the real world
 void task1_process_sensor_data(void);		// function to process data
@@ -35,33 +60,89 @@ uint32_t level_sensor_signal;				// Sensor signal from 0 to 4096, because of 12
 uint32_t water_level_in_tank;				// Water level in tanks scaled from 0 to 1500 mm
 uint32_t pump_status = 0;					// Pump status, 0 = off, 1 = on
 const uint32_t MIN_WATER_LEVEL = 300;		// 300 mm
+volatile uint32_t adc_sample;				// Written by ADC_IRQHandler
+volatile uint32_t adc_isr_cycles;			// DWT cycle count at ADC_IRQHandler entry
 
 
 // RUN MAIN
 int main(void)
 {
 	// Initialize drivers
+#if RAM_VECTOR_TABLE
+	ram_vector_table_init();	// before the first interrupt is enabled
+#endif
 	uart2_tx_init();			// UART at PA2 (same as USB connector in Nucleo board) with baudrate 115200
+#if ADC_NOTIFY
+	pa1_adc_interrupt_init();	// ADC at PA1, end of conversion interrupt (latency in DWT cycles, enabled by osKernelInit)
+#else
 	pa1_adc_init();				// ADC at PA1
+#endif
 	GPIO_OUT_init();			// GPIO out at PA5
 
 	// 1. Initialize Kernel
 	osKernelInit();
 
 	// 2. Add threads
+#if RUN_SWITCH_BENCHMARK
+	switch_benchmark_add_threads();
+#elif RUN_TIMER_BENCHMARK
+	timer_benchmark_add_threads();
+#elif RUN_QUEUE_BENCHMARK
+	queue_benchmark_add_threads();
+#else
 	osKernelAddThreads(&task0_read_sensor_data, &task1_process_sensor_data, &task2_control_pump);
+#endif
+#if ADC_NOTIFY && !RUN_SWITCH_BENCHMARK && !RUN_TIMER_BENCHMARK && !RUN_QUEUE_BENCHMARK
+	osThreadSetPriority(TASK0, 1);		// woken by the ADC, runs before the other threads
+#endif
 
 	// 3. Set Round Robin time quanta
 	osKernelLaunch(QUANTA);
 
 	while(1)
 	{
-		// EMPTY! (The magic of the osKernel)
+		// Never reached: osKernelLaunch starts the threads, the kernel idle thread (WFI) runs when none is ready
 	}
 }
 
 
 // Define the functions for the threads
+#if ADC_NOTIFY
+void task0_read_sensor_data(void)
+{
+	uint32_t latency, latency_sum = 0, latency_max = 0, samples = 0;
+
+	while(1)
+	{
+		Act_Task0++;
+		adc_start_single();
+		osThreadNotifyWait(ADC_SAMPLE_READY, OS_WAIT_FOREVER);		// the other threads run during the conversion
+		latency = DWT->CYCCNT - adc_isr_cycles;
+		level_sensor_signal = adc_sample;							// Read data from sensor
+
+		if(ADC_LATENCY_BENCHMARK)
+		{
+			latency_sum += latency;
+			if(latency > latency_max) latency_max = latency;
+			if(++samples == ADC_LATENCY_SAMPLES)
+			{
+				printf("adc_notify_latency,%s,%s,%lu,%lu,%lu,cycles\n\r", OS_RAM_FUNCTIONS ? "sram" : "flash",
+					   ram_vector_table_active() ? "sram" : "flash", (unsigned long)samples,
+					   (unsigned long)(latency_sum / samples), (unsigned long)latency_max);
+				latency_sum = latency_max = samples = 0;
+			}
+		}
+	}
+}
+
+// End of conversion: wakes task0, which preempts the running thread when this handler returns
+RAMFUNC void ADC_IRQHandler(void)
+{
+	adc_isr_cycles = DWT->CYCCNT;
+	adc_sample = adc_result();										// Reading DR clears EOC
+	osThreadNotifyFromISR(TASK0, ADC_SAMPLE_READY);
+}
+#else
 void task0_read_sensor_data(void)
 {
 	while(1)
@@ -71,6 +152,7 @@ void task0_read_sensor_data(void)
 		osThreadYield();											// Exit thread once read to save resources
 	}
 }
+#endif
 
 void task1_process_sensor_data(void)
 {
@@ -0,0 +1,174 @@
+/* Main idea:
+ * A waiting thread links a waiter record on its own stack into the group: mask, mode and clear stay with the wait,
+ * the tcb only gets OS_THREAD_WAITING and the timeout (counted down by SysTick_Handler).
+ * A set walks the waiter list once with interrupts disabled, readies every thread whose condition holds and hands it
+ * the flags it waited for, then clears the union of what they asked to clear.
+ *
+ */
+
+#include "osEvent.h"
+
+typedef struct osEventWaiter{
+	tcbType *thread;
+	uint32_t mask;
+	uint8_t mode;
+	uint8_t clear;
+	uint32_t result;							// flags of the mask at the wakeup, 0 while waiting
+	struct osEventWaiter *next;
+} osEventWaiterType;
+
+static uint8_t osEventSetLocked(osEventType *event, uint32_t flags);
+static uint32_t osEventMatch(uint32_t flags, uint32_t mask, uint8_t mode);
+
+
+void osEventInit(osEventType *event)
+{
+	event->flags = 0;
+	event->waiters = NULL;
+}
+
+void osEventSet(osEventType *event, uint32_t flags)
+{
+	uint8_t preempt;
+
+	__disable_irq();
+	preempt = osEventSetLocked(event, flags);
+	__enable_irq();
+	if(preempt)
+	{
+		osThreadYield();
+	}
+}
+
+// From an interrupt handler: the switch happens in PendSV, when the handler returns
+RAMFUNC void osEventSetFromISR(osEventType *event, uint32_t flags)
+{
+	uint32_t primask = __get_PRIMASK();
+
+	__disable_irq();
+	if(osEventSetLocked(event, flags))
+	{
+		SCB->ICSR = SCB_ICSR_PENDSVSET_Msk;
+	}
+	__set_PRIMASK(primask);
+}
+
+// Returns the flags before the clear
+uint32_t osEventClear(osEventType *event, uint32_t flags)
+{
+	uint32_t primask = __get_PRIMASK();
+	uint32_t previous;
+
+	__disable_irq();
+	previous = event->flags;
+	event->flags = previous & ~flags;
+	__set_PRIMASK(primask);
+
+	return previous;
+}
+
+uint32_t osEventGet(osEventType *event)
+{
+	return event->flags;
+}
+
+// Wait until one (OS_EVENT_ANY) or all (OS_EVENT_ALL) flags of mask are set, or timeout quanta expired (0: poll).
+// Returns the flags of the mask that were set, 0 on timeout. clear 1: clears the flags of the mask.
+uint32_t osEventWait(osEventType *event, uint32_t mask, uint8_t mode, uint8_t clear, uint32_t timeout)
+{
+	tcbType *self = currentPt;
+	osEventWaiterType waiter;
+	osEventWaiterType **link = &event->waiters;
+	uint32_t result;
+
+	__disable_irq();
+	result = osEventMatch(event->flags, mask, mode);
+	if(result != 0 || timeout == 0)
+	{
+		if(result != 0 && clear)
+		{
+			event->flags &= ~mask;
+		}
+		__enable_irq();
+		return result;
+	}
+
+	waiter.thread = self;
+	waiter.mask = mask;
+	waiter.mode = mode;
+	waiter.clear = clear;
+	waiter.result = 0;
+	while(*link != NULL && (*link)->thread->priority >= self->priority)
+	{
+		link = &(*link)->next;						// FIFO among equal priorities
+	}
+	waiter.next = *link;
+	*link = &waiter;
+	self->notifyMask = 0;							// notifications do not end this wait
+	self->waitTicks = timeout;
+	self->state = OS_THREAD_WAITING;
+	__enable_irq();
+
+	while(self->state == OS_THREAD_WAITING)
+	{
+		osKernelSwitch();							// osScheduler skips this thread until set or timed out
+	}
+
+	__disable_irq();
+	if(waiter.result == 0)							// timed out: still on the list
+	{
+		for(link = &event->waiters; *link != &waiter; link = &(*link)->next)
+		{
+		}
+		*link = waiter.next;
+	}
+	self->waitTicks = OS_WAIT_FOREVER;
+	__enable_irq();
+
+	return waiter.result;
+}
+
+/*** set, interrupts disabled */
+
+// One pass over the waiters. Returns 1 if a woken thread should preempt the running one.
+static uint8_t osEventSetLocked(osEventType *event, uint32_t flags)
+{
+	osEventWaiterType **link = &event->waiters;
+	osEventWaiterType *waiter;
+	uint32_t clear = 0;
+	uint8_t preempt = 0;
+
+	event->flags |= flags;
+	while(*link != NULL)
+	{
+		waiter = *link;
+		waiter->result = osEventMatch(event->flags, waiter->mask, waiter->mode);
+		if(waiter->result == 0)
+		{
+			link = &waiter->next;
+			continue;
+		}
+		*link = waiter->next;
+		if(waiter->clear)
+		{
+			clear |= waiter->mask;
+		}
+		waiter->thread->state = OS_THREAD_READY;
+		if(waiter->thread->priority > currentPt->priority || currentPt == &tcbs[OS_IDLE_THREAD])
+		{
+			preempt = 1;
+		}
+	}
+	event->flags &= ~clear;
+
+	return preempt;
+}
+
+static uint32_t osEventMatch(uint32_t flags, uint32_t mask, uint8_t mode)
+{
+	if(mode == OS_EVENT_ALL)
+	{
+		return (flags & mask) == mask ? mask : 0;
+	}
+	return flags & mask;
+}
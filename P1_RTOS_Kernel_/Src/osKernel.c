@@ -5,8 +5,6 @@
 
 #include "osKernel.h"
 
-#define NUM_OF_THREADS		3					// each thread is going to be a tcb (see struct tcb)
-#define STACKSIZE			400					// 100 X 32 bit values = 100 x 4 bytes = 400 bytes
 #define BUS_FREQ			16000000
 
 #define CTRL_ENABLE			(1U<<0)
@@ -14,27 +12,53 @@
 #define CTRL_CLKSRC 		(1U<<2)
 #define CTRL_COUNTFLAG 		(1U<<16)
 
-#define INTCTRL				(*(volatile uint32_t *)0xE000ED04)
-
 #define	PERIOD				100
 
 uint32_t MILLIS_PRESCALER;
 extern void osSchedulerLaunch(void);
 
+#if OS_STATIC_THREADS
+// tcbs, their stacks and frames are defined by OS_STATIC_KERNEL (osStaticKernel.hpp), task 0 runs first
+tcbType	*currentPt = &tcbs[0];
+#else
+tcbType	tcbs[NUM_OF_THREADS + 1];				// define the thread control block array, the last one is the idle thread
 
-struct tcb{										// create a thread control block (tcb)
-	int32_t *stackPt;
-	struct tcb *nextPt;
-};
+tcbType	*currentPt;								// define current thread control block
+#endif
 
-typedef struct tcb tcbType;						// short alias for struct tcb type
+tcbType *const osIdlePt = &tcbs[OS_IDLE_THREAD];
 
-tcbType	tcbs[NUM_OF_THREADS];					// define the thread control block array
+#if UINTPTR_MAX == 0xFFFFFFFFu					// the assembly only exists on the 32 bit target
+_Static_assert(offsetof(tcbType, stackPt) == TCB_STACKPT, "TCB_STACKPT does not match struct tcb");
+_Static_assert(offsetof(tcbType, nextPt) == TCB_NEXTPT, "TCB_NEXTPT does not match struct tcb");
+_Static_assert(offsetof(tcbType, priority) == TCB_PRIORITY, "TCB_PRIORITY does not match struct tcb");
+_Static_assert(offsetof(tcbType, state) == TCB_STATE, "TCB_STATE does not match struct tcb");
+_Static_assert(sizeof(osStackFrameType) == 16 * sizeof(int32_t), "osStackFrameType is not the 16 word frame");
+_Static_assert(offsetof(osStackFrameType, pc) == 14 * sizeof(int32_t), "PC not where osKernelStackInit puts it");
+#endif
 
-tcbType	*currentPt;								// define current thread control block
+volatile uint32_t osTicks;						// expired quanta since launch
+static uint32_t osYieldCycles;					// SysTick cycles of the quanta cut short by osThreadYield, not ticked yet
 
+#if !OS_STATIC_THREADS
 int32_t TCB_STACK[NUM_OF_THREADS][STACKSIZE];	// define stack for threads
 
+int32_t IDLE_STACK[IDLE_STACKSIZE];				// stack of the idle thread
+#endif
+
+static uint64_t osIdleCycles;					// DWT cycles spent in WFI by the idle thread
+
+#if OS_SCHEDULER_FAIR
+static uint32_t osSwitchCycles;					// DWT cycles at the last decision
+static uint64_t osFairMin;						// virtual runtime of the last chosen thread, only grows
+#endif
+
+static tcbType *osFreePt;						// free list of tcbs, through nextFree
+
+#if !OS_STATIC_THREADS
+static uint32_t osThreadCreateLocked(void (*task)(void), uint32_t priority);
+#endif
+
 
 /*
  * x3 functions:
@@ -61,31 +85,51 @@ int32_t TCB_STACK[NUM_OF_THREADS][STACKSIZE];	// define stack for threads
  * R0
  */
 
+#if !OS_STATIC_THREADS
 void osKernelStackInit (int i)
 {
-	tcbs[i].stackPt = &TCB_STACK[i][STACKSIZE-16];	// Stack Pointer
-
-	TCB_STACK[i][STACKSIZE-1] = (1U<<24);		// PSR: Program Status Register. Set PSR to 1 to operate in thumb mode
-
-
-	// TCB_STACK[i][STACKSIZE-2] =  0xAAAAAAAA;	// r15(PC): Program Counter -> Will be initialized in a different function
-
-	TCB_STACK[i][STACKSIZE-3] =  0xAAAAAAAA;	// r14(LR)
-	TCB_STACK[i][STACKSIZE-4] =  0xAAAAAAAA;	// r12
-	TCB_STACK[i][STACKSIZE-5] =  0xAAAAAAAA;	// r3
-	TCB_STACK[i][STACKSIZE-6] =  0xAAAAAAAA;	// r2
-	TCB_STACK[i][STACKSIZE-7] =  0xAAAAAAAA;	// r1
-	TCB_STACK[i][STACKSIZE-8] =  0xAAAAAAAA;	// r0
-
-	TCB_STACK[i][STACKSIZE-9] =  0xAAAAAAAA;	// r11
-	TCB_STACK[i][STACKSIZE-10] = 0xAAAAAAAA;	// r10
-	TCB_STACK[i][STACKSIZE-11] = 0xAAAAAAAA;	// r9
-	TCB_STACK[i][STACKSIZE-12] = 0xAAAAAAAA;	// r8
-	TCB_STACK[i][STACKSIZE-13] = 0xAAAAAAAA;	// r7
-	TCB_STACK[i][STACKSIZE-14] = 0xAAAAAAAA;	// r6
-	TCB_STACK[i][STACKSIZE-15] = 0xAAAAAAAA;	// r5
-	TCB_STACK[i][STACKSIZE-16] = 0xAAAAAAAA;	// r4
+	int32_t *top = (i == OS_IDLE_THREAD) ? &IDLE_STACK[IDLE_STACKSIZE] : &TCB_STACK[i][STACKSIZE];	// end of the thread stack
+
+	tcbs[i].stackPt = &top[-16];				// Stack Pointer
+	tcbs[i].priority = 0;						// all threads equal: plain round robin
+	tcbs[i].basePriority = 0;
+	tcbs[i].state = OS_THREAD_READY;
+	tcbs[i].blockedOn = NULL;
+	tcbs[i].nextWaiter = NULL;
+	tcbs[i].held = NULL;
+	tcbs[i].notify = 0;
+	tcbs[i].notifyMask = 0;
+	tcbs[i].waitTicks = OS_WAIT_FOREVER;
+	tcbs[i].slice = 1;							// one quanta per turn
+	tcbs[i].sliceLeft = 1;
+	tcbs[i].fairFactor = OS_FAIR_SCALE;			// weight 1
+	tcbs[i].vruntime = 0;
+	tcbs[i].joiner = NULL;
+	tcbs[i].stackBase = (i == OS_IDLE_THREAD) ? IDLE_STACK : TCB_STACK[i];
+	tcbs[i].stackWords = (i == OS_IDLE_THREAD) ? IDLE_STACKSIZE : STACKSIZE;
+
+	top[-1] =  (1U<<24);		// PSR: Program Status Register. Set PSR to 1 to operate in thumb mode
+
+
+	// top[-2] =  0xAAAAAAAA;	// r15(PC): Program Counter -> Will be initialized in a different function
+
+	top[-3] =  (int32_t)(uintptr_t)osThreadExit;	// r14(LR): a thread function that returns exits
+	top[-4] =  0xAAAAAAAA;	// r12
+	top[-5] =  0xAAAAAAAA;	// r3
+	top[-6] =  0xAAAAAAAA;	// r2
+	top[-7] =  0xAAAAAAAA;	// r1
+	top[-8] =  0xAAAAAAAA;	// r0
+
+	top[-9] =  0xAAAAAAAA;	// r11
+	top[-10] = 0xAAAAAAAA;	// r10
+	top[-11] = 0xAAAAAAAA;	// r9
+	top[-12] = 0xAAAAAAAA;	// r8
+	top[-13] = 0xAAAAAAAA;	// r7
+	top[-14] = 0xAAAAAAAA;	// r6
+	top[-15] = 0xAAAAAAAA;	// r5
+	top[-16] = 0xAAAAAAAA;	// r4
 }
+#endif
 
 /*
  * 1) initialize the kernel
@@ -96,33 +140,45 @@ void osKernelStackInit (int i)
 void osKernelInit(void)
 {
 	MILLIS_PRESCALER = (BUS_FREQ/1000);
+
+	// DWT cycle counter for the idle time
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CYCCNT = 0;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
 }
 
 /*
  * 2) add threads: os kernel add threads function
  * Return a flag
  * Pass address of the thread functions (x3 functions in our case)
+ * With OS_STATIC_THREADS the compiler has done this already: nothing runs before osKernelLaunch.
  */
 
+#if !OS_STATIC_THREADS
 uint8_t osKernelAddThreads(void (*task0)(void), void (*task1)(void), void (*task2)(void))
 {
 	// Disable global interrupts
 	__disable_irq();
 
-	// define the order or execution
-	tcbs[0].nextPt = &tcbs[1];	//after task 0 finishes its execution time (quanta), task 1 goes to running state
-	tcbs[1].nextPt = &tcbs[2];
-	tcbs[2].nextPt = &tcbs[0];
-
-	// initialize the stack for each thread and its PC (Program counter), which wasn't initialized in osKernelStackInit because we didn't have the PC there
-	osKernelStackInit(0);
-	TCB_STACK[0][STACKSIZE-2] = (int32_t)task0;
-
-	osKernelStackInit(1);
-	TCB_STACK[1][STACKSIZE-2] = (int32_t)task1;
-
-	osKernelStackInit(2);
-	TCB_STACK[2][STACKSIZE-2] = (int32_t)task2;
+	// every slot free, in order, so the three threads get tcbs 0, 1, 2
+	osFreePt = NULL;
+	for(int i = NUM_OF_THREADS - 1; i >= 0; i--)
+	{
+		tcbs[i].state = OS_THREAD_FREE;
+		tcbs[i].nextFree = osFreePt;
+		osFreePt = &tcbs[i];
+	}
+	currentPt = NULL;
+
+	// define the order or execution: each new thread goes to the end of the ring, task 0 -> task 1 -> task 2 -> task 0
+	osThreadCreateLocked(task0, 0);
+	osThreadCreateLocked(task1, 0);
+	osThreadCreateLocked(task2, 0);
+
+	// the idle thread runs when no thread is ready, it continues the ring where it was left
+	osKernelStackInit(OS_IDLE_THREAD);
+	IDLE_STACK[IDLE_STACKSIZE-2] = (int32_t)(uintptr_t)osIdleThread;
+	tcbs[OS_IDLE_THREAD].nextPt = &tcbs[0];
 
 	// Start from task 0
 	currentPt= &tcbs[0];
@@ -132,6 +188,7 @@ uint8_t osKernelAddThreads(void (*task0)(void), void (*task1)(void), void (*task
 
 	return 1;
 }
+#endif
 
 /*
  * 3) launch the kernel
@@ -145,6 +202,7 @@ void osKernelLaunch(uint32_t quanta)
 
 	// Clear systick by writing current value register
 	SysTick->VAL = 0;
+	osYieldCycles = 0;
 
 	// Load quanta
 	SysTick->LOAD = (quanta*MILLIS_PRESCALER)-1;
@@ -167,20 +225,508 @@ void osKernelLaunch(uint32_t quanta)
 // PendSV is an interrupt mode used by most RTOS to force a context switch if no other interrupt is active
 // Main advantage: it releases SysTick, to avoid missed ticks
 
-void SysTick_Handler(void)
+// A thread with a slice of several quanta keeps the CPU over the ticks in between, unless a timeout readied a thread
+RAMFUNC void SysTick_Handler(void)
 {
-	INTCTRL = 0x10000000;	// Trigger PendSV // PENDSVSET pend SV set
+	uint8_t woken = 0;
+	uint32_t expired = SysTick->CTRL & CTRL_COUNTFLAG;	// the quanta expired (reading clears the flag)
+	uint32_t period = SysTick->LOAD + 1;
+
+	// osThreadYield restarts the quanta: the parts the yields cut off add up to ticks too, or time would stop
+	// while the threads yield back to back
+	if(expired || osYieldCycles >= period)
+	{
+		if(!expired)
+		{
+			osYieldCycles -= period;
+		}
+		osTicks++;
+		for(int i = 0; i < NUM_OF_THREADS; i++)
+		{
+			if(tcbs[i].state == OS_THREAD_WAITING && tcbs[i].waitTicks != OS_WAIT_FOREVER && --tcbs[i].waitTicks == 0)
+			{
+				tcbs[i].state = OS_THREAD_READY;	// timed out
+				woken = 1;
+			}
+		}
+		if(expired && currentPt->sliceLeft > 1 && !woken)
+		{
+			currentPt->sliceLeft--;
+			return;
+		}
+	}
+	currentPt->sliceLeft = currentPt->slice;	// a full slice on its next turn
+	SCB->ICSR = SCB_ICSR_PENDSVSET_Msk;	// Trigger PendSV // PENDSVSET pend SV set
 }
 
 // Inside the PendSV_Handler, the osScheduler is called
 // function to implement periodic scheduler WITH tcbs (thread control blocks)
-void osScheduler(void)
+// Round robin among the ready threads of the highest priority: the first of them after currentPt in the ring.
+// If no thread is ready the idle thread runs; its nextPt keeps the place in the ring.
+// PendSV_Handler makes the same decision inline unless OS_SCHEDULER_ASM is 0.
+// OS_SCHEDULER_FAIR: among the ready threads of the highest priority the one with the least virtual runtime.
+// A thread that was not ready for long is lifted to at most one quanta behind, so it cannot monopolize the CPU.
+RAMFUNC void osScheduler(void)
+{
+	tcbType *pt = currentPt->nextPt;
+	tcbType *next = pt;
+	int found = 0;
+
+#if OS_SCHEDULER_FAIR
+	uint32_t now = DWT->CYCCNT;
+	uint64_t lag = (uint64_t)(SysTick->LOAD + 1) * OS_FAIR_SCALE;
+
+	currentPt->vruntime += (uint64_t)(now - osSwitchCycles) * currentPt->fairFactor;
+	osSwitchCycles = now;
+#endif
+
+	for(int i = 0; i < NUM_OF_THREADS; i++)
+	{
+		if(pt->state == OS_THREAD_READY)
+		{
+#if OS_SCHEDULER_FAIR
+			if(pt->vruntime + lag < osFairMin)
+			{
+				pt->vruntime = osFairMin - lag;
+			}
+			if(!found || pt->priority > next->priority || (pt->priority == next->priority && pt->vruntime < next->vruntime))
+#else
+			if(!found || pt->priority > next->priority)
+#endif
+			{
+				next = pt;
+				found = 1;
+			}
+		}
+		pt = pt->nextPt;
+	}
+	if(!found)
+	{
+		tcbs[OS_IDLE_THREAD].nextPt = currentPt->nextPt;
+		next = &tcbs[OS_IDLE_THREAD];
+	}
+#if OS_SCHEDULER_FAIR
+	else if(next->vruntime > osFairMin)
+	{
+		osFairMin = next->vruntime;
+	}
+#endif
+	currentPt = next;					// Scheduler logic: go to next task in linked list
+}
+
+/*
+ * Idle thread: sleeps in WFI until the next interrupt. Interrupts are disabled around WFI so the cycles are
+ * stamped before the handler of the waking interrupt runs: osIdleCycles is the time really asleep.
+ * If that handler made a thread ready, the PendSV it pended switches away right after __enable_irq.
+ */
+void osIdleThread(void)
 {
-	currentPt = currentPt->nextPt;		// Scheduler logic: go to next task in linked list
+	uint32_t start;
+
+	while(1)
+	{
+		osIdleHook();
+		__disable_irq();
+		start = DWT->CYCCNT;
+		__WFI();
+		osIdleCycles += DWT->CYCCNT - start;
+		__enable_irq();
+	}
 }
 
+__attribute__((weak)) void osIdleHook(void)
+{
+}
+
+uint64_t osKernelIdleCycles(void)
+{
+	uint64_t cycles;
+
+	__disable_irq();
+	cycles = osIdleCycles;
+	__enable_irq();
+	return cycles;
+}
+
+// CPU load in per mille since the previous call, the calls must be less than 2^32 cycles (~268 s) apart
+uint32_t osKernelCpuLoad(void)
+{
+	static uint32_t lastCycles;
+	static uint64_t lastIdle;
+	uint32_t now, elapsed;
+	uint64_t idle;
+
+	__disable_irq();
+	now = DWT->CYCCNT;
+	idle = osIdleCycles;
+	__enable_irq();
+
+	elapsed = now - lastCycles;
+	idle -= lastIdle;
+	lastCycles = now;
+	lastIdle += idle;
+	if(elapsed == 0 || idle > elapsed)
+	{
+		return 0;
+	}
+	return 1000 - (uint32_t)(idle * 1000 / elapsed);
+}
+
+// Quanta expired since osKernelLaunch, the time base of the coroutines (osCoroutine.hpp)
+uint32_t osKernelGetTick(void)
+{
+	return osTicks;
+}
+
+// Give the rest of the quanta to the next thread. The next thread gets a full quanta (VAL cleared), the cycles this
+// one used are kept in osYieldCycles so that the tick still comes on time.
 void osThreadYield(void)
 {
+	uint32_t primask = __get_PRIMASK();
+	uint32_t val;
+
+	__disable_irq();
+	val = SysTick->VAL;
+	if(SysTick->CTRL & CTRL_COUNTFLAG)	// expired meanwhile, reading cleared the flag: the tick is counted here
+	{
+		osYieldCycles += SysTick->LOAD + 1;
+		val = SysTick->VAL;
+	}
+	if(val != 0)						// 0: nothing used since the quanta started
+	{
+		osYieldCycles += SysTick->LOAD - val;
+	}
 	SysTick->VAL = 0;
-	INTCTRL = 0x04000000; 				// Trigger Systick, i.e. PENDSTSET pend ST set
+	SCB->ICSR = SCB_ICSR_PENDSTSET_Msk;	// Trigger Systick, i.e. PENDSTSET pend ST set
+	__set_PRIMASK(primask);
+	__DSB();
+	__ISB();							// SysTick is taken here, before the caller checks what it waited for
+}
+
+// Pend PendSV only: the quanta keeps running and the next thread gets the rest of it, unlike osThreadYield
+void osKernelSwitch(void)
+{
+	SCB->ICSR = SCB_ICSR_PENDSVSET_Msk;
+	__DSB();
+	__ISB();
+}
+
+// Base priority of a thread, 0 (default) is the lowest. The thread switches at the next tick or yield.
+void osThreadSetPriority(uint32_t thread, uint32_t priority)
+{
+	__disable_irq();
+	tcbType *pt = &tcbs[thread];
+	if(pt->priority == pt->basePriority || priority > pt->priority)
+	{
+		pt->priority = priority;		// an inherited priority above the new base stays until the mutex is released
+	}
+	pt->basePriority = priority;
+	__enable_irq();
+}
+
+// Quanta the thread may run per turn before the next one of its priority (or of the least virtual runtime) runs
+void osThreadSetSlice(uint32_t thread, uint32_t quanta)
+{
+	__disable_irq();
+	tcbs[thread].slice = quanta ? quanta : 1;
+	tcbs[thread].sliceLeft = tcbs[thread].slice;
+	__enable_irq();
+}
+
+// Share of the CPU among the threads of its priority in OS_SCHEDULER_FAIR mode, 1 (default) to OS_FAIR_SCALE
+void osThreadSetWeight(uint32_t thread, uint32_t weight)
+{
+	if(weight == 0) weight = 1;
+	if(weight > OS_FAIR_SCALE) weight = OS_FAIR_SCALE;
+	tcbs[thread].fairFactor = OS_FAIR_SCALE / weight;
+}
+
+/*
+ * Threads on demand
+ */
+
+#if !OS_STATIC_THREADS
+// Interrupts disabled. Free slot -> initial frame -> end of the ring (before currentPt), O(1).
+static uint32_t osThreadCreateLocked(void (*task)(void), uint32_t priority)
+{
+	tcbType *pt = osFreePt;
+	tcbType *anchor;
+	int i;
+
+	if(pt == NULL)
+	{
+		return OS_THREAD_NONE;
+	}
+	osFreePt = pt->nextFree;
+	pt->nextFree = NULL;
+
+	i = pt - tcbs;
+	osKernelStackInit(i);
+	TCB_STACK[i][STACKSIZE-2] = (int32_t)(uintptr_t)task;		// 32 bit address on target
+	pt->priority = priority;
+	pt->basePriority = priority;
+
+	anchor = (currentPt == &tcbs[OS_IDLE_THREAD]) ? currentPt->nextPt : currentPt;
+	if(anchor == NULL || anchor->state == OS_THREAD_EXITED || anchor->state == OS_THREAD_FREE)
+	{
+		pt->nextPt = pt;						// empty ring: the first thread, or every other one exited
+		pt->prevPt = pt;
+		if(currentPt == NULL)
+		{
+			currentPt = pt;
+		}
+		else
+		{
+			tcbs[OS_IDLE_THREAD].nextPt = pt;	// the idle thread runs, it continues here
+		}
+	}
+	else
+	{
+		pt->nextPt = anchor;
+		pt->prevPt = anchor->prevPt;
+		anchor->prevPt->nextPt = pt;
+		anchor->prevPt = pt;
+	}
+	return i;
+}
+
+// Start a thread, returns its number or OS_THREAD_NONE. A higher priority than the caller's runs at once.
+uint32_t osThreadCreate(void (*task)(void), uint32_t priority)
+{
+	uint32_t thread;
+	uint8_t preempt;
+
+	__disable_irq();
+	thread = osThreadCreateLocked(task, priority);
+	preempt = thread != OS_THREAD_NONE && priority > currentPt->priority;
+	__enable_irq();
+	if(preempt)
+	{
+		osThreadYield();
+	}
+	return thread;
+}
+#endif
+
+// End the calling thread, also reached by returning from the thread function (initial LR)
+void osThreadExit(void)
+{
+	tcbType *self;
+
+	__disable_irq();
+	self = currentPt;
+	self->prevPt->nextPt = self->nextPt;		// off the ring; its nextPt stays for the scheduler
+	self->nextPt->prevPt = self->prevPt;
+	self->state = OS_THREAD_EXITED;
+	if(self->joiner != NULL)
+	{
+		self->joiner->state = OS_THREAD_READY;
+	}
+	SCB->ICSR = SCB_ICSR_PENDSVSET_Msk;
+	__enable_irq();								// PendSV switches away for good
+
+	while(1)
+	{
+	}
+}
+
+// Wait until the thread exited, then return its tcb and stack to the free list.
+// Returns 0 if there is nothing to join: no thread slot (OS_THREAD_NONE, the idle thread), a free slot, the caller
+// itself, or a thread another one already joins.
+uint8_t osThreadJoin(uint32_t thread)
+{
+	tcbType *pt;
+	tcbType *self = currentPt;
+
+	if(thread >= NUM_OF_THREADS)				// OS_IDLE_THREAD is NUM_OF_THREADS, it never exits
+	{
+		return 0;
+	}
+	pt = &tcbs[thread];
+
+	__disable_irq();
+	if(pt == self || pt->state == OS_THREAD_FREE || pt->joiner != NULL)
+	{
+		__enable_irq();
+		return 0;
+	}
+	if(pt->state != OS_THREAD_EXITED)
+	{
+		pt->joiner = self;
+		self->state = OS_THREAD_JOINING;
+		__enable_irq();
+		while(self->state == OS_THREAD_JOINING)
+		{
+			osKernelSwitch();					// osScheduler skips this thread until the other one exits
+		}
+		__disable_irq();
+	}
+	pt->joiner = NULL;
+	pt->state = OS_THREAD_FREE;
+	pt->nextFree = osFreePt;
+	osFreePt = pt;
+	__enable_irq();
+
+	return 1;
+}
+
+uint32_t osThreadGetId(void)
+{
+	return currentPt - tcbs;
+}
+
+/*
+ * Notifications: bits are or-ed into the word of the thread, the wait takes (clears) the bits of its mask.
+ * Bits sent before the wait are not lost. A woken thread of higher priority than the running one runs at once.
+ */
+
+// Interrupts disabled. Returns 1 if a thread of higher priority than the running one became ready.
+static uint8_t osThreadNotifySet(uint32_t thread, uint32_t bits)
+{
+	tcbType *pt = &tcbs[thread];
+
+	pt->notify |= bits;
+	if(pt->state == OS_THREAD_WAITING && (pt->notify & pt->notifyMask))
+	{
+		pt->state = OS_THREAD_READY;
+		return pt->priority > currentPt->priority || currentPt == &tcbs[OS_IDLE_THREAD];
+	}
+	return 0;
+}
+
+void osThreadNotify(uint32_t thread, uint32_t bits)
+{
+	uint8_t preempt;
+
+	__disable_irq();
+	preempt = osThreadNotifySet(thread, bits);
+	__enable_irq();
+	if(preempt)
+	{
+		osThreadYield();
+	}
+}
+
+// From an interrupt handler: the switch happens in PendSV, when the handler returns
+RAMFUNC void osThreadNotifyFromISR(uint32_t thread, uint32_t bits)
+{
+	uint32_t primask = __get_PRIMASK();
+
+	__disable_irq();
+	if(osThreadNotifySet(thread, bits))
+	{
+		SCB->ICSR = SCB_ICSR_PENDSVSET_Msk;
+	}
+	__set_PRIMASK(primask);
+}
+
+// Wait until one of the mask bits is set or timeout quanta expired (the first quanta may be partial), 0: poll.
+// Returns the bits of the mask that were set and clears them, 0 on timeout.
+uint32_t osThreadNotifyWait(uint32_t mask, uint32_t timeout)
+{
+	tcbType *self = currentPt;
+	uint32_t bits;
+
+	__disable_irq();
+	if(!(self->notify & mask) && timeout != 0)
+	{
+		self->notifyMask = mask;
+		self->waitTicks = timeout;
+		self->state = OS_THREAD_WAITING;
+		__enable_irq();
+		while(self->state == OS_THREAD_WAITING)
+		{
+			osKernelSwitch();			// osScheduler skips this thread until notified or timed out
+		}
+		__disable_irq();
+	}
+	bits = self->notify & mask;
+	self->notify &= ~bits;
+	__enable_irq();
+
+	return bits;
+}
+
+/*
+ * Consistency check of the kernel data, for the host simulator (Host/) and the debugger:
+ * the live tcbs form one ring (both directions) that starts at currentPt, the free list holds the free slots,
+ * every saved stack pointer lies in its stack and the thread states agree with the mutex data (osMutex.h).
+ * Returns 1 if consistent.
+ */
+uint8_t osKernelCheck(void)
+{
+	tcbType *start, *pt;
+	uint8_t visited[NUM_OF_THREADS] = {0};
+	int i, index, live = 0, free = 0;
+
+	for(i = 0; i < NUM_OF_THREADS; i++)
+	{
+		if(tcbs[i].state == OS_THREAD_FREE)
+		{
+			free++;
+		}
+		else if(tcbs[i].state != OS_THREAD_EXITED)
+		{
+			live++;
+		}
+	}
+	for(pt = osFreePt, i = 0; pt != NULL; pt = pt->nextFree, i++)
+	{
+		if(pt < &tcbs[0] || pt > &tcbs[NUM_OF_THREADS-1] || pt->state != OS_THREAD_FREE || i >= free)
+		{
+			return 0;							// the free list holds exactly the free slots
+		}
+	}
+	if(i != free)
+	{
+		return 0;
+	}
+	if(live == 0)
+	{
+		return 1;
+	}
+
+	start = currentPt;
+	if(currentPt == &tcbs[OS_IDLE_THREAD] || currentPt->state == OS_THREAD_EXITED)
+	{
+		start = currentPt->nextPt;				// off the ring, the scheduler continues at its nextPt
+	}
+	pt = start;
+	for(i = 0; i < live; i++)
+	{
+		if(pt == NULL || pt < &tcbs[0] || pt > &tcbs[NUM_OF_THREADS-1])
+		{
+			return 0;							// left the tcb array
+		}
+		index = pt - tcbs;
+		if(visited[index])
+		{
+			return 0;							// ring shorter than the live threads
+		}
+		visited[index] = 1;
+		if(pt->nextPt->prevPt != pt)
+		{
+			return 0;
+		}
+		if(pt->stackPt < pt->stackBase || pt->stackPt > &pt->stackBase[pt->stackWords-16])
+		{
+			return 0;							// no room left for a full context frame
+		}
+		if(pt->state != OS_THREAD_READY && pt->state != OS_THREAD_BLOCKED && pt->state != OS_THREAD_WAITING &&
+		   pt->state != OS_THREAD_JOINING)
+		{
+			return 0;
+		}
+		if(pt->slice == 0 || pt->sliceLeft > pt->slice)
+		{
+			return 0;
+		}
+		if(pt->priority < pt->basePriority || (pt->state == OS_THREAD_BLOCKED) != (pt->blockedOn != NULL))
+		{
+			return 0;							// inheritance may only raise, a blocked thread waits for one mutex
+		}
+		pt = pt->nextPt;
+	}
+
+	return pt == start;
 }
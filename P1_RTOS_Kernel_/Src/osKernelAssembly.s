@@ -4,8 +4,12 @@
  * Includes:
  *   - PendSV_Handler: performs context switch
  *   - osSchedulerLaunch: starts the first thread
+ *
+ * Preprocessed (assembler-with-cpp): osKernel.h gives OS_SCHEDULER_ASM/_FAIR, the thread states and the tcb offsets.
  */
 
+#include "../Inc/osKernel.h"
+
     .syntax unified
     .cpu cortex-m4
     .fpu softvfp
@@ -15,17 +19,73 @@
     .align 4
 
     .extern currentPt           // defined in osKernel.c
+    .extern osIdlePt
     .global PendSV_Handler
     .global osSchedulerLaunch
     .global osScheduler
 
+#if OS_RAM_FUNCTIONS
+    .section .ramfunc.PendSV_Handler, "ax", %progbits		// runs from SRAM like osScheduler, see STM32F401RETX_FLASH.ld
+#else
+    .section .text.PendSV_Handler, "ax", %progbits
+#endif
+    .align 4
+
 
 /*
  * ---> PendSV_Handler
  * Called every quanta.
  * Saves current thread context (r4–r11), updates currentPt to next thread, and restores that thread’s context.
  * The CPU automatically saves r0–r3, r12, LR, PC, xPSR. No need to save them explicitly.
+ *
+ * OS_SCHEDULER_ASM 1 (and not OS_SCHEDULER_FAIR): the decision of osScheduler inline, without call and stack
+ * round trip. Interrupts are only disabled while the ring is read and currentPt is written; an interrupt that
+ * readies a thread meanwhile pends PendSV again. Saving and restoring registers runs with interrupts enabled
+ * (they stack on the same SP and unstack before PendSV continues).
+ *   R0 = &currentPt, R1 = currentPt, R2 = first candidate, R3 = candidate, R6 = best, R4 = its priority
 */
+#if OS_SCHEDULER_ASM && !OS_SCHEDULER_FAIR
+    .type PendSV_Handler, %function
+PendSV_Handler:
+    LDR     R0, =currentPt    	 // R0 = &currentPt
+    LDR     R1, [R0]          	 // R1 = currentPt
+    PUSH    {R4-R11}          	 // Save remaining registers onto current stack
+    STR     SP, [R1, #TCB_STACKPT]	// Save current SP into currentPt->stackPt
+
+    CPSID   I                 	 // Disable interrupts: the ring and currentPt
+    LDR     R2, [R1, #TCB_NEXTPT]	// start after currentPt, round robin among equals
+    MOV     R3, R2
+    MOVS    R6, #0              // no candidate yet
+1:
+    LDR     R5, [R3, #TCB_STATE]
+    CMP     R5, #OS_THREAD_READY
+    BNE     3f                  // blocked or waiting
+    LDR     R5, [R3, #TCB_PRIORITY]
+    CBZ     R6, 2f              // first ready thread
+    CMP     R5, R4
+    BLS     3f                  // only a strictly higher priority replaces the first one found
+2:
+    MOV     R6, R3
+    MOV     R4, R5
+3:
+    LDR     R3, [R3, #TCB_NEXTPT]
+    CMP     R3, R2
+    BNE     1b                  // once around the ring
+
+    CBNZ    R6, 4f
+    LDR     R6, =osIdlePt       // nothing ready: idle thread, continues the ring at the first candidate
+    LDR     R6, [R6]
+    STR     R2, [R6, #TCB_NEXTPT]
+4:
+    STR     R6, [R0]          	 // currentPt = next thread, stored once
+    CPSIE   I                 	 // Re-enable interrupts
+
+    LDR     SP, [R6, #TCB_STACKPT]	// SP = currentPt->stackPt (load next thread’s stack)
+    POP     {R4-R11}             // Restore R4–R11 from new thread stack
+    BX      LR                	 // Return from exception
+    .size PendSV_Handler, .-PendSV_Handler
+
+#else
     .type PendSV_Handler, %function
 PendSV_Handler:
     CPSID   I                 	 // Disable interrupts
@@ -46,13 +106,17 @@ PendSV_Handler:
     CPSIE   I                 	 // Re-enable interrupts
     BX      LR                	 // Return from exception
     .size PendSV_Handler, .-PendSV_Handler
+#endif
+
+    .section .text
+    .align 4
 
 
 /*
  * ---> osSchedulerLaunch
  * Starts the first thread.
  * Loads its SP from currentPt->stackPt and restores registers.
- * Then executes BX LR to jump to the thread entry point.
+ * Then sets LR from the frame (osThreadExit, where a returning thread goes) and executes BX R12 to the frame PC.
 */
     .type osSchedulerLaunch, %function
 osSchedulerLaunch:
@@ -61,13 +125,13 @@ osSchedulerLaunch:
     LDR     SP, [R2]           // SP = currentPt->stackPt (load thread stack)
 
     POP     {R4-R11}           // Restore R4–R11
-    POP     {R12}              // Restore R12
     POP     {R0-R3}            // Restore R0–R3
-    ADD     SP, SP, #4         // Skip
-    POP     {LR}               // Pop PC into LR (will BX LR to jump to task)
-    ADD     SP, SP, #4         // Skip
+    POP     {R12}              // Restore R12
+    POP     {LR}               // LR of the frame: osThreadExit
+    POP     {R12}              // PC of the frame: the thread entry
+    ADD     SP, SP, #4         // Skip xPSR
     CPSIE   I                  // Enable interrupts
-    BX      LR                 // Jump to thread entry (task0/task1/task2)
+    BX      R12                // Jump to thread entry (task0/task1/task2)
     .size osSchedulerLaunch, .-osSchedulerLaunch
 
     .end
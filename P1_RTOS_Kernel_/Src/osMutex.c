@@ -0,0 +1,195 @@
+/* Main idea:
+ * Fast path: compare and swap of the owner word (LDREX/STREX), no kernel entry.
+ * Slow path, interrupts disabled: the waiter list, the priority inheritance and the hand over to the next owner.
+ *
+ */
+
+#include "osMutex.h"
+
+#define MUTEX_CONTENDED		((uintptr_t)1)		// owner bit 0: unlock must wake a waiter
+
+static void osMutexWaiterInsert(osMutexType *mutex, tcbType *thread);
+static void osMutexWaiterRemove(osMutexType *mutex, tcbType *thread);
+static void osMutexHeldPush(tcbType *thread, osMutexType *mutex);
+static void osMutexHeldRemove(tcbType *thread, osMutexType *mutex);
+#if OS_MUTEX_PRIORITY_INHERITANCE
+static tcbType *osMutexOwner(osMutexType *mutex);
+static void osMutexInherit(osMutexType *mutex, uint32_t priority);
+static uint32_t osMutexOwnPriority(tcbType *thread);
+#endif
+
+
+void osMutexInit(osMutexType *mutex)
+{
+	mutex->owner = 0;
+	mutex->waiters = NULL;
+	mutex->nextHeld = NULL;
+}
+
+// 1 if the mutex was free and is now owned by the calling thread
+uint8_t osMutexTryLock(osMutexType *mutex)
+{
+	uintptr_t expected = 0;
+
+	if(__atomic_compare_exchange_n(&mutex->owner, &expected, (uintptr_t)currentPt, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+	{
+		osMutexHeldPush(currentPt, mutex);		// own list, only the owner and the hand over (owner blocked) write it
+		return 1;
+	}
+	return 0;
+}
+
+void osMutexLock(osMutexType *mutex)
+{
+	tcbType *self = currentPt;
+
+	if(osMutexTryLock(mutex))
+	{
+		return;
+	}
+
+	__disable_irq();
+	if(mutex->owner == 0)						// released since the try
+	{
+		mutex->owner = (uintptr_t)self;
+		osMutexHeldPush(self, mutex);
+		__enable_irq();
+		return;
+	}
+	mutex->owner |= MUTEX_CONTENDED;			// the owner's unlock takes the slow path now
+	self->state = OS_THREAD_BLOCKED;
+	self->blockedOn = mutex;
+	osMutexWaiterInsert(mutex, self);
+#if OS_MUTEX_PRIORITY_INHERITANCE
+	osMutexInherit(mutex, self->priority);
+#endif
+	__enable_irq();
+
+	while(self->state == OS_THREAD_BLOCKED)		// osScheduler skips this thread until the unlock hands the mutex over
+	{
+		osKernelSwitch();
+	}
+}
+
+void osMutexUnlock(osMutexType *mutex)
+{
+	tcbType *self = currentPt;
+	uintptr_t expected = (uintptr_t)self;
+	tcbType *next;
+	uint8_t preempt;
+
+	osMutexHeldRemove(self, mutex);
+	if(__atomic_compare_exchange_n(&mutex->owner, &expected, 0, 0, __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+	{
+		return;									// nobody waits
+	}
+
+	__disable_irq();
+	next = mutex->waiters;
+	osMutexWaiterRemove(mutex, next);
+	mutex->owner = (uintptr_t)next | (mutex->waiters != NULL ? MUTEX_CONTENDED : 0);
+	osMutexHeldPush(next, mutex);
+	next->blockedOn = NULL;
+	next->state = OS_THREAD_READY;
+#if OS_MUTEX_PRIORITY_INHERITANCE
+	if(mutex->waiters != NULL && mutex->waiters->priority > next->priority)
+	{
+		next->priority = mutex->waiters->priority;	// the remaining waiters now wait for the new owner
+	}
+	self->priority = osMutexOwnPriority(self);	// drop what was inherited through this mutex
+#endif
+	preempt = next->priority > self->priority;
+	__enable_irq();
+
+	if(preempt)
+	{
+		osThreadYield();
+	}
+}
+
+/*** helpers, interrupts disabled */
+
+static void osMutexWaiterInsert(osMutexType *mutex, tcbType *thread)
+{
+	tcbType **link = &mutex->waiters;
+
+	while(*link != NULL && (*link)->priority >= thread->priority)
+	{
+		link = &(*link)->nextWaiter;
+	}
+	thread->nextWaiter = *link;
+	*link = thread;
+}
+
+static void osMutexWaiterRemove(osMutexType *mutex, tcbType *thread)
+{
+	tcbType **link = &mutex->waiters;
+
+	while(*link != thread)
+	{
+		link = &(*link)->nextWaiter;
+	}
+	*link = thread->nextWaiter;
+	thread->nextWaiter = NULL;
+}
+
+static void osMutexHeldPush(tcbType *thread, osMutexType *mutex)
+{
+	mutex->nextHeld = thread->held;
+	thread->held = mutex;
+}
+
+static void osMutexHeldRemove(tcbType *thread, osMutexType *mutex)
+{
+	osMutexType **link = &thread->held;
+
+	while(*link != NULL && *link != mutex)
+	{
+		link = &(*link)->nextHeld;
+	}
+	if(*link != NULL)
+	{
+		*link = mutex->nextHeld;
+	}
+	mutex->nextHeld = NULL;
+}
+
+#if OS_MUTEX_PRIORITY_INHERITANCE
+static tcbType *osMutexOwner(osMutexType *mutex)
+{
+	return (tcbType *)(mutex->owner & ~MUTEX_CONTENDED);
+}
+
+// Raise the owner to the priority of a new waiter, and along the chain if that owner waits for a mutex itself
+static void osMutexInherit(osMutexType *mutex, uint32_t priority)
+{
+	tcbType *owner = osMutexOwner(mutex);
+
+	while(owner != NULL && owner->priority < priority)
+	{
+		owner->priority = priority;
+		if(owner->state != OS_THREAD_BLOCKED)
+		{
+			break;
+		}
+		osMutexWaiterRemove(owner->blockedOn, owner);	// keep the waiter list ordered
+		osMutexWaiterInsert(owner->blockedOn, owner);
+		owner = osMutexOwner(owner->blockedOn);
+	}
+}
+
+// Base priority, or the first waiter of a mutex the thread still holds if higher
+static uint32_t osMutexOwnPriority(tcbType *thread)
+{
+	uint32_t priority = thread->basePriority;
+
+	for(osMutexType *mutex = thread->held; mutex != NULL; mutex = mutex->nextHeld)
+	{
+		if(mutex->waiters != NULL && mutex->waiters->priority > priority)
+		{
+			priority = mutex->waiters->priority;
+		}
+	}
+	return priority;
+}
+#endif
@@ -0,0 +1,241 @@
+/* Main idea:
+ * One critical section per call moves as many items as fit (send) or as are there (receive), with at most two
+ * memcpy for the wrap of the ring buffer.
+ * A thread that cannot go on waits (OS_THREAD_WAITING with its timeout, counted down by SysTick_Handler) on the
+ * senders or receivers list of the queue; every transfer wakes the first thread of the other side, which tries again.
+ *
+ */
+
+#include <string.h>
+#include "osQueue.h"
+
+static uint32_t osQueueTransfer(osQueueType *queue, uint8_t *items, uint32_t n, uint32_t min, uint32_t timeout, uint8_t send);
+static uint32_t osQueuePut(osQueueType *queue, const uint8_t *items, uint32_t n);
+static uint32_t osQueueGet(osQueueType *queue, uint8_t *items, uint32_t n);
+static tcbType *osQueueWake(tcbType **list, tcbType *woken);
+static void osQueueWaiterInsert(tcbType **list, tcbType *thread);
+static uint8_t osQueueWaiterRemove(tcbType **list, tcbType *thread);
+
+
+void osQueueInit(osQueueType *queue, void *buffer, uint32_t itemSize, uint32_t capacity)
+{
+	queue->buffer = buffer;
+	queue->itemSize = itemSize;
+	queue->capacity = capacity;
+	queue->head = 0;
+	queue->count = 0;
+	queue->senders = NULL;
+	queue->receivers = NULL;
+}
+
+// 1 if the item was queued, 0 if the queue stayed full for timeout quanta
+uint8_t osQueueSend(osQueueType *queue, const void *item, uint32_t timeout)
+{
+	return osQueueTransfer(queue, (uint8_t *)item, 1, 1, timeout, 1) == 1;	// only read
+}
+
+// 1 if an item was received, 0 if the queue stayed empty for timeout quanta
+uint8_t osQueueReceive(osQueueType *queue, void *item, uint32_t timeout)
+{
+	return osQueueTransfer(queue, item, 1, 1, timeout, 0) == 1;
+}
+
+// Queue all n items, waiting for space as often as needed. Returns the number queued, less than n on timeout.
+uint32_t osQueueSendBatch(osQueueType *queue, const void *items, uint32_t n, uint32_t timeout)
+{
+	return osQueueTransfer(queue, (uint8_t *)items, n, n, timeout, 1);
+}
+
+// Wait for at least one item, then take all there are up to max. Returns the number received, 0 on timeout.
+uint32_t osQueueReceiveBatch(osQueueType *queue, void *items, uint32_t max, uint32_t timeout)
+{
+	return osQueueTransfer(queue, items, max, 1, timeout, 0);
+}
+
+// From an interrupt handler: queue what fits of the n items, returns their number.
+// A woken receiver of higher priority runs in PendSV, when the handler returns.
+RAMFUNC uint32_t osQueueSendFromISR(osQueueType *queue, const void *items, uint32_t n)
+{
+	uint32_t primask = __get_PRIMASK();
+	tcbType *woken = NULL;
+	uint32_t sent;
+
+	__disable_irq();
+	sent = osQueuePut(queue, items, n);
+	if(sent != 0)
+	{
+		woken = osQueueWake(&queue->receivers, NULL);
+	}
+	if(woken != NULL && (woken->priority > currentPt->priority || currentPt == &tcbs[OS_IDLE_THREAD]))
+	{
+		SCB->ICSR = SCB_ICSR_PENDSVSET_Msk;
+	}
+	__set_PRIMASK(primask);
+
+	return sent;
+}
+
+uint32_t osQueueCount(osQueueType *queue)
+{
+	return queue->count;
+}
+
+/*** transfer */
+
+// Move items until at least min of the n moved, waiting on the own list of the queue while nothing can move
+static uint32_t osQueueTransfer(osQueueType *queue, uint8_t *items, uint32_t n, uint32_t min, uint32_t timeout, uint8_t send)
+{
+	tcbType *self = currentPt;
+	tcbType **own = send ? &queue->senders : &queue->receivers;
+	tcbType **other = send ? &queue->receivers : &queue->senders;
+	tcbType *woken;
+	uint32_t moved = 0, k;
+
+	while(1)
+	{
+		__disable_irq();
+		k = send ? osQueuePut(queue, &items[moved * queue->itemSize], n - moved)
+				 : osQueueGet(queue, &items[moved * queue->itemSize], n - moved);
+		moved += k;
+		woken = NULL;
+		if(k != 0)
+		{
+			woken = osQueueWake(other, woken);				// room or items for the other side
+		}
+		if(moved >= min || timeout == 0)
+		{
+			if(send ? queue->count < queue->capacity : queue->count != 0)
+			{
+				woken = osQueueWake(own, woken);			// left over for the next thread of this side
+			}
+			__enable_irq();
+			if(woken != NULL && woken->priority > self->priority)
+			{
+				osThreadYield();
+			}
+			return moved;
+		}
+
+		self->notifyMask = 0;								// notifications do not end this wait
+		self->waitTicks = timeout;
+		self->state = OS_THREAD_WAITING;
+		osQueueWaiterInsert(own, self);
+		__enable_irq();
+		while(self->state == OS_THREAD_WAITING)
+		{
+			osKernelSwitch();								// osScheduler skips this thread until woken or timed out
+		}
+
+		__disable_irq();
+		if(osQueueWaiterRemove(own, self))
+		{
+			timeout = 0;									// timed out: one last try, then return
+		}
+		else
+		{
+			timeout = self->waitTicks;						// woken: the rest of the timeout
+		}
+		self->waitTicks = OS_WAIT_FOREVER;
+		__enable_irq();
+	}
+}
+
+/*** ring buffer, interrupts disabled */
+
+static uint32_t osQueuePut(osQueueType *queue, const uint8_t *items, uint32_t n)
+{
+	uint32_t tail, first;
+
+	if(n > queue->capacity - queue->count)
+	{
+		n = queue->capacity - queue->count;
+	}
+	tail = queue->head + queue->count;
+	if(tail >= queue->capacity)
+	{
+		tail -= queue->capacity;
+	}
+	first = queue->capacity - tail;						// items up to the end of the buffer
+	if(first > n)
+	{
+		first = n;
+	}
+	memcpy(&queue->buffer[tail * queue->itemSize], items, first * queue->itemSize);
+	memcpy(queue->buffer, &items[first * queue->itemSize], (n - first) * queue->itemSize);
+	queue->count += n;
+
+	return n;
+}
+
+static uint32_t osQueueGet(osQueueType *queue, uint8_t *items, uint32_t n)
+{
+	uint32_t first;
+
+	if(n > queue->count)
+	{
+		n = queue->count;
+	}
+	first = queue->capacity - queue->head;
+	if(first > n)
+	{
+		first = n;
+	}
+	memcpy(items, &queue->buffer[queue->head * queue->itemSize], first * queue->itemSize);
+	memcpy(&items[first * queue->itemSize], queue->buffer, (n - first) * queue->itemSize);
+	queue->head += n;
+	if(queue->head >= queue->capacity)
+	{
+		queue->head -= queue->capacity;
+	}
+	queue->count -= n;
+
+	return n;
+}
+
+/*** waiter lists, interrupts disabled */
+
+// Ready the first waiter, returns the one of higher priority of it and woken
+static tcbType *osQueueWake(tcbType **list, tcbType *woken)
+{
+	tcbType *first = *list;
+
+	if(first == NULL)
+	{
+		return woken;
+	}
+	*list = first->nextWaiter;
+	first->nextWaiter = NULL;
+	first->state = OS_THREAD_READY;
+	if(woken == NULL || first->priority > woken->priority)
+	{
+		return first;
+	}
+	return woken;
+}
+
+// Highest priority first, FIFO among equal priorities
+static void osQueueWaiterInsert(tcbType **list, tcbType *thread)
+{
+	while(*list != NULL && (*list)->priority >= thread->priority)
+	{
+		list = &(*list)->nextWaiter;
+	}
+	thread->nextWaiter = *list;
+	*list = thread;
+}
+
+// 1 if the thread was still on the list
+static uint8_t osQueueWaiterRemove(tcbType **list, tcbType *thread)
+{
+	while(*list != NULL)
+	{
+		if(*list == thread)
+		{
+			*list = thread->nextWaiter;
+			thread->nextWaiter = NULL;
+			return 1;
+		}
+		list = &(*list)->nextWaiter;
+	}
+	return 0;
+}
@@ -0,0 +1,210 @@
+#include "osTimer.h"
+
+#define OS_TIMER_CLOCK		16000000			// TIM2 clock: APB1 without prescaler, BUS_FREQ of osKernel.c
+#define TIM2EN				(1U<<0)
+#define CR1_CEN				(1U<<0)
+#define EGR_UG				(1U<<0)
+#define DIER_CC1IE			(1U<<1)
+#define SR_CC1IF			(1U<<1)
+#define OS_TIMER_SLOT		0xFFU				// id: pool index in the low byte, start count above
+
+_Static_assert(OS_TIMER_COUNT < OS_TIMER_SLOT, "OS_TIMER_COUNT does not fit the timer id");
+
+typedef struct osTimer{
+	uint32_t expiry;							// TIM2->CNT at which it fires
+	uint32_t id;								// returned by the start, stale ids do not stop a reused timer
+	void (*callback)(void);						// NULL: notify thread with OS_TIMER_WAKE
+	uint32_t thread;
+	uint8_t queued;
+	struct osTimer *next;						// queue sorted by expiry, or free list
+} osTimerType;
+
+static osTimerType osTimers[OS_TIMER_COUNT];
+static osTimerType *osTimerQueue;				// first to expire first, FIFO among equal expiries
+static osTimerType *osTimerFree;
+static uint32_t osTimerStarts;
+
+static uint32_t osTimerAdd(uint32_t us, void (*callback)(void), uint32_t thread);
+static uint8_t osTimerArm(void);
+
+
+/* TIM2 at 1 MHz, free running, compare interrupt off until a timer is started */
+void osTimerInit(void)
+{
+	RCC->APB1ENR |= TIM2EN;
+	TIM2->CR1 = 0;
+	TIM2->DIER = 0;
+	TIM2->PSC = OS_TIMER_CLOCK / 1000000 - 1;	// one count per microsecond
+	TIM2->ARR = 0xFFFFFFFF;						// full 32 bits, wraps after ~71 minutes
+	TIM2->EGR = EGR_UG;							// load the prescaler now
+	TIM2->SR = 0;
+
+	osTimerQueue = NULL;
+	osTimerFree = NULL;
+	for(int i = OS_TIMER_COUNT - 1; i >= 0; i--)
+	{
+		osTimers[i].queued = 0;
+		osTimers[i].next = osTimerFree;
+		osTimerFree = &osTimers[i];
+	}
+
+	NVIC_SetPriority(TIM2_IRQn, OS_TIMER_IRQ_PRIORITY);
+	NVIC_EnableIRQ(TIM2_IRQn);
+	TIM2->CR1 = CR1_CEN;
+}
+
+/* Microseconds, wraps at 32 bits */
+uint32_t osTimerNow(void)
+{
+	return TIM2->CNT;
+}
+
+/* Run callback in us microseconds (up to OS_TIMER_MAX_US). Returns the timer for osTimerStop, or OS_TIMER_NONE. */
+uint32_t osTimerStart(uint32_t us, void (*callback)(void))
+{
+	return osTimerAdd(us, callback, 0);
+}
+
+/* Set OS_TIMER_WAKE in the notifications of thread in us microseconds */
+uint32_t osTimerStartNotify(uint32_t us, uint32_t thread)
+{
+	return osTimerAdd(us, NULL, thread);
+}
+
+/* Returns 1 if the timer was still pending, 0 if it fired already or was stopped */
+uint8_t osTimerStop(uint32_t timer)
+{
+	osTimerType *t;
+	osTimerType **link = &osTimerQueue;
+	uint32_t primask;
+
+	if((timer & OS_TIMER_SLOT) >= OS_TIMER_COUNT)
+	{
+		return 0;
+	}
+	t = &osTimers[timer & OS_TIMER_SLOT];
+	primask = __get_PRIMASK();
+	__disable_irq();
+	if(!t->queued || t->id != timer)
+	{
+		__set_PRIMASK(primask);
+		return 0;
+	}
+	while(*link != t)
+	{
+		link = &(*link)->next;
+	}
+	*link = t->next;
+	t->queued = 0;
+	t->next = osTimerFree;
+	osTimerFree = t;
+	if(link == &osTimerQueue && osTimerArm())
+	{
+		NVIC_SetPendingIRQ(TIM2_IRQn);
+	}
+	__set_PRIMASK(primask);
+
+	return 1;
+}
+
+/* Wait us microseconds, the other threads run meanwhile. Returns 0 if no timer was free. */
+uint8_t osTimerSleepUs(uint32_t us)
+{
+	if(osTimerStartNotify(us, osThreadGetId()) == OS_TIMER_NONE)
+	{
+		return 0;
+	}
+	osThreadNotifyWait(OS_TIMER_WAKE, OS_WAIT_FOREVER);
+	return 1;
+}
+
+/* Compare match of the first timer: run every timer that is due, then set the compare to the next one */
+void TIM2_IRQHandler(void)
+{
+	osTimerType *t;
+	void (*callback)(void);
+	uint32_t thread;
+
+	TIM2->SR &= ~SR_CC1IF;
+	__disable_irq();							// osTimerStart may be called from a higher priority interrupt
+	do
+	{
+		while(osTimerQueue != NULL && (int32_t)(TIM2->CNT - osTimerQueue->expiry) >= 0)
+		{
+			t = osTimerQueue;
+			osTimerQueue = t->next;
+			callback = t->callback;
+			thread = t->thread;
+			t->queued = 0;
+			t->next = osTimerFree;				// free before the callback, which may start it again
+			osTimerFree = t;
+			__enable_irq();
+
+			if(callback != NULL)
+			{
+				callback();
+			}
+			else
+			{
+				osThreadNotifyFromISR(thread, OS_TIMER_WAKE);
+			}
+			__disable_irq();
+		}
+	} while(osTimerArm());						// the next one passed while the callbacks ran
+	__enable_irq();
+}
+
+/*** queue */
+
+static uint32_t osTimerAdd(uint32_t us, void (*callback)(void), uint32_t thread)
+{
+	osTimerType *t;
+	osTimerType **link = &osTimerQueue;
+	uint32_t primask, id;
+
+	primask = __get_PRIMASK();
+	__disable_irq();
+	t = osTimerFree;
+	if(t == NULL || us > OS_TIMER_MAX_US)
+	{
+		__set_PRIMASK(primask);
+		return OS_TIMER_NONE;
+	}
+	osTimerFree = t->next;
+
+	t->expiry = TIM2->CNT + us;
+	t->callback = callback;
+	t->thread = thread;
+	t->queued = 1;
+	osTimerStarts = (osTimerStarts + 1) & 0x00FFFFFF;
+	id = (osTimerStarts << 8) | (uint32_t)(t - osTimers);
+	t->id = id;
+
+	while(*link != NULL && (int32_t)((*link)->expiry - t->expiry) <= 0)
+	{
+		link = &(*link)->next;
+	}
+	t->next = *link;
+	*link = t;
+	if(osTimerQueue == t && osTimerArm())
+	{
+		NVIC_SetPendingIRQ(TIM2_IRQn);			// due before the compare was set: that match will not come
+	}
+	__set_PRIMASK(primask);
+
+	return id;
+}
+
+/* Interrupts disabled. Compare channel 1 on the first timer, returns 1 if it is already due */
+static uint8_t osTimerArm(void)
+{
+	if(osTimerQueue == NULL)
+	{
+		TIM2->DIER &= ~DIER_CC1IE;
+		return 0;
+	}
+	TIM2->CCR1 = osTimerQueue->expiry;
+	TIM2->SR &= ~SR_CC1IF;
+	TIM2->DIER |= DIER_CC1IE;
+	return (int32_t)(TIM2->CNT - osTimerQueue->expiry) >= 0;
+}
@@ -0,0 +1,116 @@
+/*
+ * *** Purpose:
+ * Cycles per item through a kernel queue (osQueue.c): single item send/receive against batches.
+ *
+ * *** How it works
+ * Replaces the application threads (main.c, RUN_QUEUE_BENCHMARK 1). Thread 0 sends QUEUE_BENCH_ITEMS samples of
+ * 32 bits to thread 1, first one by one (osQueueSend/osQueueReceive), then in batches of QUEUE_BENCH_BATCH
+ * (osQueueSendBatch/osQueueReceiveBatch). Both run at the same priority: the sender fills the queue, waits, the
+ * receiver empties it, waits, and so on. The time from the first send to the last receive, DWT->CYCCNT, includes
+ * the context switches and the SysTicks in between, as the sample pipeline would see them.
+ *
+ * *** Output
+ * One CSV line per mode over printf (UART), then every thread waits forever (the idle thread runs):
+ * queue,<single|batch>,items,batch,cycles,cycles_per_item
+ */
+
+#include <stdio.h>
+#include "stm32f4xx.h"
+#include "osKernel.h"
+#include "osQueue.h"
+#include "queue_benchmark.h"
+
+#define QUEUE_BENCH_ITEMS			100000
+#define QUEUE_BENCH_BATCH			16
+#define QUEUE_BENCH_CAPACITY		64
+#define QUEUE_BENCH_GO				(1U<<0)		// notification bits
+#define QUEUE_BENCH_DONE			(1U<<1)
+
+static void queue_bench_sender(void);
+static void queue_bench_receiver(void);
+static void queue_bench_idle(void);
+static void queue_bench_run(const char *name, uint32_t batch);
+
+static uint32_t buffer[QUEUE_BENCH_CAPACITY];
+static osQueueType queue;
+static volatile uint32_t receive_batch;
+static volatile uint32_t received_cycles;
+
+
+uint8_t queue_benchmark_add_threads(void)
+{
+	osQueueInit(&queue, buffer, sizeof(uint32_t), QUEUE_BENCH_CAPACITY);
+	return osKernelAddThreads(queue_bench_sender, queue_bench_receiver, queue_bench_idle);
+}
+
+static void queue_bench_sender(void)
+{
+	queue_bench_run("single", 1);
+	queue_bench_run("batch", QUEUE_BENCH_BATCH);
+
+	while(1)
+	{
+		osThreadNotifyWait(0, OS_WAIT_FOREVER);
+	}
+}
+
+static void queue_bench_run(const char *name, uint32_t batch)
+{
+	uint32_t items[QUEUE_BENCH_BATCH];
+	uint32_t start;
+
+	receive_batch = batch;
+	osThreadNotify(1, QUEUE_BENCH_GO);
+	start = DWT->CYCCNT;
+	for(uint32_t i = 0; i < QUEUE_BENCH_ITEMS; i += batch)
+	{
+		for(uint32_t j = 0; j < batch; j++)
+		{
+			items[j] = i + j;
+		}
+		if(batch == 1)
+		{
+			osQueueSend(&queue, items, OS_WAIT_FOREVER);
+		}
+		else
+		{
+			osQueueSendBatch(&queue, items, batch, OS_WAIT_FOREVER);
+		}
+	}
+	osThreadNotifyWait(QUEUE_BENCH_DONE, OS_WAIT_FOREVER);
+
+	printf("queue,%s,%lu,%lu,%lu,%lu\n\r", name, (unsigned long)QUEUE_BENCH_ITEMS, (unsigned long)batch,
+		   (unsigned long)(received_cycles - start), (unsigned long)((received_cycles - start) / QUEUE_BENCH_ITEMS));
+}
+
+static void queue_bench_receiver(void)
+{
+	uint32_t items[QUEUE_BENCH_BATCH];
+	uint32_t received;
+
+	while(1)
+	{
+		osThreadNotifyWait(QUEUE_BENCH_GO, OS_WAIT_FOREVER);
+		for(received = 0; received < QUEUE_BENCH_ITEMS; )
+		{
+			if(receive_batch == 1)
+			{
+				received += osQueueReceive(&queue, items, OS_WAIT_FOREVER);
+			}
+			else
+			{
+				received += osQueueReceiveBatch(&queue, items, receive_batch, OS_WAIT_FOREVER);
+			}
+		}
+		received_cycles = DWT->CYCCNT;
+		osThreadNotify(0, QUEUE_BENCH_DONE);
+	}
+}
+
+static void queue_bench_idle(void)
+{
+	while(1)
+	{
+		osThreadNotifyWait(0, OS_WAIT_FOREVER);
+	}
+}
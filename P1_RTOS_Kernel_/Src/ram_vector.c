@@ -0,0 +1,28 @@
+#include "ram_vector.h"
+
+#include "stm32f4xx.h"
+
+#define RAM_VECTOR_COUNT	(16 + SPI4_IRQn + 1)	// 16 system exceptions + the STM32F401 interrupts
+
+extern const uint32_t g_pfnVectors[];				// flash vector table of the startup code
+
+static uint32_t ram_vector_table[RAM_VECTOR_COUNT] __attribute__((section(".ram_vector"), aligned(512)));	// VTOR needs the table size rounded up to a power of 2
+
+// Copy the flash vector table to SRAM and point VTOR at the copy, before osKernelLaunch
+void ram_vector_table_init(void)
+{
+	__disable_irq();
+	for(uint32_t i = 0; i < RAM_VECTOR_COUNT; i++)
+	{
+		ram_vector_table[i] = g_pfnVectors[i];
+	}
+	SCB->VTOR = (uint32_t)ram_vector_table;
+	__DSB();
+	__ISB();
+	__enable_irq();
+}
+
+uint8_t ram_vector_table_active(void)
+{
+	return (SCB->VTOR == (uint32_t)ram_vector_table) ? 1 : 0;
+}
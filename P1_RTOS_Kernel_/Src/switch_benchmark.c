@@ -0,0 +1,67 @@
+/*
+ * *** Purpose:
+ * Cycles per context switch of PendSV_Handler: the inline assembly decision (OS_SCHEDULER_ASM 1) against the call
+ * of osScheduler in C (OS_SCHEDULER_ASM 0). Build once with each setting.
+ *
+ * *** How it works
+ * Replaces the application threads (main.c, RUN_SWITCH_BENCHMARK 1). Three equal threads pass the CPU around with
+ * osKernelSwitch: each one stamps DWT->CYCCNT and pends PendSV, the next one stamps when it runs again.
+ * The difference is the full switch: pend, exception entry, save, decision, restore, exception return.
+ * Samples with a SysTick in between are dropped.
+ * Without the board, make -C Host pendsv runs the assembled inline decision against osScheduler and counts its
+ * instructions and cycles from the timing table (no exception entry and return, no wait states).
+ *
+ * *** Output
+ * One CSV line over printf (UART), then every thread waits forever (the idle thread runs):
+ * switch,<asm|c>,samples,avg,min,max,unit
+ */
+
+#include <stdio.h>
+#include "stm32f4xx.h"
+#include "osKernel.h"
+#include "switch_benchmark.h"
+
+#define SWITCH_BENCH_SAMPLES		10000
+
+static void switch_bench_thread(void);
+
+static volatile uint32_t pend_cycles;
+static volatile uint32_t pend_tick;
+static uint32_t samples, sum, min = 0xFFFFFFFFU, max;
+
+
+uint8_t switch_benchmark_add_threads(void)
+{
+	return osKernelAddThreads(switch_bench_thread, switch_bench_thread, switch_bench_thread);
+}
+
+static void switch_bench_thread(void)
+{
+	uint32_t now, cycles;
+
+	while(samples < SWITCH_BENCH_SAMPLES)
+	{
+		now = DWT->CYCCNT;
+		if(pend_cycles != 0 && pend_tick == osKernelGetTick())
+		{
+			cycles = now - pend_cycles;
+			sum += cycles;
+			if(cycles < min) min = cycles;
+			if(cycles > max) max = cycles;
+			samples++;
+		}
+		pend_tick = osKernelGetTick();
+		pend_cycles = DWT->CYCCNT;
+		osKernelSwitch();
+	}
+
+	if(osThreadGetId() == 0)
+	{
+		printf("switch,%s,%lu,%lu,%lu,%lu,cycles\n\r", (OS_SCHEDULER_ASM && !OS_SCHEDULER_FAIR) ? "asm" : "c", (unsigned long)samples,
+			   (unsigned long)(sum / samples), (unsigned long)min, (unsigned long)max);
+	}
+	while(1)
+	{
+		osThreadNotifyWait(0, OS_WAIT_FOREVER);
+	}
+}
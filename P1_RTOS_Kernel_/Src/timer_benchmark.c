@@ -0,0 +1,134 @@
+/*
+ * *** Purpose:
+ * Wakeup error of the microsecond timers (osTimer.c) on target: how late a callback and a sleeping thread run
+ * after the requested delay.
+ *
+ * *** How it works
+ * Replaces the application threads (main.c, RUN_TIMER_BENCHMARK 1). Thread 0 (priority 2) plays the valve timing
+ * loop, threads 1 and 2 compute at priority 0 so every wakeup preempts a running thread.
+ * Thread 0 takes TIMER_BENCH_SAMPLES samples with pseudo random delays of TIMER_BENCH_MIN_US..TIMER_BENCH_MAX_US:
+ * 1. callback: osTimerStart, the callback stamps DWT->CYCCNT (interrupt entry, queue, callback call).
+ * 2. thread: osTimerSleepUs, the thread stamps when it runs again (plus notification and context switch).
+ * The error is the stamp minus the start stamp minus the delay in cycles. TIM2 counts whole microseconds, a timer
+ * started during a microsecond may fire up to one microsecond (TIMER_BENCH_CYCLES_PER_US cycles) early.
+ *
+ * *** Output
+ * CSV lines over printf (UART), then every thread waits forever (the idle thread runs):
+ * timer_wakeup,<callback|thread>,samples,avg,min,max,unit
+ * timer_error,<callback|thread>,<us>,<count>	histogram of the error in whole microseconds from -1,
+ * 												the last bucket counts TIMER_BENCH_HIST - 1 us and more
+ */
+
+#include <stdio.h>
+#include "stm32f4xx.h"
+#include "osKernel.h"
+#include "osTimer.h"
+#include "timer_benchmark.h"
+
+#define TIMER_BENCH_SAMPLES			10000
+#define TIMER_BENCH_MIN_US			50
+#define TIMER_BENCH_MAX_US			2000
+#define TIMER_BENCH_CYCLES_PER_US	16			// core clock 16 MHz (HSI), BUS_FREQ of osKernel.c
+#define TIMER_BENCH_HIST			12
+#define TIMER_BENCH_PRIORITY		2
+#define TIMER_BENCH_FIRED			(1U<<0)		// notification bit of thread 0, set by the callback
+
+static void timer_bench_valve(void);
+static void timer_bench_load(void);
+static void timer_bench_callback(void);
+static void timer_bench_report(const char *name, uint8_t use_callback);
+static uint32_t timer_bench_random(void);
+
+static volatile uint32_t fired_cycles;
+static uint32_t seed = 12345;
+static uint32_t histogram[TIMER_BENCH_HIST];
+static volatile uint32_t Act_Load;
+
+
+uint8_t timer_benchmark_add_threads(void)
+{
+	uint8_t ok;
+
+	osTimerInit();
+	ok = osKernelAddThreads(timer_bench_valve, timer_bench_load, timer_bench_load);
+	osThreadSetPriority(0, TIMER_BENCH_PRIORITY);
+	return ok;
+}
+
+static void timer_bench_valve(void)
+{
+	timer_bench_report("callback", 1);
+	timer_bench_report("thread", 0);
+
+	while(1)
+	{
+		osThreadNotifyWait(0, OS_WAIT_FOREVER);
+	}
+}
+
+static void timer_bench_report(const char *name, uint8_t use_callback)
+{
+	uint32_t delay, start, stamp, samples;
+	int32_t error, min = 0x7FFFFFFF, max = -0x7FFFFFFF - 1;
+	int64_t sum = 0;
+	int32_t bucket;
+
+	for(bucket = 0; bucket < TIMER_BENCH_HIST; bucket++)
+	{
+		histogram[bucket] = 0;
+	}
+	for(samples = 0; samples < TIMER_BENCH_SAMPLES; samples++)
+	{
+		delay = TIMER_BENCH_MIN_US + timer_bench_random() % (TIMER_BENCH_MAX_US - TIMER_BENCH_MIN_US);
+		start = DWT->CYCCNT;
+		if(use_callback)
+		{
+			osTimerStart(delay, timer_bench_callback);
+			osThreadNotifyWait(TIMER_BENCH_FIRED, OS_WAIT_FOREVER);
+			stamp = fired_cycles;
+		}
+		else
+		{
+			osTimerSleepUs(delay);
+			stamp = DWT->CYCCNT;
+		}
+
+		error = (int32_t)(stamp - start - delay * TIMER_BENCH_CYCLES_PER_US);
+		sum += error;
+		if(error < min) min = error;
+		if(error > max) max = error;
+		bucket = (error + TIMER_BENCH_CYCLES_PER_US) / TIMER_BENCH_CYCLES_PER_US;	// bucket 0: -1 us
+		if(bucket < 0) bucket = 0;
+		if(bucket >= TIMER_BENCH_HIST) bucket = TIMER_BENCH_HIST - 1;
+		histogram[bucket]++;
+	}
+
+	printf("timer_wakeup,%s,%lu,%ld,%ld,%ld,cycles\n\r", name, (unsigned long)TIMER_BENCH_SAMPLES,
+		   (long)(sum / TIMER_BENCH_SAMPLES), (long)min, (long)max);
+	for(bucket = 0; bucket < TIMER_BENCH_HIST; bucket++)
+	{
+		printf("timer_error,%s,%ld,%lu\n\r", name, (long)(bucket - 1), (unsigned long)histogram[bucket]);
+	}
+}
+
+/* In TIM2_IRQHandler */
+static void timer_bench_callback(void)
+{
+	fired_cycles = DWT->CYCCNT;
+	osThreadNotifyFromISR(0, TIMER_BENCH_FIRED);
+}
+
+static void timer_bench_load(void)
+{
+	while(1)
+	{
+		Act_Load++;
+	}
+}
+
+/* Park-Miller, the same delays on every run */
+static uint32_t timer_bench_random(void)
+{
+	seed = (uint32_t)((uint64_t)seed * 48271 % 0x7FFFFFFF);
+	return seed;
+}
@@ -51,6 +51,9 @@
 #if defined(__ICCARM__) || defined(__CC_ARM) || defined(__GNUC__)
   #include <stdint.h>
   extern uint32_t SystemCoreClock;
+  void cycle_counter_init(void);
+  uint32_t cycle_counter_get(void);
+  void memory_profile_task_created(void *task, void *stack_low, void *stack_high);
 #endif
 #ifndef CMSIS_device_header
 #define CMSIS_device_header "stm32f4xx.h"
@@ -120,6 +123,7 @@ to exclude the API function. */
 #define INCLUDE_uxTaskGetStackHighWaterMark  1
 #define INCLUDE_xTaskGetCurrentTaskHandle    1
 #define INCLUDE_eTaskGetState                1
+#define INCLUDE_xTaskGetIdleTaskHandle       1
 
 /*
  * The CMSIS-RTOS V2 FreeRTOS wrapper is dependent on the heap implementation used
@@ -169,6 +173,15 @@ standard names. */
 
 /* USER CODE BEGIN Defines */
 /* Section where parameter definitions can be added (for instance, to override default ones in FreeRTOS.h) */
+
+/* Run time statistics count DWT cycles, the clock governor reads the idle share from them */
+#define configGENERATE_RUN_TIME_STATS             1
+#define portCONFIGURE_TIMER_FOR_RUN_TIME_STATS()  cycle_counter_init()
+#define portGET_RUN_TIME_COUNTER_VALUE()          cycle_counter_get()
+
+/* Every task reports its stack to memory_profile.c, which sizes stacks and heap from the high water marks */
+#define configRECORD_STACK_HIGH_ADDRESS           1
+#define traceTASK_CREATE(pxNewTCB)                memory_profile_task_created((pxNewTCB), (pxNewTCB)->pxStack, (pxNewTCB)->pxEndOfStack)
 /* USER CODE END Defines */
 
 #endif /* FREERTOS_CONFIG_H */
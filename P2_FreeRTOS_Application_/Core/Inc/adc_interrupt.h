@@ -4,5 +4,14 @@
 
 void adc_interrupt_init();
 void adc_start_conversion(void);
+void adc_timer_trigger_init(uint32_t sample_rate_hz);
+void adc_timer_trigger_update_clock(void);
+void adc_clock_prescaler_set(uint32_t pclk2_hz);
+
+#define ADC_SCAN_FIRST_HALF		(1U<<0)
+#define ADC_SCAN_SECOND_HALF	(1U<<1)
+
+void adc_scan_init(const uint8_t *channels, uint32_t count, volatile uint16_t *buffer);
+uint32_t adc_scan_irq_status(void);
 
 #endif /* INC_ADC_INTERRUPT_H_ */
@@ -0,0 +1,12 @@
+#ifndef INC_CLOCK_GOVERNOR_H_
+#define INC_CLOCK_GOVERNOR_H_
+#include "stdint.h"
+
+#define GOVERNOR_PERIOD_MS		1000		// measurement window
+#define GOVERNOR_IDLE_MIN		20			// % idle below which the clock goes up
+#define GOVERNOR_IDLE_TARGET	40			// % idle the next lower profile must still leave to go down
+
+void clock_governor_init(void);
+uint32_t clock_governor_idle_percent(void);
+
+#endif /* INC_CLOCK_GOVERNOR_H_ */
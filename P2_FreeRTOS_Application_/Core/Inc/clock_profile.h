@@ -0,0 +1,18 @@
+#ifndef INC_CLOCK_PROFILE_H_
+#define INC_CLOCK_PROFILE_H_
+#include "stdint.h"
+
+/* Performance profiles, from the lowest power to the highest speed */
+typedef enum
+{
+	CLOCK_PROFILE_16MHZ = 0,				// HSI, PLL off, voltage scale 3, no flash wait state
+	CLOCK_PROFILE_42MHZ,					// PLL / 8, voltage scale 3, 1 wait state
+	CLOCK_PROFILE_84MHZ,					// PLL / 4, voltage scale 2, 2 wait states (SystemClock_Config)
+	CLOCK_PROFILE_COUNT
+} ClockProfile_t;
+
+uint8_t clock_profile_set(ClockProfile_t profile);
+ClockProfile_t clock_profile_get(void);
+uint32_t clock_profile_hz(ClockProfile_t profile);
+
+#endif /* INC_CLOCK_PROFILE_H_ */
@@ -0,0 +1,12 @@
+#ifndef INC_COMMAND_CHANNEL_H_
+#define INC_COMMAND_CHANNEL_H_
+#include "stdint.h"
+
+#define COMMAND_RX_BUFFER_SIZE	128			// DMA ring, must hold the bytes received between two idle lines
+#define COMMAND_STREAM_SIZE		256			// frames waiting for the parser task
+#define COMMAND_LINE_MAX		48
+
+void command_channel_init(void);
+void command_channel_inject(const char *text);
+
+#endif /* INC_COMMAND_CHANNEL_H_ */
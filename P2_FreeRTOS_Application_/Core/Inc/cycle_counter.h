@@ -0,0 +1,12 @@
+#ifndef INC_CYCLE_COUNTER_H_
+#define INC_CYCLE_COUNTER_H_
+#include "stdint.h"
+
+void cycle_counter_init(void);
+uint32_t cycle_counter_get(void);
+const char *cycle_counter_unit(void);
+uint32_t cycle_counter_to_us(uint32_t cycles);
+uint32_t cycle_counter_clock_epoch(void);
+void cycle_counter_clock_changed(void);
+
+#endif /* INC_CYCLE_COUNTER_H_ */
@@ -0,0 +1,8 @@
+#ifndef INC_FILTER_BENCHMARK_H_
+#define INC_FILTER_BENCHMARK_H_
+#include "stdint.h"
+
+void filter_benchmark_init(void);
+uint8_t filter_benchmark_finished(void);
+
+#endif /* INC_FILTER_BENCHMARK_H_ */
@@ -0,0 +1,43 @@
+#ifndef INC_FRAME_POOL_H_
+#define INC_FRAME_POOL_H_
+#include "stdint.h"
+#include "FreeRTOS.h"
+#include "queue.h"
+
+/*
+ * Fixed-block pool of sensor frames, to pass frames between tasks by reference.
+ * The producer allocates a frame, fills it and sends only its pointer through a queue created with
+ * xQueueCreate(length, sizeof(SensorFrame_t *)). The consumer receives the pointer and returns the frame to the pool.
+ * With FRAME_POOL_DEBUG every frame records its owner and configASSERT stops on use after send or double free.
+ */
+
+#define FRAME_SAMPLES		512					// samples per waveform frame
+#define FRAME_POOL_LENGTH	4					// frames in the pool
+
+#ifndef FRAME_POOL_DEBUG
+#define FRAME_POOL_DEBUG	1					// 1 = ownership checks with configASSERT
+#endif
+
+typedef struct
+{
+	uint32_t timestamp;							// tick count of the first sample
+	uint32_t length;							// valid samples in samples[]
+	uint16_t samples[FRAME_SAMPLES];
+#if FRAME_POOL_DEBUG
+	void *owner;								// task handle of the owner, or one of the FRAME_OWNER_ values
+#endif
+} SensorFrame_t;
+
+void frame_pool_init(void);
+uint32_t frame_pool_available(void);
+
+SensorFrame_t *frame_pool_alloc(void);
+SensorFrame_t *frame_pool_alloc_from_isr(void);
+void frame_pool_free(SensorFrame_t *frame);
+void frame_pool_free_from_isr(SensorFrame_t *frame);
+
+BaseType_t frame_pool_send(QueueHandle_t queue, SensorFrame_t *frame, TickType_t ticks_to_wait);
+BaseType_t frame_pool_send_from_isr(QueueHandle_t queue, SensorFrame_t *frame, BaseType_t *pxHigherPriorityTaskWoken);
+BaseType_t frame_pool_receive(QueueHandle_t queue, SensorFrame_t **frame, TickType_t ticks_to_wait);
+
+#endif /* INC_FRAME_POOL_H_ */
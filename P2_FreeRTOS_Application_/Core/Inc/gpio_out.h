@@ -7,6 +7,9 @@ void GPIO_OUT_init(void);
 void GPIO_OUT_on(void);
 void GPIO_OUT_off(void);
 
+void GPIO_OUT_pin_init(GPIO_TypeDef *port, uint8_t pin);
+void GPIO_OUT_pin_write(GPIO_TypeDef *port, uint8_t pin, uint8_t state);
+
 #define GPIO_OUT_PIN	(1U<<5)
 
 #endif
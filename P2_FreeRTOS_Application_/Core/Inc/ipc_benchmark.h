@@ -0,0 +1,8 @@
+#ifndef INC_IPC_BENCHMARK_H_
+#define INC_IPC_BENCHMARK_H_
+#include "stdint.h"
+
+void ipc_benchmark_init(void);
+uint8_t ipc_benchmark_finished(void);
+
+#endif /* INC_IPC_BENCHMARK_H_ */
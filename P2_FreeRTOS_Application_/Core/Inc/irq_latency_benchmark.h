@@ -0,0 +1,6 @@
+#ifndef INC_IRQ_LATENCY_BENCHMARK_H_
+#define INC_IRQ_LATENCY_BENCHMARK_H_
+
+void irq_latency_benchmark_init(void);
+
+#endif /* INC_IRQ_LATENCY_BENCHMARK_H_ */
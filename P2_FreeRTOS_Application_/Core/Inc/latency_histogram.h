@@ -0,0 +1,22 @@
+#ifndef INC_LATENCY_HISTOGRAM_H_
+#define INC_LATENCY_HISTOGRAM_H_
+#include "stdint.h"
+
+#define LATENCY_BUCKET_US		10			// width of one bucket
+#define LATENCY_BUCKETS			32			// the last bucket counts everything from (LATENCY_BUCKETS - 1) * LATENCY_BUCKET_US up
+
+typedef struct
+{
+	uint32_t count;
+	uint32_t min_us;
+	uint32_t max_us;
+	uint64_t sum_us;						// 32 bits would wrap after 4295 s of latency, e.g. 4.3 M samples of 1 ms
+	uint32_t buckets[LATENCY_BUCKETS];
+} LatencyHistogram_t;
+
+void latency_histogram_record(uint32_t latency_us);
+void latency_histogram_snapshot(LatencyHistogram_t *copy);
+void latency_histogram_reset(void);
+void latency_histogram_print(void);
+
+#endif /* INC_LATENCY_HISTOGRAM_H_ */
@@ -0,0 +1,13 @@
+#ifndef INC_MEMORY_PROFILE_H_
+#define INC_MEMORY_PROFILE_H_
+#include "stdint.h"
+
+#define MEMORY_PROFILE_MAX_TASKS	16
+#define MEMORY_PROFILE_MARGIN		25			// % added to the measured use for the recommended sizes
+#define MEMORY_PROFILE_RUN_MS		4000		// time the application runs before the report of RUN_MEMORY_PROFILE
+
+void memory_profile_init(void);
+void memory_profile_task_created(void *task, void *stack_low, void *stack_high);
+void memory_profile_print(void);
+
+#endif /* INC_MEMORY_PROFILE_H_ */
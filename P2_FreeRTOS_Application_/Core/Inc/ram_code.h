@@ -0,0 +1,26 @@
+#ifndef INC_RAM_CODE_H_
+#define INC_RAM_CODE_H_
+#include "stdint.h"
+
+/*
+ * Code and vector table in SRAM.
+ * RAMFUNC places a function in .ramfunc, which the startup code copies to SRAM: it runs without flash wait states
+ * and without ART accelerator misses. Calls between flash and SRAM go through linker veneers.
+ * The FreeRTOS hot paths (PendSV, SysTick, tick increment, notifications, queue send/receive) are listed by name
+ * in the .ramfunc section of STM32F401RETX_FLASH.ld.
+ */
+#ifndef RAM_FUNCTIONS
+#define RAM_FUNCTIONS	1			// 0 = RAMFUNC functions stay in flash (host build, comparison)
+#endif
+
+#if RAM_FUNCTIONS
+#define RAMFUNC		__attribute__((section(".ramfunc"), noinline))
+#else
+#define RAMFUNC
+#endif
+
+void ram_vector_table_init(void);
+void ram_vector_table_restore(void);
+uint8_t ram_vector_table_active(void);
+
+#endif /* INC_RAM_CODE_H_ */
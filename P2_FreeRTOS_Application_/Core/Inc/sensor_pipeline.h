@@ -0,0 +1,44 @@
+#ifndef INC_SENSOR_PIPELINE_H_
+#define INC_SENSOR_PIPELINE_H_
+#include "stdint.h"
+#include "FreeRTOS.h"
+#include "gpio_out.h"
+#include "stream_filter.h"
+
+#define SENSOR_MAX			16				// ADC1 regular sequence length, and one notification bit per sensor
+
+/* One row of the sensor table: where the sensor is, how it is sampled and filtered, and what it drives */
+typedef struct
+{
+	uint8_t adc_channel;					// ADC1 channel 0..15
+	uint32_t rate_hz;						// sample rate, must divide the fastest rate of the table (initial value)
+	uint32_t filter_window;					// sliding window of the filter, 1..FILTER_WINDOW_MAX samples
+	FilterType_t filter;					// FILTER_MEAN (default), FILTER_EMA or FILTER_MEDIAN
+	uint32_t threshold;						// actuator on when the filtered value is >= threshold (initial value)
+	GPIO_TypeDef *actuator_port;
+	uint8_t actuator_pin;
+} SensorDescriptor_t;
+
+/* State published by the processing task for every sensor */
+typedef struct
+{
+	uint32_t value;							// filter output, updated on every sample
+	uint32_t min;							// smallest reading of the last complete filter_window
+	uint32_t max;							// largest reading of the last complete filter_window
+	TickType_t timestamp;					// tick count when the value was calculated
+	uint32_t sample_cycles;					// cycle count when the scan holding the sample completed (DMA interrupt)
+	uint32_t sample_clock_epoch;			// cycle_counter_clock_epoch() at the same time
+} SensorState_t;
+
+void sensor_pipeline_init(const SensorDescriptor_t *table, uint32_t count);
+uint32_t sensor_pipeline_get_state(uint32_t sensor, SensorState_t *state);
+uint32_t sensor_pipeline_count(void);
+uint8_t sensor_pipeline_set_threshold(uint32_t sensor, uint32_t threshold);
+uint8_t sensor_pipeline_set_rate(uint32_t sensor, uint32_t rate_hz);
+uint32_t sensor_pipeline_overruns(void);
+uint32_t sensor_pipeline_ram_bytes(void);
+uint32_t sensor_pipeline_scan_cycles(void);
+uint32_t sensor_pipeline_scan_cycles_mean(void);
+void sensor_pipeline_scan_interval(uint32_t *min_cycles, uint32_t *max_cycles);
+
+#endif /* INC_SENSOR_PIPELINE_H_ */
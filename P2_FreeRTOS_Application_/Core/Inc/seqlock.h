@@ -0,0 +1,27 @@
+#ifndef INC_SEQLOCK_H_
+#define INC_SEQLOCK_H_
+#include "stdint.h"
+#include "stddef.h"
+
+/*
+ * Sequence lock: one writer publishes a multi-word snapshot, readers copy it without blocking.
+ * The sequence is odd while a write is in progress and even when the snapshot is stable,
+ * so a reader that overlapped a write sees a changed or odd sequence and simply copies again.
+ *
+ * Only ONE task may write a given seqlock. Readers may be tasks or interrupts, but a reader that preempted the
+ * writer (an interrupt, a task of higher priority) would see the odd sequence until it returns to the writer:
+ * seqlock_read gives up after SEQLOCK_READ_RETRIES copies and returns SEQLOCK_BUSY, the copy is then invalid.
+ */
+#define SEQLOCK_READ_RETRIES	8
+#define SEQLOCK_BUSY			UINT32_MAX		// no consistent copy, try again later (e.g. next interrupt)
+
+typedef struct
+{
+	volatile uint32_t sequence;
+} seqlock_t;
+
+void seqlock_init(seqlock_t *lock);
+void seqlock_write(seqlock_t *lock, void *shared, const void *data, size_t size);
+uint32_t seqlock_read(const seqlock_t *lock, const void *shared, void *copy, size_t size);
+
+#endif /* INC_SEQLOCK_H_ */
@@ -0,0 +1,7 @@
+#ifndef INC_SOFT_IRQ_H_
+#define INC_SOFT_IRQ_H_
+
+void soft_irq_init(void (*handler)(void));
+void soft_irq_trigger(void);
+
+#endif /* INC_SOFT_IRQ_H_ */
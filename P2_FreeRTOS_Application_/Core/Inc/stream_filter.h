@@ -0,0 +1,66 @@
+#ifndef INC_STREAM_FILTER_H_
+#define INC_STREAM_FILTER_H_
+#include "stdint.h"
+
+#define FILTER_WINDOW_MAX	32				// longest sliding window, sets the RAM of one filter
+
+typedef enum
+{
+	FILTER_MEAN = 0,						// sliding window mean, O(1) per sample
+	FILTER_EMA,								// exponential moving average with the span of the window, O(1) per sample
+	FILTER_MEDIAN							// sliding window median, O(log window) per sample, ignores spikes
+} FilterType_t;
+
+/* Sliding mean: ring of the window and running sum */
+typedef struct
+{
+	uint16_t samples[FILTER_WINDOW_MAX];
+	uint32_t sum;
+	uint8_t window;
+	uint8_t next;							// oldest sample once the window is full
+	uint8_t count;
+} MeanFilter_t;
+
+/* Exponential moving average, alpha = 2 / (window + 1), fixed point Q16 */
+typedef struct
+{
+	int32_t output;							// Q16
+	int32_t alpha;							// Q16
+	uint8_t primed;
+} EmaFilter_t;
+
+/* Sliding median: the window is split into a max heap (lower half) and a min heap (upper half) of ring slots */
+typedef struct
+{
+	uint16_t samples[FILTER_WINDOW_MAX];
+	uint8_t heap[2][FILTER_WINDOW_MAX/2 + 1];
+	uint8_t heap_count[2];
+	uint8_t heap_of[FILTER_WINDOW_MAX];		// heap holding each slot
+	uint8_t index_of[FILTER_WINDOW_MAX];	// position of each slot in its heap
+	uint8_t window;
+	uint8_t next;
+	uint8_t count;
+} MedianFilter_t;
+
+typedef struct
+{
+	FilterType_t type;
+	union
+	{
+		MeanFilter_t mean;
+		EmaFilter_t ema;
+		MedianFilter_t median;
+	};
+} StreamFilter_t;
+
+void stream_filter_init(StreamFilter_t *filter, FilterType_t type, uint32_t window);
+uint32_t stream_filter_update(StreamFilter_t *filter, uint16_t sample);
+
+void mean_filter_init(MeanFilter_t *filter, uint32_t window);
+uint32_t mean_filter_update(MeanFilter_t *filter, uint16_t sample);
+void ema_filter_init(EmaFilter_t *filter, uint32_t window);
+uint32_t ema_filter_update(EmaFilter_t *filter, uint16_t sample);
+void median_filter_init(MedianFilter_t *filter, uint32_t window);
+uint32_t median_filter_update(MedianFilter_t *filter, uint16_t sample);
+
+#endif /* INC_STREAM_FILTER_H_ */
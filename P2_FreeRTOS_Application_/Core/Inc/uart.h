@@ -1,8 +1,17 @@
 #ifndef INC_UART_H_
 #define INC_UART_H_
 #include "stdio.h"
+#include "stdint.h"
+
+#define UART_RX_NOT_IDLE	0xFFFFFFFFU
+#define UART_RX_PASS_HALF	(1U<<0)			// DMA wrote the last byte of the first half of the ring (HTIF)
+#define UART_RX_PASS_END	(1U<<1)			// DMA wrote the last byte of the ring and wrapped (TCIF)
 
 void USART2_UART_TX_Init(void);
 void USART2_UART_RX_Init(void);
+void USART2_UART_RX_DMA_Init(volatile uint8_t *buffer, uint16_t size);
+uint32_t uart2_rx_idle_status(uint32_t *passes);
+void uart2_tx_flush(void);
+void uart2_update_baud_rate(void);
 
 #endif /* INC_UART_H_ */
@@ -1,5 +1,6 @@
 #include  "adc_interrupt.h"
 #include  "stm32f4xx_hal.h"
+#include  "ram_code.h"
 
 #define GPIOAEN 		(1U<<0)
 #define ADC1EN  		(1U<<8)
@@ -9,6 +10,41 @@
 #define CR2_SWSTART		(1U<<30)
 #define CR2_CONT		(1U<<1)
 #define CR1_EOCIE		(1U<<5)
+#define CR2_EXTSEL		(0xFU<<24)
+#define CR2_EXTSEL_TIM2	(6U<<24)			// EXTSEL = 0110: Timer 2 TRGO event
+#define CR2_EXTEN		(3U<<28)
+#define CR2_EXTEN_RISE	(1U<<28)			// Trigger detection on the rising edge
+
+#define TIM2EN			(1U<<0)
+#define TIM_CEN			(1U<<0)
+#define TIM_MMS_UPDATE	(2U<<4)				// MMS = 010: update event is selected as TRGO
+#define TIM_UG			(1U<<0)
+#define TIM_TICK_HZ		1000000				// Timer counts in microseconds
+
+#define GPIOBEN			(1U<<1)
+#define GPIOCEN			(1U<<2)
+#define DMA2EN			(1U<<22)
+#define CR1_SCAN		(1U<<8)
+#define CR2_DMA			(1U<<8)
+#define CR2_DDS			(1U<<9)				// Keep issuing DMA requests after the last transfer (circular mode)
+#define SQR1_L_POS		20
+#define ADC_CCR_PRE_POS	16
+#define ADC_CCR_PRE		(3U<<16)			// ADCPRE: ADCCLK = PCLK2 / 2, 4, 6 or 8
+#define ADC_CLOCK_MAX_HZ	36000000		// VDDA 2.4 to 3.6 V
+
+#define DMA_SCR_EN		(1U<<0)
+#define DMA_SCR_HTIE	(1U<<3)
+#define DMA_SCR_TCIE	(1U<<4)
+#define DMA_SCR_CIRC	(1U<<8)
+#define DMA_SCR_MINC	(1U<<10)
+#define DMA_SCR_PSIZE16	(1U<<11)
+#define DMA_SCR_MSIZE16	(1U<<13)			// CHSEL = 000: channel 0 of DMA2 Stream 0 is ADC1
+#define DMA_HTIF0		(1U<<4)
+#define DMA_TCIF0		(1U<<5)
+#define DMA_ALLIF0		(0x3DU)				// FEIF0, DMEIF0, TEIF0, HTIF0, TCIF0
+
+static void adc_channel_analog_init(uint8_t channel);
+static uint32_t adc_timer_clock_hz(void);
 
 void adc_interrupt_init()
 {
@@ -39,3 +75,142 @@ void adc_start_conversion(void)
 	//ADC1->CR2 |= CR2_CONT;			// Enable continuous conversion (DISABLED)
 	ADC1->CR2 |= CR2_SWSTART;			// Start conversion
 }
+
+void adc_timer_trigger_init(uint32_t sample_rate_hz)
+{
+	/* 1. Configure TIM2 to generate a TRGO event at the sample rate */
+
+	RCC->APB1ENR |= TIM2EN;				// Enable clock access to TIM2
+
+	TIM2->PSC = (adc_timer_clock_hz() / TIM_TICK_HZ) - 1;	// 1 us per count
+	TIM2->ARR = (TIM_TICK_HZ / sample_rate_hz) - 1;		// Update event every sample period
+	TIM2->CR2 = TIM_MMS_UPDATE;		// Update event drives TRGO
+	TIM2->EGR = TIM_UG;				// Load PSC and ARR now
+
+	/* 2. Let the TRGO event start every ADC conversion, no software start anymore */
+
+	ADC1->CR2 &= ~(CR2_EXTSEL | CR2_EXTEN);
+	ADC1->CR2 |= CR2_EXTSEL_TIM2 | CR2_EXTEN_RISE;
+
+	TIM2->CR1 |= TIM_CEN;			// Start the sample clock
+}
+
+/* Keep the sample rate after a system clock change: only the prescaler depends on the clock, ARR counts microseconds */
+void adc_timer_trigger_update_clock(void)
+{
+	TIM2->PSC = (adc_timer_clock_hz() / TIM_TICK_HZ) - 1;	// Preloaded, takes effect at the next update event
+}
+
+/* Smallest ADC prescaler that keeps ADCCLK within ADC_CLOCK_MAX_HZ for the given APB2 clock */
+void adc_clock_prescaler_set(uint32_t pclk2_hz)
+{
+	uint32_t divider = 2;
+
+	while((pclk2_hz / divider > ADC_CLOCK_MAX_HZ) && (divider < 8))
+	{
+		divider += 2;						// ADCPRE: /2, /4, /6, /8
+	}
+
+	ADC->CCR = (ADC->CCR & ~ADC_CCR_PRE) | (((divider / 2) - 1) << ADC_CCR_PRE_POS);
+}
+
+/*
+ * Scan mode with DMA: every trigger converts all channels in sequence and DMA stores them into buffer.
+ * buffer holds two scans (2 * count samples) and is filled in a circle. The half transfer interrupt
+ * reports that the first scan is complete, the transfer complete interrupt the second one, so the CPU
+ * is interrupted once per scan instead of once per conversion, and can read one half while DMA writes the other.
+ */
+void adc_scan_init(const uint8_t *channels, uint32_t count, volatile uint16_t *buffer)
+{
+	uint32_t i;
+
+	/* 1. Configure the ADC GPIO pins */
+
+	for(i = 0; i < count; i++)
+	{
+		adc_channel_analog_init(channels[i]);
+	}
+
+	/* 2. Configure DMA2 Stream 0 to move ADC1->DR into buffer */
+
+	RCC->AHB1ENR |= DMA2EN;				// Enable clock access to DMA2
+
+	DMA2_Stream0->CR = 0;				// Disable the stream before configuring it
+	while(DMA2_Stream0->CR & DMA_SCR_EN){}
+
+	DMA2->LIFCR = DMA_ALLIF0;			// Clear any old flag of stream 0
+	DMA2_Stream0->PAR = (uint32_t)&ADC1->DR;
+	DMA2_Stream0->M0AR = (uint32_t)buffer;
+	DMA2_Stream0->NDTR = 2 * count;		// Two scans, one per buffer half
+	DMA2_Stream0->CR = DMA_SCR_MSIZE16 | DMA_SCR_PSIZE16 | DMA_SCR_MINC | DMA_SCR_CIRC | DMA_SCR_HTIE | DMA_SCR_TCIE;
+
+	NVIC_SetPriority(DMA2_Stream0_IRQn,5);		// Same priority as the ADC interrupt it replaces
+	NVIC_EnableIRQ(DMA2_Stream0_IRQn);
+
+	DMA2_Stream0->CR |= DMA_SCR_EN;		// Enable the stream
+
+	/* 3. Configure ADC module for a scan of all channels */
+
+	RCC->APB2ENR |= ADC1EN;				// Enable clock access to ADC module
+
+	ADC1->SQR1 = 0;
+	ADC1->SQR2 = 0;
+	ADC1->SQR3 = 0;
+	for(i = 0; i < count; i++)			// 5 bits per rank: SQ1-SQ6 in SQR3, SQ7-SQ12 in SQR2, SQ13-SQ16 in SQR1
+	{
+		if(i < 6)		ADC1->SQR3 |= (uint32_t)channels[i] << (5 * i);
+		else if(i < 12)	ADC1->SQR2 |= (uint32_t)channels[i] << (5 * (i - 6));
+		else			ADC1->SQR1 |= (uint32_t)channels[i] << (5 * (i - 12));
+	}
+	ADC1->SQR1 |= (count - 1) << SQR1_L_POS;	// Conversion sequence length
+
+	ADC1->CR1 &= ~CR1_EOCIE;			// No interrupt per conversion, DMA takes the data
+	ADC1->CR1 |= CR1_SCAN;				// Scan all channels of the sequence
+	ADC1->CR2 |= CR2_DMA | CR2_DDS;		// DMA request after every conversion, continuously
+	ADC1->CR2 |= CR2_ADON;				// Enable ADC module
+}
+
+/* Read and clear the DMA interrupt flags: which half of the scan buffer is ready (ADC_SCAN_FIRST_HALF / ADC_SCAN_SECOND_HALF) */
+RAMFUNC uint32_t adc_scan_irq_status(void)
+{
+	uint32_t flags = DMA2->LISR;
+	uint32_t halves = 0;
+
+	if(flags & DMA_HTIF0) halves |= ADC_SCAN_FIRST_HALF;
+	if(flags & DMA_TCIF0) halves |= ADC_SCAN_SECOND_HALF;
+
+	DMA2->LIFCR = DMA_ALLIF0;
+	return halves;
+}
+
+static uint32_t adc_timer_clock_hz(void)
+{
+	uint32_t timer_clock = HAL_RCC_GetPCLK1Freq();
+
+	if((RCC->CFGR & RCC_CFGR_PPRE1) != RCC_CFGR_PPRE1_DIV1)
+	{
+		timer_clock *= 2;					// APB1 timers run at twice PCLK1 when APB1 is divided
+	}
+
+	return timer_clock;
+}
+
+/* Channels 0-7 are PA0-PA7, 8-9 are PB0-PB1 and 10-15 are PC0-PC5 */
+static void adc_channel_analog_init(uint8_t channel)
+{
+	if(channel < 8)
+	{
+		RCC->AHB1ENR |= GPIOAEN;
+		GPIOA->MODER |= (3U << (2 * channel));
+	}
+	else if(channel < 10)
+	{
+		RCC->AHB1ENR |= GPIOBEN;
+		GPIOB->MODER |= (3U << (2 * (channel - 8)));
+	}
+	else if(channel < 16)
+	{
+		RCC->AHB1ENR |= GPIOCEN;
+		GPIOC->MODER |= (3U << (2 * (channel - 10)));
+	}
+}
@@ -0,0 +1,94 @@
+/*
+ * *** Purpose:
+ * Run at the lowest clock profile at which the sensor pipeline still meets its deadlines.
+ *
+ * *** How it works
+ * Every GOVERNOR_PERIOD_MS the governor task reads how much of the window the idle task ran (FreeRTOS run time stats)
+ * and whether the pipeline lost a scan since the last window.
+ * 1. A lost scan, or less than GOVERNOR_IDLE_MIN % idle, moves one profile up.
+ * 2. Otherwise the busy time is scaled to the next lower profile, assuming the same work takes the same number of
+ *    cycles (true for code from flash within one wait state, optimistic otherwise). If that still leaves
+ *    GOVERNOR_IDLE_TARGET % idle the governor moves one profile down. The gap between both limits avoids oscillation.
+ */
+
+/* Includes */
+#include "cmsis_os.h"
+#include "clock_governor.h"
+#include "clock_profile.h"
+#include "sensor_pipeline.h"
+
+/* Define macros */
+#define STACK_SIZE 				256
+#define GOVERNOR_TASK_PRIORITY	3				// above the pipeline, so the window is measured on time
+
+/* Declare private functions */
+static void vTaskClockGovernor(void *pvParameters);
+
+/* Declare private variables */
+static volatile uint32_t governor_idle_percent = 100;
+
+/* Task Profilers, for debugging only */
+typedef uint32_t TaskProfiler;
+TaskProfiler	taskProfilerGovernorUp, taskProfilerGovernorDown;
+
+
+void clock_governor_init(void)
+{
+	xTaskCreate(vTaskClockGovernor, "Task clock governor", STACK_SIZE, NULL, GOVERNOR_TASK_PRIORITY, NULL);
+}
+
+/* Idle share of the last window, in % */
+uint32_t clock_governor_idle_percent(void)
+{
+	return governor_idle_percent;
+}
+
+/*** task functions */
+
+static void vTaskClockGovernor(void *pvParameters)
+{
+	TickType_t last_wake = xTaskGetTickCount();
+	uint32_t idle_start = ulTaskGetIdleRunTimeCounter();
+	uint32_t total_start = portGET_RUN_TIME_COUNTER_VALUE();
+	uint32_t overruns_start = sensor_pipeline_overruns();
+	uint32_t idle, total, busy, lower_total, overruns;
+	ClockProfile_t profile;
+
+	while(1)
+	{
+		vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(GOVERNOR_PERIOD_MS));
+
+		idle = ulTaskGetIdleRunTimeCounter() - idle_start;		// run time counts wrap, differences do not
+		total = portGET_RUN_TIME_COUNTER_VALUE() - total_start;
+		overruns = sensor_pipeline_overruns() - overruns_start;
+		if((total == 0) || (idle > total))
+		{
+			idle = total;
+		}
+		busy = total - idle;
+		governor_idle_percent = (total > 0) ? (uint32_t)(((uint64_t)idle * 100) / total) : 100;
+
+		profile = clock_profile_get();
+
+		if(((overruns > 0) || (governor_idle_percent < GOVERNOR_IDLE_MIN)) && (profile < CLOCK_PROFILE_84MHZ))
+		{
+			clock_profile_set(profile + 1);
+			taskProfilerGovernorUp++;
+		}
+		else if((overruns == 0) && (profile > CLOCK_PROFILE_16MHZ))
+		{
+			/* Same busy cycles, fewer cycles per window */
+			lower_total = (uint32_t)(((uint64_t)total * clock_profile_hz(profile - 1)) / clock_profile_hz(profile));
+			if((busy < lower_total) && ((uint64_t)(lower_total - busy) * 100 >= (uint64_t)lower_total * GOVERNOR_IDLE_TARGET))
+			{
+				clock_profile_set(profile - 1);
+				taskProfilerGovernorDown++;
+			}
+		}
+
+		/* New window, measured at the clock now in use */
+		idle_start = ulTaskGetIdleRunTimeCounter();
+		total_start = portGET_RUN_TIME_COUNTER_VALUE();
+		overruns_start = sensor_pipeline_overruns();
+	}
+}
@@ -0,0 +1,137 @@
+/*
+ * *** Purpose:
+ * Switch the system clock between the performance profiles of clock_profile.h while FreeRTOS is running.
+ *
+ * *** How it works
+ * The PLL cannot be reprogrammed, nor the regulator voltage scale changed, while it clocks the system. So every switch
+ * 1. moves SYSCLK to HSI, turns the PLL off and sets the voltage scale of the new profile,
+ * 2. restarts the PLL for the new frequency (not for 16 MHz) and moves SYSCLK to it, HAL orders the flash wait states,
+ * 3. recomputes everything derived from the bus clocks: SysTick reload (FreeRTOS tick), HAL timebase (done by HAL),
+ *    USART2 BRR, TIM2 prescaler (ADC sample rate) and ADC prescaler (ADCCLK <= 36 MHz at every step).
+ *
+ * Tasks are suspended during the switch, interrupts keep running, the DWT cycle count changes meaning with the clock:
+ * cycle_counter_clock_changed() marks it before and after, cycle differences across the switch are discarded.
+ */
+
+/* Includes */
+#include "main.h"
+#include "cmsis_os.h"
+#include "clock_profile.h"
+#include "adc_interrupt.h"
+#include "uart.h"
+#include "cycle_counter.h"
+
+/* Declare types */
+typedef struct
+{
+	uint32_t sysclk_hz;
+	uint32_t pll_p;							// 0 = no PLL, SYSCLK is HSI
+	uint32_t voltage_scale;
+	uint32_t flash_latency;
+	uint32_t apb1_divider;					// APB1 must stay <= 42 MHz
+} ClockProfileConfig_t;
+
+/* Declare private variables */
+static const ClockProfileConfig_t clock_profiles[CLOCK_PROFILE_COUNT] =
+{
+	[CLOCK_PROFILE_16MHZ] = { 16000000, 0,             PWR_REGULATOR_VOLTAGE_SCALE3, FLASH_LATENCY_0, RCC_HCLK_DIV1 },
+	[CLOCK_PROFILE_42MHZ] = { 42000000, RCC_PLLP_DIV8, PWR_REGULATOR_VOLTAGE_SCALE3, FLASH_LATENCY_1, RCC_HCLK_DIV1 },
+	[CLOCK_PROFILE_84MHZ] = { 84000000, RCC_PLLP_DIV4, PWR_REGULATOR_VOLTAGE_SCALE2, FLASH_LATENCY_2, RCC_HCLK_DIV2 },
+};
+
+static ClockProfile_t clock_profile_current = CLOCK_PROFILE_84MHZ;	// set by SystemClock_Config
+
+/* Task Profilers, for debugging only */
+typedef uint32_t TaskProfiler;
+TaskProfiler	taskProfilerClockSwitch, taskProfilerClockSwitchError;
+
+
+/* Switch to profile, returns 1 on success. Call from a task, not from an interrupt. */
+uint8_t clock_profile_set(ClockProfile_t profile)
+{
+	const ClockProfileConfig_t *from = &clock_profiles[clock_profile_current];
+	const ClockProfileConfig_t *to;
+	RCC_OscInitTypeDef RCC_OscInitStruct = {0};
+	RCC_ClkInitTypeDef RCC_ClkInitStruct = {0};
+	HAL_StatusTypeDef status;
+
+	if(profile >= CLOCK_PROFILE_COUNT)
+	{
+		return 0;
+	}
+	if(profile == clock_profile_current)
+	{
+		return 1;
+	}
+	to = &clock_profiles[profile];
+
+	vTaskSuspendAll();						// no task runs on a half switched clock
+	uart2_tx_flush();
+	cycle_counter_clock_changed();
+
+	/* ADCCLK must stay within limits with the faster of both APB2 clocks (APB2 = SYSCLK in every profile) */
+	adc_clock_prescaler_set((to->sysclk_hz > from->sysclk_hz) ? to->sysclk_hz : from->sysclk_hz);
+
+	/* 1. Run from HSI, PLL off, new voltage scale */
+	RCC_ClkInitStruct.ClockType = RCC_CLOCKTYPE_HCLK|RCC_CLOCKTYPE_SYSCLK
+								|RCC_CLOCKTYPE_PCLK1|RCC_CLOCKTYPE_PCLK2;
+	RCC_ClkInitStruct.SYSCLKSource = RCC_SYSCLKSOURCE_HSI;
+	RCC_ClkInitStruct.AHBCLKDivider = RCC_SYSCLK_DIV1;
+	RCC_ClkInitStruct.APB1CLKDivider = RCC_HCLK_DIV1;
+	RCC_ClkInitStruct.APB2CLKDivider = RCC_HCLK_DIV1;
+	status = HAL_RCC_ClockConfig(&RCC_ClkInitStruct, (to->flash_latency > from->flash_latency) ? to->flash_latency : from->flash_latency);
+
+	RCC_OscInitStruct.OscillatorType = RCC_OSCILLATORTYPE_NONE;
+	RCC_OscInitStruct.PLL.PLLState = RCC_PLL_OFF;
+	if(status == HAL_OK) status = HAL_RCC_OscConfig(&RCC_OscInitStruct);
+
+	__HAL_PWR_VOLTAGESCALING_CONFIG(to->voltage_scale);
+
+	/* 2. New SYSCLK, same PLL input as SystemClock_Config (HSI / 16 * 336 = 336 MHz VCO) */
+	if((status == HAL_OK) && (to->pll_p != 0))
+	{
+		RCC_OscInitStruct.PLL.PLLState = RCC_PLL_ON;
+		RCC_OscInitStruct.PLL.PLLSource = RCC_PLLSOURCE_HSI;
+		RCC_OscInitStruct.PLL.PLLM = 16;
+		RCC_OscInitStruct.PLL.PLLN = 336;
+		RCC_OscInitStruct.PLL.PLLP = to->pll_p;
+		RCC_OscInitStruct.PLL.PLLQ = 7;
+		status = HAL_RCC_OscConfig(&RCC_OscInitStruct);
+
+		RCC_ClkInitStruct.SYSCLKSource = RCC_SYSCLKSOURCE_PLLCLK;
+	}
+	RCC_ClkInitStruct.APB1CLKDivider = to->apb1_divider;
+	if(status == HAL_OK) status = HAL_RCC_ClockConfig(&RCC_ClkInitStruct, to->flash_latency);
+
+	if(status == HAL_OK)
+	{
+		clock_profile_current = profile;
+		taskProfilerClockSwitch++;
+	}
+	else
+	{
+		taskProfilerClockSwitchError++;		// still on HSI, SystemCoreClock is right for it
+	}
+
+	/* 3. Everything derived from the bus clocks, SystemCoreClock was updated by HAL */
+	SysTick->LOAD = (SystemCoreClock / configTICK_RATE_HZ) - 1UL;
+	SysTick->VAL = 0;
+	uart2_update_baud_rate();
+	adc_timer_trigger_update_clock();
+	adc_clock_prescaler_set(HAL_RCC_GetPCLK2Freq());
+	cycle_counter_clock_changed();
+
+	xTaskResumeAll();
+
+	return (status == HAL_OK);
+}
+
+ClockProfile_t clock_profile_get(void)
+{
+	return clock_profile_current;
+}
+
+uint32_t clock_profile_hz(ClockProfile_t profile)
+{
+	return clock_profiles[profile].sysclk_hz;
+}
@@ -0,0 +1,242 @@
+/*
+ * *** Purpose:
+ * Command and telemetry channel on USART2: change thresholds and sample rates while running, and read the sensor state.
+ *
+ * *** How it works
+ * 1. DMA receives every byte into a circular buffer, the USART interrupts once when the line goes idle after a frame.
+ * 2. The USART2 interrupt copies the new part of the ring into a stream buffer, one send per frame.
+ *    A frame longer than the ring overwrote itself: it is dropped and counted (taskProfilerCommandOverrun).
+ * 3. Task Parse commands, woken by the stream buffer, splits the bytes into lines and answers on the same UART.
+ *
+ * Commands, one per line:
+ *   threshold <sensor> <value>		-> ok | error
+ *   rate <sensor> <hz>				-> ok | error	(hz must divide the scan rate)
+ *   state <sensor>					-> state <sensor> <value> <min> <max> <tick> | error
+ *   latency						-> latency <count> <min_us> <avg_us> <max_us>, then bucket <from_us> <count> lines
+ *   latency reset					-> ok
+ *   memory							-> stack and heap report of memory_profile.c
+ */
+
+/* Includes */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cmsis_os.h"
+#include "stream_buffer.h"
+#include "command_channel.h"
+#include "sensor_pipeline.h"
+#include "seqlock.h"
+#include "uart.h"
+#include "latency_histogram.h"
+#include "memory_profile.h"
+
+/* Define macros */
+#define STACK_SIZE 				256
+#define COMMAND_TASK_PRIORITY	1
+
+/* Declare private functions */
+static void vTaskParseCommands(void *pvParameters);
+static void command_channel_execute(char *line);
+static uint8_t command_channel_overrun(uint32_t head, uint32_t passes);
+
+/* Declare private variables */
+static volatile uint8_t rx_buffer[COMMAND_RX_BUFFER_SIZE];	// filled by DMA
+static uint32_t rx_tail;									// first byte not yet handed to the parser
+static StreamBufferHandle_t xStreamHandleCommand;
+
+/* Task Profilers, for debugging only */
+typedef uint32_t TaskProfiler;
+TaskProfiler	taskProfilerCommandIRQ, taskProfilerCommandBytes, taskProfilerCommandDropped,
+				taskProfilerCommandOverrun, taskProfilerParseCommands;
+
+
+void command_channel_init(void)
+{
+	xStreamHandleCommand = xStreamBufferCreate(COMMAND_STREAM_SIZE, 1);
+	configASSERT(xStreamHandleCommand != NULL);
+
+	xTaskCreate(vTaskParseCommands, "Task parse commands", STACK_SIZE, NULL, COMMAND_TASK_PRIORITY, NULL);
+
+	rx_tail = 0;
+	USART2_UART_RX_DMA_Init(rx_buffer, COMMAND_RX_BUFFER_SIZE);
+}
+
+/* Feed text to the parser as if it was received, e.g. to exercise the commands without a terminal */
+void command_channel_inject(const char *text)
+{
+	BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+
+	taskENTER_CRITICAL();					// the USART interrupt is the other writer of the stream buffer
+	xStreamBufferSendFromISR(xStreamHandleCommand, text, strlen(text), &xHigherPriorityTaskWoken);
+	taskEXIT_CRITICAL();
+
+	if(xHigherPriorityTaskWoken == pdTRUE)
+	{
+		taskYIELD();
+	}
+}
+
+/*** task functions */
+
+static void vTaskParseCommands(void *pvParameters)
+{
+	char line[COMMAND_LINE_MAX + 1];
+	uint32_t line_length = 0;
+	uint8_t line_overflow = 0;
+	uint8_t chunk[32];
+	size_t received;
+	size_t i;
+
+	while(1)
+	{
+		received = xStreamBufferReceive(xStreamHandleCommand, chunk, sizeof(chunk), portMAX_DELAY);
+		taskProfilerParseCommands++;
+
+		for(i = 0; i < received; i++)
+		{
+			if((chunk[i] == '\n') || (chunk[i] == '\r'))
+			{
+				if(line_overflow)
+				{
+					printf("error\n");				// line longer than COMMAND_LINE_MAX
+				}
+				else if(line_length > 0)
+				{
+					line[line_length] = '\0';
+					command_channel_execute(line);
+				}
+				line_length = 0;
+				line_overflow = 0;
+			}
+			else if(line_length < COMMAND_LINE_MAX)
+			{
+				line[line_length++] = (char)chunk[i];
+			}
+			else
+			{
+				line_overflow = 1;
+			}
+		}
+	}
+}
+
+static void command_channel_execute(char *line)
+{
+	char *saveptr;
+	char *command = strtok_r(line, " \t", &saveptr);
+	char *argument1 = strtok_r(NULL, " \t", &saveptr);
+	char *argument2 = strtok_r(NULL, " \t", &saveptr);
+	uint32_t sensor;
+	SensorState_t state;
+
+	if((command != NULL) && (strcmp(command, "latency") == 0))
+	{
+		if(argument1 == NULL)
+		{
+			latency_histogram_print();
+		}
+		else if(strcmp(argument1, "reset") == 0)
+		{
+			latency_histogram_reset();
+			printf("ok\n");
+		}
+		else
+		{
+			printf("error\n");
+		}
+		return;
+	}
+
+	if((command != NULL) && (strcmp(command, "memory") == 0))
+	{
+		memory_profile_print();
+		return;
+	}
+
+	if((command == NULL) || (argument1 == NULL))
+	{
+		printf("error\n");
+		return;
+	}
+
+	sensor = strtoul(argument1, NULL, 10);
+
+	if((strcmp(command, "threshold") == 0) && (argument2 != NULL))
+	{
+		printf(sensor_pipeline_set_threshold(sensor, strtoul(argument2, NULL, 10)) ? "ok\n" : "error\n");
+	}
+	else if((strcmp(command, "rate") == 0) && (argument2 != NULL))
+	{
+		printf(sensor_pipeline_set_rate(sensor, strtoul(argument2, NULL, 10)) ? "ok\n" : "error\n");
+	}
+	else if((strcmp(command, "state") == 0) && (sensor < sensor_pipeline_count())
+			&& (sensor_pipeline_get_state(sensor, &state) != SEQLOCK_BUSY))
+	{
+		printf("state %lu %lu %lu %lu %lu\n", (unsigned long)sensor, (unsigned long)state.value,
+			   (unsigned long)state.min, (unsigned long)state.max, (unsigned long)state.timestamp);
+	}
+	else
+	{
+		printf("error\n");
+	}
+}
+
+/* USART2 interrupt handler: the line went idle, hand the new bytes of the ring to the parser */
+void USART2_IRQHandler(void)
+{
+	BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+	uint32_t passes;
+	uint32_t head = uart2_rx_idle_status(&passes);
+	size_t length = 0;
+	size_t sent = 0;
+
+	if(head == UART_RX_NOT_IDLE)
+	{
+		return;
+	}
+
+	taskProfilerCommandIRQ++;
+
+	if(command_channel_overrun(head, passes))
+	{
+		taskProfilerCommandOverrun++;			// DMA went around the ring past rx_tail, the frame is lost
+		rx_tail = head;
+		return;
+	}
+
+	if(head < rx_tail)							// DMA wrapped around: the end of the ring first
+	{
+		length += COMMAND_RX_BUFFER_SIZE - rx_tail;
+		sent += xStreamBufferSendFromISR(xStreamHandleCommand, (const void *)&rx_buffer[rx_tail],
+										 COMMAND_RX_BUFFER_SIZE - rx_tail, &xHigherPriorityTaskWoken);
+		rx_tail = 0;
+	}
+	if(head > rx_tail)
+	{
+		length += head - rx_tail;
+		sent += xStreamBufferSendFromISR(xStreamHandleCommand, (const void *)&rx_buffer[rx_tail],
+										 head - rx_tail, &xHigherPriorityTaskWoken);
+	}
+	rx_tail = head;
+
+	taskProfilerCommandBytes += length;
+	taskProfilerCommandDropped += length - sent;	// parser too slow, the stream buffer was full
+
+	portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+}
+
+/* From rx_tail, DMA went around the whole ring: it came back to rx_tail, or passed a position twice */
+static uint8_t command_channel_overrun(uint32_t head, uint32_t passes)
+{
+	const uint32_t half = COMMAND_RX_BUFFER_SIZE / 2;
+
+	if(!(passes & UART_RX_PASS_END))
+	{
+		return 0;							// no wrap, head >= rx_tail
+	}
+	if(head >= rx_tail)
+	{
+		return 1;							// wrapped and reached rx_tail again
+	}
+	return (passes & UART_RX_PASS_HALF) && (rx_tail >= half) && (head < half);	// the half is not on the way from rx_tail to head
+}
@@ -0,0 +1,40 @@
+#include  "cycle_counter.h"
+#include  "stm32f4xx_hal.h"
+#include  "ram_code.h"
+
+static volatile uint32_t clock_epoch;					// changes when the cycles change meaning, see cycle_counter_clock_changed
+
+void cycle_counter_init(void)
+{
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;		// Enable access to the DWT unit
+	DWT->CYCCNT = 0;									// Reset the cycle counter
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;				// Start counting core clock cycles
+}
+
+RAMFUNC uint32_t cycle_counter_get(void)
+{
+	return DWT->CYCCNT;									// Wraps every 2^32 cycles (~51 s at 84 MHz), differences stay valid
+}
+
+/* Cycles at the current core clock to microseconds: the cycles must lie within one clock epoch */
+uint32_t cycle_counter_to_us(uint32_t cycles)
+{
+	return cycles / (SystemCoreClock / 1000000U);
+}
+
+/* Stamp it with the start cycles: a difference of cycles converts right only if the epoch is the same at the end */
+RAMFUNC uint32_t cycle_counter_clock_epoch(void)
+{
+	return clock_epoch;
+}
+
+/* Called by clock_profile_set before and after a switch, a start stamp taken during the switch has an epoch of its own */
+void cycle_counter_clock_changed(void)
+{
+	clock_epoch++;
+}
+
+const char *cycle_counter_unit(void)
+{
+	return "cycles";
+}
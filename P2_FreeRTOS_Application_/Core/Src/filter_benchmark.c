@@ -0,0 +1,226 @@
+/*
+ * *** Purpose:
+ * Compare the streaming filters (stream_filter.c) with the block mean the pipeline used before,
+ * in CPU cost per sample and in how fast a decision follows the input.
+ *
+ * *** How it works
+ * Every filter runs for every window of bench_windows:
+ * 1. cost: FILTER_BENCH_SAMPLES samples of a noisy triangle wave, total time / samples.
+ * 2. step latency: the input steps from FILTER_BENCH_LOW to FILTER_BENCH_HIGH, counted in samples until an output
+ *    crosses the middle. The step is repeated at every phase of the block, the worst case is reported.
+ * 3. spike: one full scale sample on a flat FILTER_BENCH_LOW input, largest deviation of the output.
+ * The block mean gives one output per window, the streaming filters one per sample.
+ *
+ * *** Output
+ * One CSV line per filter and window over printf (UART on target, stdout on host):
+ * filter,window,samples,total,per_sample,unit,step_latency_samples,spike_deviation
+ * The unit is "cycles" on target (DWT) and "ns" on the host build.
+ */
+
+/* Includes */
+#include <stdio.h>
+#include "cmsis_os.h"
+#include "filter_benchmark.h"
+#include "stream_filter.h"
+#include "cycle_counter.h"
+
+/* Define macros */
+#define FILTER_BENCH_SAMPLES		1000
+#define FILTER_BENCH_STACK_SIZE		256
+#define FILTER_BENCH_PRIORITY		1
+#define FILTER_BENCH_LOW			1000
+#define FILTER_BENCH_HIGH			3000
+#define FILTER_BENCH_SPIKE			4095
+#define FILTER_BENCH_NO_OUTPUT		UINT32_MAX
+
+/* Declare types */
+typedef enum
+{
+	BENCH_BLOCK_MEAN = 0,							// one output every window samples, the previous pipeline
+	BENCH_MEAN,
+	BENCH_EMA,
+	BENCH_MEDIAN,
+	BENCH_FILTER_COUNT
+} BenchFilter_t;
+
+typedef struct
+{
+	uint32_t sum;
+	uint32_t count;
+	uint32_t window;
+} BlockMean_t;
+
+typedef struct
+{
+	BenchFilter_t type;
+	BlockMean_t block;
+	StreamFilter_t stream;
+} BenchFilterState_t;
+
+/* Declare private functions */
+static void vTaskFilterBench(void *pvParameters);
+static void bench_filter_init(BenchFilterState_t *state, BenchFilter_t type, uint32_t window);
+static uint32_t bench_filter_update(BenchFilterState_t *state, uint16_t sample);
+static uint32_t bench_cost(BenchFilter_t type, uint32_t window);
+static uint32_t bench_step_latency(BenchFilter_t type, uint32_t window);
+static uint32_t bench_spike_deviation(BenchFilter_t type, uint32_t window);
+static uint16_t bench_input(uint32_t n);
+
+/* Declare private variables */
+static const char *const bench_filter_names[BENCH_FILTER_COUNT] = { "block_mean", "mean", "ema", "median" };
+static const uint32_t bench_windows[] = { 5, 10, 32 };
+static BenchFilterState_t bench_state;
+static volatile uint8_t bench_done;
+
+
+/* Create the benchmark task, the benchmark runs once the scheduler is started */
+void filter_benchmark_init(void)
+{
+	xTaskCreate(vTaskFilterBench, "Filter bench", FILTER_BENCH_STACK_SIZE, NULL, FILTER_BENCH_PRIORITY, NULL);
+}
+
+uint8_t filter_benchmark_finished(void)
+{
+	return bench_done;
+}
+
+/*** task functions */
+
+static void vTaskFilterBench(void *pvParameters)
+{
+	uint32_t window, total;
+	BenchFilter_t type;
+
+	printf("filter,window,samples,total,per_sample,unit,step_latency_samples,spike_deviation\r\n");
+
+	for(window = 0; window < sizeof(bench_windows)/sizeof(bench_windows[0]); window++)
+	{
+		for(type = BENCH_BLOCK_MEAN; type < BENCH_FILTER_COUNT; type++)
+		{
+			total = bench_cost(type, bench_windows[window]);
+			printf("%s,%lu,%lu,%lu,%lu,%s,%lu,%lu\r\n", bench_filter_names[type], (unsigned long)bench_windows[window],
+				   (unsigned long)FILTER_BENCH_SAMPLES, (unsigned long)total, (unsigned long)(total / FILTER_BENCH_SAMPLES),
+				   cycle_counter_unit(), (unsigned long)bench_step_latency(type, bench_windows[window]),
+				   (unsigned long)bench_spike_deviation(type, bench_windows[window]));
+		}
+	}
+
+	printf("# done\r\n");
+	bench_done = 1;
+
+	while(1)
+	{
+		vTaskSuspend(NULL);
+	}
+}
+
+static void bench_filter_init(BenchFilterState_t *state, BenchFilter_t type, uint32_t window)
+{
+	state->type = type;
+	state->block.sum = 0;
+	state->block.count = 0;
+	state->block.window = window;
+
+	switch(type)
+	{
+	case BENCH_EMA:		stream_filter_init(&state->stream, FILTER_EMA, window);		break;
+	case BENCH_MEDIAN:	stream_filter_init(&state->stream, FILTER_MEDIAN, window);	break;
+	default:			stream_filter_init(&state->stream, FILTER_MEAN, window);	break;
+	}
+}
+
+/* Filter output for this sample, FILTER_BENCH_NO_OUTPUT while a block is not complete */
+static uint32_t bench_filter_update(BenchFilterState_t *state, uint16_t sample)
+{
+	uint32_t output;
+
+	if(state->type != BENCH_BLOCK_MEAN)
+	{
+		return stream_filter_update(&state->stream, sample);
+	}
+
+	state->block.sum += sample;
+	if(++state->block.count < state->block.window)
+	{
+		return FILTER_BENCH_NO_OUTPUT;
+	}
+	output = state->block.sum / state->block.count;
+	state->block.sum = 0;
+	state->block.count = 0;
+	return output;
+}
+
+static uint32_t bench_cost(BenchFilter_t type, uint32_t window)
+{
+	volatile uint32_t sink;
+	uint32_t start, n;
+
+	bench_filter_init(&bench_state, type, window);
+
+	start = cycle_counter_get();
+	for(n = 0; n < FILTER_BENCH_SAMPLES; n++)
+	{
+		sink = bench_filter_update(&bench_state, bench_input(n));
+	}
+	(void)sink;
+
+	return cycle_counter_get() - start;
+}
+
+/* Worst case over the block phases, in samples from the step to the first output above the middle */
+static uint32_t bench_step_latency(BenchFilter_t type, uint32_t window)
+{
+	const uint32_t middle = (FILTER_BENCH_LOW + FILTER_BENCH_HIGH) / 2;
+	uint32_t worst = 0;
+	uint32_t phase, n, output;
+
+	for(phase = 0; phase < window; phase++)
+	{
+		bench_filter_init(&bench_state, type, window);
+
+		for(n = 0; n < window + phase; n++)					// settle on the low level, then phase samples into a block
+		{
+			bench_filter_update(&bench_state, FILTER_BENCH_LOW);
+		}
+		for(n = 1; n <= 4 * window; n++)
+		{
+			output = bench_filter_update(&bench_state, FILTER_BENCH_HIGH);
+			if((output != FILTER_BENCH_NO_OUTPUT) && (output > middle))
+			{
+				break;
+			}
+		}
+		if(n > worst) worst = n;
+	}
+
+	return worst;
+}
+
+static uint32_t bench_spike_deviation(BenchFilter_t type, uint32_t window)
+{
+	uint32_t deviation = 0;
+	uint32_t n, output;
+
+	bench_filter_init(&bench_state, type, window);
+
+	for(n = 0; n < 3 * window; n++)
+	{
+		output = bench_filter_update(&bench_state, (n == window) ? FILTER_BENCH_SPIKE : FILTER_BENCH_LOW);
+		if((output != FILTER_BENCH_NO_OUTPUT) && (output - FILTER_BENCH_LOW > deviation))
+		{
+			deviation = output - FILTER_BENCH_LOW;			// outputs never go below the flat level
+		}
+	}
+
+	return deviation;
+}
+
+/* Triangle wave 0..4000 with a pseudo random noise of 0..31 counts */
+static uint16_t bench_input(uint32_t n)
+{
+	uint32_t phase = n % 200;
+	uint32_t triangle = (phase < 100) ? (phase * 40) : ((200 - phase) * 40);
+	uint32_t noise = (n * 1103515245U + 12345U) >> 27;
+
+	return (uint16_t)(triangle + noise);
+}
@@ -0,0 +1,162 @@
+#include  "frame_pool.h"
+#include  "task.h"
+
+#define FRAME_OWNER_POOL	((void *)0)			// frame is free
+#define FRAME_OWNER_QUEUE	((void *)1)			// frame pointer is in a queue, nobody may touch it
+#define FRAME_OWNER_ISR		((void *)2)			// frame was allocated by an interrupt handler
+
+#if FRAME_POOL_DEBUG
+#define FRAME_SET_OWNER(frame, new_owner)		((frame)->owner = (new_owner))
+#define FRAME_CHECK_OWNER(frame, expected)		configASSERT((frame)->owner == (expected))
+#define FRAME_CHECK_IN_POOL(frame)				configASSERT(((frame) >= &frame_pool[0]) && ((frame) <= &frame_pool[FRAME_POOL_LENGTH-1]))
+#else
+#define FRAME_SET_OWNER(frame, new_owner)
+#define FRAME_CHECK_OWNER(frame, expected)
+#define FRAME_CHECK_IN_POOL(frame)
+#endif
+
+static SensorFrame_t frame_pool[FRAME_POOL_LENGTH];		// static storage, no heap
+static SensorFrame_t *frame_free_list[FRAME_POOL_LENGTH];	// stack of free frames
+static uint32_t frame_free_count;
+
+static SensorFrame_t *frame_pool_pop(void);
+static void frame_pool_push(SensorFrame_t *frame);
+
+void frame_pool_init(void)
+{
+	uint32_t i;
+
+	for(i = 0; i < FRAME_POOL_LENGTH; i++)
+	{
+		FRAME_SET_OWNER(&frame_pool[i], FRAME_OWNER_POOL);
+		frame_free_list[i] = &frame_pool[i];
+	}
+	frame_free_count = FRAME_POOL_LENGTH;
+}
+
+uint32_t frame_pool_available(void)
+{
+	return frame_free_count;
+}
+
+/* Take a frame from the pool, NULL if all frames are in use */
+SensorFrame_t *frame_pool_alloc(void)
+{
+	SensorFrame_t *frame;
+
+	taskENTER_CRITICAL();
+	frame = frame_pool_pop();
+	taskEXIT_CRITICAL();
+
+	if(frame != NULL)
+	{
+		FRAME_SET_OWNER(frame, xTaskGetCurrentTaskHandle());
+	}
+	return frame;
+}
+
+SensorFrame_t *frame_pool_alloc_from_isr(void)
+{
+	SensorFrame_t *frame;
+	UBaseType_t uxSavedInterruptStatus;
+
+	uxSavedInterruptStatus = taskENTER_CRITICAL_FROM_ISR();
+	frame = frame_pool_pop();
+	taskEXIT_CRITICAL_FROM_ISR(uxSavedInterruptStatus);
+
+	if(frame != NULL)
+	{
+		FRAME_SET_OWNER(frame, FRAME_OWNER_ISR);
+	}
+	return frame;
+}
+
+/* Return a frame to the pool, only its current owner may do it */
+void frame_pool_free(SensorFrame_t *frame)
+{
+	FRAME_CHECK_IN_POOL(frame);
+	FRAME_CHECK_OWNER(frame, xTaskGetCurrentTaskHandle());
+	FRAME_SET_OWNER(frame, FRAME_OWNER_POOL);
+
+	taskENTER_CRITICAL();
+	frame_pool_push(frame);
+	taskEXIT_CRITICAL();
+}
+
+/* Return a frame allocated by an interrupt handler (frame_pool_alloc_from_isr) and not sent */
+void frame_pool_free_from_isr(SensorFrame_t *frame)
+{
+	UBaseType_t uxSavedInterruptStatus;
+
+	FRAME_CHECK_IN_POOL(frame);
+	FRAME_CHECK_OWNER(frame, FRAME_OWNER_ISR);
+	FRAME_SET_OWNER(frame, FRAME_OWNER_POOL);
+
+	uxSavedInterruptStatus = taskENTER_CRITICAL_FROM_ISR();
+	frame_pool_push(frame);
+	taskEXIT_CRITICAL_FROM_ISR(uxSavedInterruptStatus);
+}
+
+/* Send only the pointer, the frame belongs to the queue until it is received */
+BaseType_t frame_pool_send(QueueHandle_t queue, SensorFrame_t *frame, TickType_t ticks_to_wait)
+{
+	BaseType_t status;
+
+	FRAME_CHECK_IN_POOL(frame);
+	FRAME_CHECK_OWNER(frame, xTaskGetCurrentTaskHandle());
+	FRAME_SET_OWNER(frame, FRAME_OWNER_QUEUE);
+
+	status = xQueueSend(queue, &frame, ticks_to_wait);
+	if(status != pdPASS)
+	{
+		FRAME_SET_OWNER(frame, xTaskGetCurrentTaskHandle());		// queue full, the sender still owns the frame
+	}
+	return status;
+}
+
+BaseType_t frame_pool_send_from_isr(QueueHandle_t queue, SensorFrame_t *frame, BaseType_t *pxHigherPriorityTaskWoken)
+{
+	BaseType_t status;
+
+	FRAME_CHECK_IN_POOL(frame);
+	FRAME_CHECK_OWNER(frame, FRAME_OWNER_ISR);
+	FRAME_SET_OWNER(frame, FRAME_OWNER_QUEUE);
+
+	status = xQueueSendFromISR(queue, &frame, pxHigherPriorityTaskWoken);
+	if(status != pdPASS)
+	{
+		FRAME_SET_OWNER(frame, FRAME_OWNER_ISR);
+	}
+	return status;
+}
+
+BaseType_t frame_pool_receive(QueueHandle_t queue, SensorFrame_t **frame, TickType_t ticks_to_wait)
+{
+	BaseType_t status;
+
+	status = xQueueReceive(queue, frame, ticks_to_wait);
+	if(status == pdPASS)
+	{
+		FRAME_CHECK_IN_POOL(*frame);
+		FRAME_CHECK_OWNER(*frame, FRAME_OWNER_QUEUE);
+		FRAME_SET_OWNER(*frame, xTaskGetCurrentTaskHandle());
+	}
+	return status;
+}
+
+/* Caller holds the critical section */
+static SensorFrame_t *frame_pool_pop(void)
+{
+	if(frame_free_count == 0)
+	{
+		return NULL;
+	}
+	return frame_free_list[--frame_free_count];
+}
+
+/* Caller holds the critical section. Checked in every build: a double free would write past frame_free_list */
+static void frame_pool_push(SensorFrame_t *frame)
+{
+	configASSERT(frame_free_count < FRAME_POOL_LENGTH);
+	frame_free_list[frame_free_count++] = frame;
+}
@@ -19,3 +19,15 @@ void GPIO_OUT_off(void)
 {
 	GPIOA->ODR &=~ GPIO_OUT_PIN;
 }
+
+void GPIO_OUT_pin_init(GPIO_TypeDef *port, uint8_t pin)
+{
+	RCC->AHB1ENR |= (1U << (((uint32_t)port - GPIOA_BASE) / 0x400U));	// GPIOx ports are 0x400 apart, enable bits follow the same order
+	port->MODER &=~ (3U << (2 * pin));
+	port->MODER |= (1U << (2 * pin));									// General purpose output mode
+}
+
+void GPIO_OUT_pin_write(GPIO_TypeDef *port, uint8_t pin, uint8_t state)
+{
+	port->BSRR = state ? (1U << pin) : (1U << (pin + 16));				// Atomic set/reset, no read-modify-write
+}
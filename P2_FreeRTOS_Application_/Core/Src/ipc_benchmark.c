@@ -0,0 +1,596 @@
+/*
+ * *** Purpose:
+ * Measure the cost per operation of the FreeRTOS inter-task communication objects,
+ * to compare them before choosing one for the sensor pipeline.
+ *
+ * *** How it works
+ * A controller task sends BENCH_ITERATIONS items to a receiver task of higher priority, so every send
+ * wakes the receiver and every receive blocks it again. The time from the first send to the last receive,
+ * divided by BENCH_ITERATIONS, is the cost of one complete hand-over (send + switch + receive + switch back).
+ * 1. task path: the controller task sends.
+ * 2. isr path: the controller pends a software interrupt and the interrupt handler sends with the FromISR API.
+ * Queues, stream buffers and message buffers are measured for every size of bench_item_sizes.
+ * Mutexes cannot be given from an interrupt nor handed to another task, so only take + give in one task is measured.
+ * Waveform frames (SensorFrame_t) are measured copied through a queue (frame_by_value) and passed as a pointer
+ * from the frame pool (frame_by_reference), to show the cost of the copy against the zero-copy path.
+ * frame_by_reference is split into its two parts: the pointer hand-over alone (frame_pointer, always the same frame,
+ * no pool) and frame_pool_alloc + frame_pool_free in one task (frame_pool,alloc_free). Build with FRAME_POOL_DEBUG 0
+ * (make bench does) or the ownership checks of the debug build are timed too.
+ * One averaging period of the sensor pipeline (SensorState_t from the processing task to the action task, task path
+ * only) is measured with the mutex and semaphore of the original main.c (sensor_state_mutex: mutex take/give on both
+ * sides plus the wake-up) and with the seqlock of sensor_pipeline.c (sensor_state_seqlock: only the wake-up blocks).
+ *
+ * *** Output
+ * One CSV line per measurement over printf (UART on target, stdout on host):
+ * primitive,path,item_bytes,iterations,total,per_op,unit
+ * The unit is "cycles" on target (DWT) and "ns" on the host build.
+ */
+
+/* Includes */
+#include <stdio.h>
+#include "cmsis_os.h"
+#include "event_groups.h"
+#include "stream_buffer.h"
+#include "message_buffer.h"
+#include "ipc_benchmark.h"
+#include "cycle_counter.h"
+#include "soft_irq.h"
+#include "frame_pool.h"
+#include "seqlock.h"
+#include "sensor_pipeline.h"
+
+/* Define macros */
+#define BENCH_ITERATIONS			1000
+#define BENCH_QUEUE_LENGTH			8
+#define BENCH_MAX_ITEM_SIZE			256
+#define BENCH_STACK_SIZE			256
+#define BENCH_CONTROLLER_PRIORITY	1
+#define BENCH_RECEIVER_PRIORITY		(configTIMER_TASK_PRIORITY + 1)		// above the timer task, which runs the event group ISR path
+#define BENCH_EVENT_BIT				(1U<<0)
+#define BENCH_FRAME_QUEUE_LENGTH	2
+
+/* Declare types */
+typedef enum
+{
+	BENCH_PATH_TASK = 0,
+	BENCH_PATH_ISR
+} BenchPath_t;
+
+typedef struct
+{
+	const char *name;
+	uint8_t sized;													// 1 if the item size is a parameter of this object
+	void (*create)(uint32_t item_size);
+	void (*destroy)(void);
+	void (*send)(uint32_t item_size);
+	void (*send_from_isr)(uint32_t item_size, BaseType_t *pxHigherPriorityTaskWoken);
+	void (*receive)(uint32_t item_size);
+} BenchPrimitive_t;
+
+/* Declare private functions */
+static void vTaskBenchController(void *pvParameters);
+static void vTaskBenchReceiver(void *pvParameters);
+static void bench_isr(void);
+static void bench_run(const BenchPrimitive_t *primitive, BenchPath_t path, uint32_t item_size);
+static void bench_run_mutex(void);
+static void bench_print(const char *name, const char *path, uint32_t item_size, uint32_t total);
+
+static void queue_create(uint32_t item_size);
+static void queue_destroy(void);
+static void queue_send(uint32_t item_size);
+static void queue_send_from_isr(uint32_t item_size, BaseType_t *pxHigherPriorityTaskWoken);
+static void queue_receive(uint32_t item_size);
+static void notify_create(uint32_t item_size);
+static void notify_destroy(void);
+static void notify_send(uint32_t item_size);
+static void notify_send_from_isr(uint32_t item_size, BaseType_t *pxHigherPriorityTaskWoken);
+static void notify_receive(uint32_t item_size);
+static void semaphore_create(uint32_t item_size);
+static void semaphore_destroy(void);
+static void semaphore_send(uint32_t item_size);
+static void semaphore_send_from_isr(uint32_t item_size, BaseType_t *pxHigherPriorityTaskWoken);
+static void semaphore_receive(uint32_t item_size);
+static void stream_create(uint32_t item_size);
+static void message_create(uint32_t item_size);
+static void stream_destroy(void);
+static void stream_send(uint32_t item_size);
+static void stream_send_from_isr(uint32_t item_size, BaseType_t *pxHigherPriorityTaskWoken);
+static void stream_receive(uint32_t item_size);
+static void event_create(uint32_t item_size);
+static void event_destroy(void);
+static void event_send(uint32_t item_size);
+static void event_send_from_isr(uint32_t item_size, BaseType_t *pxHigherPriorityTaskWoken);
+static void event_receive(uint32_t item_size);
+static void frame_value_create(uint32_t item_size);
+static void frame_value_send(uint32_t item_size);
+static void frame_value_send_from_isr(uint32_t item_size, BaseType_t *pxHigherPriorityTaskWoken);
+static void frame_value_receive(uint32_t item_size);
+static void frame_reference_create(uint32_t item_size);
+static void frame_reference_send(uint32_t item_size);
+static void frame_reference_send_from_isr(uint32_t item_size, BaseType_t *pxHigherPriorityTaskWoken);
+static void frame_reference_receive(uint32_t item_size);
+static void frame_pointer_send(uint32_t item_size);
+static void frame_pointer_send_from_isr(uint32_t item_size, BaseType_t *pxHigherPriorityTaskWoken);
+static void frame_pointer_receive(uint32_t item_size);
+static void bench_run_frame_pool(void);
+static void state_mutex_create(uint32_t item_size);
+static void state_mutex_destroy(void);
+static void state_mutex_send(uint32_t item_size);
+static void state_mutex_receive(uint32_t item_size);
+static void state_seqlock_create(uint32_t item_size);
+static void state_seqlock_send(uint32_t item_size);
+static void state_seqlock_receive(uint32_t item_size);
+
+/* Declare private variables */
+static const uint32_t bench_item_sizes[] = {4, 8, 16, 32, 64, 128, 256};
+
+static const BenchPrimitive_t bench_primitives[] =
+{
+	{"queue",			1, queue_create,	 queue_destroy,		queue_send,		queue_send_from_isr,	 queue_receive},
+	{"task_notify",		0, notify_create,	 notify_destroy,	notify_send,	notify_send_from_isr,	 notify_receive},
+	{"binary_semaphore",0, semaphore_create, semaphore_destroy,	semaphore_send,	semaphore_send_from_isr, semaphore_receive},
+	{"stream_buffer",	1, stream_create,	 stream_destroy,	stream_send,	stream_send_from_isr,	 stream_receive},
+	{"message_buffer",	1, message_create,	 stream_destroy,	stream_send,	stream_send_from_isr,	 stream_receive},
+	{"event_group",		0, event_create,	 event_destroy,		event_send,		event_send_from_isr,	 event_receive},
+};
+
+static const BenchPrimitive_t bench_frame_primitives[] =
+{
+	{"frame_by_value",		1, frame_value_create,		queue_destroy, frame_value_send,	 frame_value_send_from_isr,		frame_value_receive},
+	{"frame_by_reference",	1, frame_reference_create,	queue_destroy, frame_reference_send, frame_reference_send_from_isr, frame_reference_receive},
+	{"frame_pointer",		1, frame_reference_create,	queue_destroy, frame_pointer_send,	 frame_pointer_send_from_isr,	frame_pointer_receive},
+};
+
+/* Task path only: the processing task publishes, a mutex cannot be taken from an interrupt */
+static const BenchPrimitive_t bench_state_primitives[] =
+{
+	{"sensor_state_mutex",		1, state_mutex_create,		state_mutex_destroy, state_mutex_send,	 NULL, state_mutex_receive},
+	{"sensor_state_seqlock",	1, state_seqlock_create,	semaphore_destroy,	 state_seqlock_send, NULL, state_seqlock_receive},
+};
+
+static TaskHandle_t xTaskHandleBenchController;
+static TaskHandle_t xTaskHandleBenchReceiver;
+
+static QueueHandle_t xQueueHandleBench;
+static SemaphoreHandle_t xSemaphoreHandleBench;
+static SemaphoreHandle_t xMutexHandleBenchState;
+static StreamBufferHandle_t xStreamBufferHandleBench;
+static EventGroupHandle_t xEventGroupHandleBench;
+
+static const BenchPrimitive_t *bench_current;
+static uint32_t bench_current_size;
+static volatile uint8_t bench_done;
+
+static uint8_t bench_tx_buffer[BENCH_MAX_ITEM_SIZE];
+static uint8_t bench_rx_buffer[BENCH_MAX_ITEM_SIZE];
+static SensorFrame_t bench_tx_frame;
+static SensorFrame_t bench_rx_frame;
+static seqlock_t bench_state_lock;
+static SensorState_t bench_state;
+static SensorState_t bench_tx_state;
+static SensorState_t bench_rx_state;
+
+
+/* Create the controller task, the benchmark runs once the scheduler is started */
+void ipc_benchmark_init(void)
+{
+	soft_irq_init(bench_isr);
+	frame_pool_init();
+	xTaskCreate(vTaskBenchController, "Bench controller", BENCH_STACK_SIZE, NULL, BENCH_CONTROLLER_PRIORITY, &xTaskHandleBenchController);
+}
+
+uint8_t ipc_benchmark_finished(void)
+{
+	return bench_done;
+}
+
+/*** task functions */
+
+static void vTaskBenchController(void *pvParameters)
+{
+	uint32_t primitive, size;
+	BenchPath_t path;
+
+	printf("primitive,path,item_bytes,iterations,total,per_op,unit\r\n");
+
+	for(primitive = 0; primitive < sizeof(bench_primitives)/sizeof(bench_primitives[0]); primitive++)
+	{
+		for(path = BENCH_PATH_TASK; path <= BENCH_PATH_ISR; path++)
+		{
+			if(bench_primitives[primitive].sized)
+			{
+				for(size = 0; size < sizeof(bench_item_sizes)/sizeof(bench_item_sizes[0]); size++)
+				{
+					bench_run(&bench_primitives[primitive], path, bench_item_sizes[size]);
+				}
+			}
+			else
+			{
+				bench_run(&bench_primitives[primitive], path, sizeof(uint32_t));
+			}
+		}
+	}
+
+	for(primitive = 0; primitive < sizeof(bench_frame_primitives)/sizeof(bench_frame_primitives[0]); primitive++)
+	{
+		for(path = BENCH_PATH_TASK; path <= BENCH_PATH_ISR; path++)
+		{
+			bench_run(&bench_frame_primitives[primitive], path, sizeof(SensorFrame_t));
+		}
+	}
+	bench_run_frame_pool();
+
+	for(primitive = 0; primitive < sizeof(bench_state_primitives)/sizeof(bench_state_primitives[0]); primitive++)
+	{
+		bench_run(&bench_state_primitives[primitive], BENCH_PATH_TASK, sizeof(SensorState_t));
+	}
+
+	bench_run_mutex();
+
+	printf("# done\r\n");
+	bench_done = 1;
+
+	while(1)
+	{
+		vTaskSuspend(NULL);
+	}
+}
+
+static void vTaskBenchReceiver(void *pvParameters)
+{
+	uint32_t i;
+
+	for(i = 0; i < BENCH_ITERATIONS; i++)
+	{
+		bench_current->receive(bench_current_size);
+	}
+
+	xTaskNotifyGive(xTaskHandleBenchController);
+	vTaskDelete(NULL);
+}
+
+/* Software interrupt: one send per trigger, the receiver runs as soon as the handler returns */
+static void bench_isr(void)
+{
+	BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+
+	bench_current->send_from_isr(bench_current_size, &xHigherPriorityTaskWoken);
+
+	portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+}
+
+/*** measurement */
+
+static void bench_run(const BenchPrimitive_t *primitive, BenchPath_t path, uint32_t item_size)
+{
+	uint32_t i;
+	uint32_t cycles_start;
+
+	bench_current = primitive;
+	bench_current_size = item_size;
+	primitive->create(item_size);
+
+	xTaskCreate(vTaskBenchReceiver, "Bench receiver", BENCH_STACK_SIZE, NULL, BENCH_RECEIVER_PRIORITY, &xTaskHandleBenchReceiver);	// runs at once and blocks on the object
+
+	cycles_start = cycle_counter_get();
+	for(i = 0; i < BENCH_ITERATIONS; i++)
+	{
+		if(path == BENCH_PATH_TASK)
+		{
+			primitive->send(item_size);
+		}
+		else
+		{
+			soft_irq_trigger();
+		}
+	}
+	ulTaskNotifyTake(pdTRUE, portMAX_DELAY);								// the receiver got all items
+	bench_print(primitive->name, (path == BENCH_PATH_TASK) ? "task" : "isr", primitive->sized ? item_size : 0,
+				cycle_counter_get() - cycles_start);
+
+	vTaskDelay(1);															// let the idle task free the receiver
+	primitive->destroy();
+}
+
+static void bench_run_mutex(void)
+{
+	SemaphoreHandle_t xMutexHandleBench = xSemaphoreCreateMutex();
+	uint32_t i;
+	uint32_t cycles_start;
+
+	cycles_start = cycle_counter_get();
+	for(i = 0; i < BENCH_ITERATIONS; i++)
+	{
+		xSemaphoreTake(xMutexHandleBench, portMAX_DELAY);
+		xSemaphoreGive(xMutexHandleBench);
+	}
+	bench_print("mutex", "same_task", 0, cycle_counter_get() - cycles_start);
+
+	vSemaphoreDelete(xMutexHandleBench);
+}
+
+/* The pool part of frame_by_reference: one alloc and one free per iteration, no queue */
+static void bench_run_frame_pool(void)
+{
+	SensorFrame_t *frame;
+	uint32_t i;
+	uint32_t cycles_start;
+
+	cycles_start = cycle_counter_get();
+	for(i = 0; i < BENCH_ITERATIONS; i++)
+	{
+		frame = frame_pool_alloc();
+		frame_pool_free(frame);
+	}
+	bench_print("frame_pool", "alloc_free", sizeof(SensorFrame_t), cycle_counter_get() - cycles_start);
+}
+
+static void bench_print(const char *name, const char *path, uint32_t item_size, uint32_t total)
+{
+	printf("%s,%s,%lu,%lu,%lu,%lu,%s\r\n", name, path, (unsigned long)item_size, (unsigned long)BENCH_ITERATIONS,
+		   (unsigned long)total, (unsigned long)(total/BENCH_ITERATIONS), cycle_counter_unit());
+}
+
+/*** primitives: queue */
+
+static void queue_create(uint32_t item_size)
+{
+	xQueueHandleBench = xQueueCreate(BENCH_QUEUE_LENGTH, item_size);
+}
+
+static void queue_destroy(void)
+{
+	vQueueDelete(xQueueHandleBench);
+}
+
+static void queue_send(uint32_t item_size)
+{
+	xQueueSend(xQueueHandleBench, bench_tx_buffer, portMAX_DELAY);
+}
+
+static void queue_send_from_isr(uint32_t item_size, BaseType_t *pxHigherPriorityTaskWoken)
+{
+	xQueueSendFromISR(xQueueHandleBench, bench_tx_buffer, pxHigherPriorityTaskWoken);
+}
+
+static void queue_receive(uint32_t item_size)
+{
+	xQueueReceive(xQueueHandleBench, bench_rx_buffer, portMAX_DELAY);
+}
+
+/*** primitives: direct to task notification */
+
+static void notify_create(uint32_t item_size)
+{
+}
+
+static void notify_destroy(void)
+{
+}
+
+static void notify_send(uint32_t item_size)
+{
+	xTaskNotifyGive(xTaskHandleBenchReceiver);
+}
+
+static void notify_send_from_isr(uint32_t item_size, BaseType_t *pxHigherPriorityTaskWoken)
+{
+	vTaskNotifyGiveFromISR(xTaskHandleBenchReceiver, pxHigherPriorityTaskWoken);
+}
+
+static void notify_receive(uint32_t item_size)
+{
+	ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+}
+
+/*** primitives: binary semaphore */
+
+static void semaphore_create(uint32_t item_size)
+{
+	xSemaphoreHandleBench = xSemaphoreCreateBinary();
+}
+
+static void semaphore_destroy(void)
+{
+	vSemaphoreDelete(xSemaphoreHandleBench);
+}
+
+static void semaphore_send(uint32_t item_size)
+{
+	xSemaphoreGive(xSemaphoreHandleBench);
+}
+
+static void semaphore_send_from_isr(uint32_t item_size, BaseType_t *pxHigherPriorityTaskWoken)
+{
+	xSemaphoreGiveFromISR(xSemaphoreHandleBench, pxHigherPriorityTaskWoken);
+}
+
+static void semaphore_receive(uint32_t item_size)
+{
+	xSemaphoreTake(xSemaphoreHandleBench, portMAX_DELAY);
+}
+
+/*** primitives: stream and message buffer (a message buffer is a stream buffer with a length header) */
+
+static void stream_create(uint32_t item_size)
+{
+	xStreamBufferHandleBench = xStreamBufferCreate(BENCH_QUEUE_LENGTH * item_size, item_size);		// wake the receiver once a whole item is in
+}
+
+static void message_create(uint32_t item_size)
+{
+	xStreamBufferHandleBench = xMessageBufferCreate(BENCH_QUEUE_LENGTH * (item_size + sizeof(configMESSAGE_BUFFER_LENGTH_TYPE)));
+}
+
+static void stream_destroy(void)
+{
+	vStreamBufferDelete(xStreamBufferHandleBench);
+}
+
+static void stream_send(uint32_t item_size)
+{
+	xStreamBufferSend(xStreamBufferHandleBench, bench_tx_buffer, item_size, portMAX_DELAY);
+}
+
+static void stream_send_from_isr(uint32_t item_size, BaseType_t *pxHigherPriorityTaskWoken)
+{
+	xStreamBufferSendFromISR(xStreamBufferHandleBench, bench_tx_buffer, item_size, pxHigherPriorityTaskWoken);
+}
+
+static void stream_receive(uint32_t item_size)
+{
+	xStreamBufferReceive(xStreamBufferHandleBench, bench_rx_buffer, item_size, portMAX_DELAY);
+}
+
+/*** primitives: event group (the ISR path is deferred to the timer task by FreeRTOS) */
+
+static void event_create(uint32_t item_size)
+{
+	xEventGroupHandleBench = xEventGroupCreate();
+}
+
+static void event_destroy(void)
+{
+	vEventGroupDelete(xEventGroupHandleBench);
+}
+
+static void event_send(uint32_t item_size)
+{
+	xEventGroupSetBits(xEventGroupHandleBench, BENCH_EVENT_BIT);
+}
+
+static void event_send_from_isr(uint32_t item_size, BaseType_t *pxHigherPriorityTaskWoken)
+{
+	xEventGroupSetBitsFromISR(xEventGroupHandleBench, BENCH_EVENT_BIT, pxHigherPriorityTaskWoken);
+}
+
+static void event_receive(uint32_t item_size)
+{
+	xEventGroupWaitBits(xEventGroupHandleBench, BENCH_EVENT_BIT, pdTRUE, pdFALSE, portMAX_DELAY);
+}
+
+/*** primitives: waveform frames, copied through the queue or passed by reference from the frame pool */
+
+static void frame_value_create(uint32_t item_size)
+{
+	xQueueHandleBench = xQueueCreate(BENCH_FRAME_QUEUE_LENGTH, sizeof(SensorFrame_t));
+}
+
+static void frame_value_send(uint32_t item_size)
+{
+	xQueueSend(xQueueHandleBench, &bench_tx_frame, portMAX_DELAY);
+}
+
+static void frame_value_send_from_isr(uint32_t item_size, BaseType_t *pxHigherPriorityTaskWoken)
+{
+	xQueueSendFromISR(xQueueHandleBench, &bench_tx_frame, pxHigherPriorityTaskWoken);
+}
+
+static void frame_value_receive(uint32_t item_size)
+{
+	xQueueReceive(xQueueHandleBench, &bench_rx_frame, portMAX_DELAY);
+}
+
+static void frame_reference_create(uint32_t item_size)
+{
+	xQueueHandleBench = xQueueCreate(BENCH_FRAME_QUEUE_LENGTH, sizeof(SensorFrame_t *));
+}
+
+static void frame_reference_send(uint32_t item_size)
+{
+	SensorFrame_t *frame = frame_pool_alloc();
+
+	configASSERT(frame != NULL);
+	frame_pool_send(xQueueHandleBench, frame, portMAX_DELAY);
+}
+
+static void frame_reference_send_from_isr(uint32_t item_size, BaseType_t *pxHigherPriorityTaskWoken)
+{
+	SensorFrame_t *frame = frame_pool_alloc_from_isr();
+
+	configASSERT(frame != NULL);
+	if(frame_pool_send_from_isr(xQueueHandleBench, frame, pxHigherPriorityTaskWoken) != pdPASS)
+	{
+		frame_pool_free_from_isr(frame);		// an interrupt cannot wait for room in the queue
+	}
+}
+
+static void frame_reference_receive(uint32_t item_size)
+{
+	SensorFrame_t *frame;
+
+	frame_pool_receive(xQueueHandleBench, &frame, portMAX_DELAY);
+	frame_pool_free(frame);
+}
+
+/* The queue part of frame_by_reference: the pointer of one frame, the pool is not used */
+static void frame_pointer_send(uint32_t item_size)
+{
+	SensorFrame_t *frame = &bench_tx_frame;
+
+	xQueueSend(xQueueHandleBench, &frame, portMAX_DELAY);
+}
+
+static void frame_pointer_send_from_isr(uint32_t item_size, BaseType_t *pxHigherPriorityTaskWoken)
+{
+	SensorFrame_t *frame = &bench_tx_frame;
+
+	xQueueSendFromISR(xQueueHandleBench, &frame, pxHigherPriorityTaskWoken);
+}
+
+static void frame_pointer_receive(uint32_t item_size)
+{
+	SensorFrame_t *frame;
+
+	xQueueReceive(xQueueHandleBench, &frame, portMAX_DELAY);
+}
+
+/*** averaging period: SensorState_t published by one task, read by another after the wake-up */
+
+static void state_mutex_create(uint32_t item_size)
+{
+	xSemaphoreHandleBench = xSemaphoreCreateBinary();
+	xMutexHandleBenchState = xSemaphoreCreateMutex();
+}
+
+static void state_mutex_destroy(void)
+{
+	vSemaphoreDelete(xMutexHandleBenchState);
+	vSemaphoreDelete(xSemaphoreHandleBench);
+}
+
+static void state_mutex_send(uint32_t item_size)
+{
+	bench_tx_state.value++;
+	xSemaphoreTake(xMutexHandleBenchState, portMAX_DELAY);
+	bench_state = bench_tx_state;
+	xSemaphoreGive(xMutexHandleBenchState);
+	xSemaphoreGive(xSemaphoreHandleBench);
+}
+
+static void state_mutex_receive(uint32_t item_size)
+{
+	xSemaphoreTake(xSemaphoreHandleBench, portMAX_DELAY);
+	xSemaphoreTake(xMutexHandleBenchState, portMAX_DELAY);
+	bench_rx_state = bench_state;
+	xSemaphoreGive(xMutexHandleBenchState);
+}
+
+static void state_seqlock_create(uint32_t item_size)
+{
+	xSemaphoreHandleBench = xSemaphoreCreateBinary();
+	seqlock_init(&bench_state_lock);
+}
+
+static void state_seqlock_send(uint32_t item_size)
+{
+	bench_tx_state.value++;
+	seqlock_write(&bench_state_lock, &bench_state, &bench_tx_state, sizeof(bench_tx_state));
+	xSemaphoreGive(xSemaphoreHandleBench);
+}
+
+static void state_seqlock_receive(uint32_t item_size)
+{
+	xSemaphoreTake(xSemaphoreHandleBench, portMAX_DELAY);
+	seqlock_read(&bench_state_lock, &bench_state, &bench_rx_state, sizeof(bench_rx_state));
+}
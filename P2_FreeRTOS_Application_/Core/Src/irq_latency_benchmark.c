@@ -0,0 +1,183 @@
+/*
+ * *** Purpose:
+ * Measure how much the placement of code and vector table in SRAM (ram_code.h) shortens the way from an interrupt
+ * to the task it wakes.
+ *
+ * *** How it works
+ * The same handler body is built twice: EXTI2_IRQHandler stays in flash, EXTI3_IRQHandler is RAMFUNC.
+ * The controller task pends one of the two interrupts LATENCY_BENCH_SAMPLES times, the handler stamps its entry and
+ * notifies the receiver task (higher priority), which stamps when it runs. Every combination is measured:
+ * 1. vector table: flash or SRAM (VTOR switched at run time).
+ * 2. handler: flash or SRAM.
+ * 3. cache: "warm" runs as is, "cold" resets the ART instruction and data caches before every pend,
+ *    the worst case of code that has not run for a while.
+ * The FreeRTOS path (notification, PendSV) is in SRAM in every combination, as placed by the linker script.
+ * Timestamps read DWT->CYCCNT directly, so the handler does not call into flash.
+ *
+ * *** Output
+ * One CSV line per combination over printf (UART):
+ * vector_table,handler,cache,samples,entry_avg,entry_max,task_avg,task_max,unit
+ * entry = pend to first handler instruction, task = handler entry to receiver task running, in cycles.
+ */
+
+/* Includes */
+#include <stdio.h>
+#include "cmsis_os.h"
+#include "stm32f4xx_hal.h"
+#include "irq_latency_benchmark.h"
+#include "ram_code.h"
+
+/* Define macros */
+#define LATENCY_BENCH_SAMPLES			1000
+#define LATENCY_BENCH_STACK_SIZE		256
+#define LATENCY_BENCH_CONTROLLER_PRIORITY	1
+#define LATENCY_BENCH_RECEIVER_PRIORITY	3
+#define LATENCY_BENCH_IRQ_PRIORITY		6		// Must not be above configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY to call FromISR API
+#define LATENCY_BENCH_FLASH_IRQn		EXTI2_IRQn
+#define LATENCY_BENCH_RAM_IRQn			EXTI3_IRQn
+
+/* Declare types */
+typedef struct
+{
+	uint32_t entry_sum;
+	uint32_t entry_max;
+	uint32_t task_sum;
+	uint32_t task_max;
+} LatencyStats_t;
+
+/* Declare private functions */
+static void vTaskLatencyBenchController(void *pvParameters);
+static void vTaskLatencyBenchReceiver(void *pvParameters);
+static void latency_bench_run(uint8_t ram_vectors, uint8_t ram_handler, uint8_t cold);
+static void latency_bench_cache_reset(void);
+
+/* Declare private variables */
+static TaskHandle_t xTaskHandleLatencyBenchReceiver;
+static volatile uint32_t pend_cycles;
+static volatile uint32_t entry_cycles;
+static LatencyStats_t stats;
+
+
+/* Create the benchmark tasks, the benchmark runs once the scheduler is started */
+void irq_latency_benchmark_init(void)
+{
+	NVIC_SetPriority(LATENCY_BENCH_FLASH_IRQn, LATENCY_BENCH_IRQ_PRIORITY);
+	NVIC_SetPriority(LATENCY_BENCH_RAM_IRQn, LATENCY_BENCH_IRQ_PRIORITY);
+	NVIC_EnableIRQ(LATENCY_BENCH_FLASH_IRQn);
+	NVIC_EnableIRQ(LATENCY_BENCH_RAM_IRQn);
+
+	xTaskCreate(vTaskLatencyBenchReceiver, "Latency receiver", LATENCY_BENCH_STACK_SIZE, NULL, LATENCY_BENCH_RECEIVER_PRIORITY, &xTaskHandleLatencyBenchReceiver);
+	xTaskCreate(vTaskLatencyBenchController, "Latency controller", LATENCY_BENCH_STACK_SIZE, NULL, LATENCY_BENCH_CONTROLLER_PRIORITY, NULL);
+}
+
+/*** task functions */
+
+static void vTaskLatencyBenchController(void *pvParameters)
+{
+	uint8_t ram_vectors, ram_handler, cold;
+
+	printf("vector_table,handler,cache,samples,entry_avg,entry_max,task_avg,task_max,unit\r\n");
+
+	for(ram_vectors = 0; ram_vectors <= 1; ram_vectors++)
+	{
+		for(ram_handler = 0; ram_handler <= 1; ram_handler++)
+		{
+			for(cold = 0; cold <= 1; cold++)
+			{
+				latency_bench_run(ram_vectors, ram_handler, cold);
+			}
+		}
+	}
+	ram_vector_table_restore();
+
+	printf("# done\r\n");
+
+	while(1)
+	{
+		vTaskSuspend(NULL);
+	}
+}
+
+static void vTaskLatencyBenchReceiver(void *pvParameters)
+{
+	uint32_t task_cycles, entry, task;
+
+	while(1)
+	{
+		ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+		task_cycles = DWT->CYCCNT;
+
+		entry = entry_cycles - pend_cycles;
+		task = task_cycles - entry_cycles;
+		stats.entry_sum += entry;
+		stats.task_sum += task;
+		if(entry > stats.entry_max) stats.entry_max = entry;
+		if(task > stats.task_max) stats.task_max = task;
+	}
+}
+
+/*** interrupt handlers, same body in flash and in SRAM */
+
+#define LATENCY_BENCH_HANDLER_BODY()														\
+	do																						\
+	{																						\
+		BaseType_t xHigherPriorityTaskWoken = pdFALSE;										\
+		entry_cycles = DWT->CYCCNT;															\
+		vTaskNotifyGiveFromISR(xTaskHandleLatencyBenchReceiver, &xHigherPriorityTaskWoken);	\
+		portYIELD_FROM_ISR(xHigherPriorityTaskWoken);										\
+	} while(0)
+
+void EXTI2_IRQHandler(void)
+{
+	LATENCY_BENCH_HANDLER_BODY();
+}
+
+RAMFUNC void EXTI3_IRQHandler(void)
+{
+	LATENCY_BENCH_HANDLER_BODY();
+}
+
+/*** measurement */
+
+static void latency_bench_run(uint8_t ram_vectors, uint8_t ram_handler, uint8_t cold)
+{
+	IRQn_Type irq = ram_handler ? LATENCY_BENCH_RAM_IRQn : LATENCY_BENCH_FLASH_IRQn;
+
+	if(ram_vectors)
+	{
+		ram_vector_table_init();
+	}
+	else
+	{
+		ram_vector_table_restore();
+	}
+
+	stats = (LatencyStats_t){ 0 };
+	for(uint32_t i = 0; i < LATENCY_BENCH_SAMPLES; i++)
+	{
+		if(cold)
+		{
+			latency_bench_cache_reset();
+		}
+		pend_cycles = DWT->CYCCNT;
+		NVIC_SetPendingIRQ(irq);				// handler and receiver have run when the controller continues
+		__DSB();
+		__ISB();
+	}
+
+	printf("%s,%s,%s,%lu,%lu,%lu,%lu,%lu,cycles\r\n", ram_vectors ? "sram" : "flash", ram_handler ? "sram" : "flash",
+		   cold ? "cold" : "warm", (unsigned long)LATENCY_BENCH_SAMPLES,
+		   (unsigned long)(stats.entry_sum / LATENCY_BENCH_SAMPLES), (unsigned long)stats.entry_max,
+		   (unsigned long)(stats.task_sum / LATENCY_BENCH_SAMPLES), (unsigned long)stats.task_max);
+}
+
+/* Empty the ART accelerator, the next flash fetches pay the full wait states */
+static void latency_bench_cache_reset(void)
+{
+	__HAL_FLASH_INSTRUCTION_CACHE_DISABLE();
+	__HAL_FLASH_DATA_CACHE_DISABLE();
+	__HAL_FLASH_INSTRUCTION_CACHE_RESET();
+	__HAL_FLASH_DATA_CACHE_RESET();
+	__HAL_FLASH_INSTRUCTION_CACHE_ENABLE();
+	__HAL_FLASH_DATA_CACHE_ENABLE();
+}
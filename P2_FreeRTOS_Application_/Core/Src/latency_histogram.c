@@ -0,0 +1,83 @@
+/*
+ * *** Purpose:
+ * Distribution of the interrupt to actuator latency of the sensor pipeline, the main performance figure of P2.
+ *
+ * *** How it works
+ * Take action records one latency per actuation into fixed LATENCY_BUCKET_US wide buckets, plus count, min, max and sum.
+ * Readers (command channel, host report) copy the whole histogram inside a critical section, so they never see
+ * half of a record. Latencies are in microseconds, so the buckets keep their meaning across clock profiles
+ * and in the host build.
+ *
+ * *** Output
+ * latency_histogram_print() writes over printf (UART on target, stdout on host):
+ * latency <count> <min_us> <avg_us> <max_us>
+ * bucket <from_us> <count>			one line per non empty bucket
+ */
+
+/* Includes */
+#include <stdio.h>
+#include <string.h>
+#include "cmsis_os.h"
+#include "latency_histogram.h"
+
+/* Declare private variables */
+static LatencyHistogram_t latency_histogram = { .min_us = UINT32_MAX };
+
+
+void latency_histogram_record(uint32_t latency_us)
+{
+	uint32_t bucket = latency_us / LATENCY_BUCKET_US;
+
+	if(bucket >= LATENCY_BUCKETS)
+	{
+		bucket = LATENCY_BUCKETS - 1;
+	}
+
+	taskENTER_CRITICAL();
+	latency_histogram.buckets[bucket]++;
+	latency_histogram.count++;
+	latency_histogram.sum_us += latency_us;
+	if(latency_us < latency_histogram.min_us) latency_histogram.min_us = latency_us;
+	if(latency_us > latency_histogram.max_us) latency_histogram.max_us = latency_us;
+	taskEXIT_CRITICAL();
+}
+
+void latency_histogram_snapshot(LatencyHistogram_t *copy)
+{
+	taskENTER_CRITICAL();
+	*copy = latency_histogram;
+	taskEXIT_CRITICAL();
+}
+
+void latency_histogram_reset(void)
+{
+	taskENTER_CRITICAL();
+	memset(&latency_histogram, 0, sizeof(latency_histogram));
+	latency_histogram.min_us = UINT32_MAX;
+	taskEXIT_CRITICAL();
+}
+
+void latency_histogram_print(void)
+{
+	LatencyHistogram_t histogram;
+	uint32_t bucket;
+
+	latency_histogram_snapshot(&histogram);
+
+	if(histogram.count == 0)
+	{
+		printf("latency 0 0 0 0\n");
+		return;
+	}
+
+	printf("latency %lu %lu %lu %lu\n", (unsigned long)histogram.count, (unsigned long)histogram.min_us,
+		   (unsigned long)(histogram.sum_us / histogram.count), (unsigned long)histogram.max_us);
+
+	for(bucket = 0; bucket < LATENCY_BUCKETS; bucket++)
+	{
+		if(histogram.buckets[bucket] != 0)
+		{
+			printf("bucket %lu %lu\n", (unsigned long)(bucket * LATENCY_BUCKET_US), (unsigned long)histogram.buckets[bucket]);
+		}
+	}
+}
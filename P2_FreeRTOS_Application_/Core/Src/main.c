@@ -1,19 +1,27 @@
 /*
  * *** Purpose:
- * Demonstrate a Free RTOS Application, including Tasks, Queues, Semaphores and Notifications
+ * Demonstrate a Free RTOS Application, including Tasks, Notifications, DMA and Sequence locks
  *
  * *** How it works
- * The application follows these functions
- * 1. ADC Handle interrupt, to read sensor data from the ADC Module 1 when data conversion is ready.
- * 2. Task 1 - Read data, to send sensor data to the next task using a queue.
- * 3. Task 2 - Process data, to calculate the average of 10 sensor measurement values.
- * 4. Task 3 - Take action, to take an action based on the average of the sensor readings. For example, set an output high if the average if above a threshold.
+ * Every sensor is one row of sensor_table (ADC channel, sample rate, filter and window, threshold, actuator pin).
+ * The pipeline (sensor_pipeline.c) serves the whole table with the same two tasks:
+ * 1. TIM2 clocks one ADC scan of all channels, DMA stores it and interrupts once per scan.
+ *    With ADC_TIMER_TRIGGER 0 a read task starts every scan by software instead, to compare the scan jitter.
+ * 2. Task 1 - Process data, to filter every sample of every sensor (sliding mean, EMA or sliding median over filter_window samples).
+ * 3. Task 2 - Take action, to take an action based on the filtered value of each sensor. For example, set an output high if it is above a threshold.
  *
  * The application uses following FreeRTOS objects
- * 1. Notification, to indicate from ADC Handle Interrupt to Task 1 (Read data) that new data has been read.
- * 2. Queue, to send a packet of 10 data from the Task 1 (Read data) to Task 2 (Process data).
- * 3. Mutex, to protect the access to the variable sensor_average, where the average of the 10 data is stored.
- * 4. Semaphore, to communicate from Task 2 (Process data) to Task 3 (Take Action) that the new average has been calculated.
+ * 1. Notification, to indicate from the DMA interrupt to Task 1 (Process data) which half of the scan buffer is ready.
+ * 2. Sequence lock per sensor, to publish the sensor state (value, min, max, timestamp) without blocking the reader.
+ * 3. Notification, to indicate from Task 1 (Process data) to Task 2 (Take Action) which sensors have a new value.
+ * 4. Stream buffer, to pass the command frames received on USART2 (DMA, idle line interrupt) to Task 3 (Parse commands).
+ *
+ * With CLOCK_GOVERNOR, Task 4 (Clock governor) switches between the 16, 42 and 84 MHz profiles (clock_profile.c)
+ * from the idle share of the CPU and the scans lost by the pipeline.
+ *
+ * Adding a sensor is adding a row to sensor_table. Building with SENSOR_SCALING_COUNT=N replicates the first row N times
+ * to measure how RAM (sensor_pipeline_ram_bytes) and CPU per scan (sensor_pipeline_scan_cycles_mean, the largest one in
+ * sensor_pipeline_scan_cycles) grow with the table.
  *
  * *** Copyrights:
  * Created by Luis Nino
@@ -25,50 +33,62 @@
 #include "main.h"
 #include "cmsis_os.h"
 #include "uart.h"
-#include "adc_interrupt.h"
-#include "gpio_out.h"
+#include "cycle_counter.h"
+#include "sensor_pipeline.h"
+#include "command_channel.h"
+#include "clock_governor.h"
+#include "memory_profile.h"
+#include "ipc_benchmark.h"
+#include "filter_benchmark.h"
+#include "irq_latency_benchmark.h"
+#include "ram_code.h"
 
 /* Define macros */
-#define STACK_SIZE 		256
-//#define MAX_BLOCK_TIME	pdMS_TO_TICKS(100)
-//#define MAX_WAIT_TIME		pdMS_TO_TICKS(10)
-#define	QUEUE_LENGTH	10
-#define THRESHOLD		2500
+#ifndef RUN_IPC_BENCHMARK
+#define RUN_IPC_BENCHMARK	0		// 1 = run the inter-task communication benchmark (ipc_benchmark.c) instead of the application
+#endif
 
-const TickType_t MAX_BLOCK_TIME = pdMS_TO_TICKS(100);
-const TickType_t MAX_WAIT_TIME = pdMS_TO_TICKS(50);
+#ifndef RUN_FILTER_BENCHMARK
+#define RUN_FILTER_BENCHMARK	0	// 1 = run the streaming filter benchmark (filter_benchmark.c) instead of the application
+#endif
 
-/* Private function prototypes */
-void SystemClock_Config(void);
+#ifndef RUN_IRQ_LATENCY_BENCHMARK
+#define RUN_IRQ_LATENCY_BENCHMARK	0	// 1 = run the interrupt to task latency benchmark, flash against SRAM (irq_latency_benchmark.c)
+#endif
 
-/* Declare global variables */
-uint32_t sensor_reading;							// this variable stores each sensor reading
-uint32_t sensor_average;							// this variable stores each sensor readings average, from 10 sensor readings
+#ifndef RAM_VECTOR_TABLE
+#define RAM_VECTOR_TABLE	0		// 1 = relocate the vector table to SRAM (VTOR) before the interrupts are enabled
+#endif
 
-/* Declare global functions */
-void vTaskReadData(void *pvParameters);
-void vTaskProcessData(void *pvParameters);
-void vTaskTakeAction(void *pvParameters);
+#ifndef RUN_MEMORY_PROFILE
+#define RUN_MEMORY_PROFILE	0		// 1 = run the application and print measured and recommended stack and heap sizes (memory_profile.c)
+#endif
 
-/* Declare Task Handles */
-TaskHandle_t xTaskHandleReadData;
-TaskHandle_t xTaskHandleProcessData;
-TaskHandle_t xTaskHandleTakeAction;
+#ifndef CLOCK_GOVERNOR
+#define CLOCK_GOVERNOR		1		// 1 = pick the clock profile from the idle time, 0 = stay at 84 MHz
+#endif
+
+#ifndef SENSOR_SCALING_COUNT
+#define SENSOR_SCALING_COUNT	0	// N > 0 = run N copies of the first sensor, to measure the cost per sensor
+#endif
+
+/* Private function prototypes */
+void SystemClock_Config(void);
 
-/* Declare Queue Handles */
-QueueHandle_t xQueueHandleSensorPacket;				// this Queue contains a packet with 10 sensor readings
+/* Sensor table: ADC channel, rate, filter window, threshold, actuator */
+const SensorDescriptor_t sensor_table[] =
+{
+	{ .adc_channel = 1, .rate_hz = 1000, .filter_window = 10, .filter = FILTER_MEAN, .threshold = 2500, .actuator_port = GPIOA, .actuator_pin = 5 },	// PA1 -> PA5
+};
+#define SENSOR_COUNT	(sizeof(sensor_table) / sizeof(sensor_table[0]))
 
-/* Declare Semaphores and Mutex Handles */
-SemaphoreHandle_t xMutexHandleSensorAverage;		// this Mutex protects access to the variable sensor_average
-SemaphoreHandle_t xSemaphoreHandleNewAverageReady;	// this Semaphore communicates that a new sensor average has been calculated
+#if SENSOR_SCALING_COUNT > 0
+static SensorDescriptor_t sensor_scaling_table[SENSOR_SCALING_COUNT];
+#endif
 
 /* Task Profilers, for debugging only*/
 typedef uint32_t TaskProfiler;
-TaskProfiler 	taskProfilerReadData, taskProfilerReadDataInside,
-				taskProfilerProcessData, taskProfilerProcessDataInside,
-				taskProfilerTakeAction, taskProfilerTakeActionInside,
-				taskProfilerADC_IRQ_Handler, taskProfilerADC_IRQ_Handler2,
-				taskProfilerBeforeScheduler;
+TaskProfiler 	taskProfilerBeforeScheduler;
 
 int __io_putchar(int ch);
 
@@ -83,20 +103,50 @@ int main(void)
 	SystemClock_Config();
 
 	/* Initialize all configured peripherals */
-	adc_interrupt_init();			// ADC at PA1
-	GPIO_OUT_init();				// GPIO out at PA5
-
-	/* Create Tasks */
-	xTaskCreate(vTaskReadData, 	  "Task read sensor data",   	STACK_SIZE, NULL, 1, &xTaskHandleReadData);
-	xTaskCreate(vTaskProcessData, "Task process sensor data",	STACK_SIZE, NULL, 1, &xTaskHandleProcessData);
-	xTaskCreate(vTaskTakeAction,  "Task take action with data", STACK_SIZE, NULL, 1, &xTaskHandleTakeAction);
-
-	/* Create Queues */
-	xQueueHandleSensorPacket = xQueueCreate(QUEUE_LENGTH, sizeof(int32_t));
-
-	/* Create Semaphores and Mutex */
-	xMutexHandleSensorAverage = xSemaphoreCreateMutex();
-	xSemaphoreHandleNewAverageReady = xSemaphoreCreateBinary();
+	cycle_counter_init();			// DWT cycle counter for the profilers
+
+#if RAM_VECTOR_TABLE
+	ram_vector_table_init();		// vector fetches from SRAM, see ram_code.h for the code placed there
+#endif
+
+#if RUN_IPC_BENCHMARK
+	/* Create the benchmark instead of the application, results are printed on UART */
+	USART2_UART_TX_Init();
+	ipc_benchmark_init();
+#elif RUN_FILTER_BENCHMARK
+	/* Same for the filters */
+	USART2_UART_TX_Init();
+	filter_benchmark_init();
+#elif RUN_IRQ_LATENCY_BENCHMARK
+	/* Same for the interrupt latency, the benchmark switches the vector table itself */
+	USART2_UART_TX_Init();
+	irq_latency_benchmark_init();
+#else
+#if SENSOR_SCALING_COUNT > 0
+	/* Same sensor N times, the ADC scans the channel N times */
+	for(uint32_t i = 0; i < SENSOR_SCALING_COUNT; i++)
+	{
+		sensor_scaling_table[i] = sensor_table[0];
+	}
+	sensor_pipeline_init(sensor_scaling_table, SENSOR_SCALING_COUNT);
+#else
+	/* Create the pipeline tasks for the table and start sampling */
+	sensor_pipeline_init(sensor_table, SENSOR_COUNT);
+#endif
+
+	/* Commands and telemetry on USART2 */
+	command_channel_init();
+
+#if CLOCK_GOVERNOR
+	/* Lowest clock profile that keeps the pipeline on time */
+	clock_governor_init();
+#endif
+
+#if RUN_MEMORY_PROFILE
+	/* Report stack and heap use once the application has run */
+	memory_profile_init();
+#endif
+#endif
 
 	/* Start Scheduler */
 	taskProfilerBeforeScheduler++;
@@ -109,113 +159,6 @@ int main(void)
 	  }
 }
 
-/*** task functions */
-
-/* task function 1 */
-void vTaskReadData(void *pvParameters)
-{
-
-	while(1)
-	{
-		adc_start_conversion();
-
-		taskProfilerReadData++;
-
-		if(ulTaskNotifyTake(pdTRUE, MAX_BLOCK_TIME) != 0)
-		{
-			xQueueSend(xQueueHandleSensorPacket, &sensor_reading, MAX_WAIT_TIME);
-			taskProfilerReadDataInside++;
-		}
-		vTaskDelay(1);
-	}
-}
-
-/* task function 2 */
-void vTaskProcessData(void *pvParameters)
-{
-	uint32_t data_received;
-	BaseType_t status_received;
-
-	int8_t 	 data_counter = 0;
-	uint32_t data_sum = 0;
-
-	while(1)
-	{
-		status_received = xQueueReceive(xQueueHandleSensorPacket, &data_received, MAX_WAIT_TIME);
-		taskProfilerProcessData++;
-
-		if (status_received == pdPASS)
-		{
-			data_sum += data_received;
-			data_counter++;
-
-			if(data_counter == QUEUE_LENGTH)
-			{
-				if (xSemaphoreTake(xMutexHandleSensorAverage, MAX_WAIT_TIME) == pdTRUE)
-				{
-					sensor_average = data_sum/data_counter;
-					taskProfilerProcessDataInside++;
-					xSemaphoreGive(xMutexHandleSensorAverage);
-				}
-
-				xSemaphoreGive(xSemaphoreHandleNewAverageReady);
-
-				data_counter = 0;
-				data_sum = 0;
-			}
-		}
-	}
-}
-
-/* task function 3 */
-void vTaskTakeAction(void *pvParameters)
-{
-
-	while(1)
-	{
-		taskProfilerTakeAction++;
-		if(xSemaphoreTake(xSemaphoreHandleNewAverageReady, MAX_WAIT_TIME) == pdTRUE)
-		{
-			if(xSemaphoreTake(xMutexHandleSensorAverage, MAX_WAIT_TIME) == pdTRUE)
-			{
-				taskProfilerTakeActionInside++;
-
-				if(sensor_average >= THRESHOLD)
-				{
-					GPIO_OUT_on();
-				}
-				else
-				{
-					GPIO_OUT_off();
-				}
-
-				xSemaphoreGive(xMutexHandleSensorAverage);
-			}
-		}
-	}
-}
-
-/* ADC interrupt handler */
-void ADC_IRQHandler(void)
-{
-	BaseType_t xHigherPriorityTaskWoken = pdFALSE;
-
-	if(ADC1->SR & ADC_SR_EOC)
-	{
-		sensor_reading = ADC1->DR;
-
-		taskProfilerADC_IRQ_Handler++;
-
-		vTaskNotifyGiveFromISR(xTaskHandleReadData, &xHigherPriorityTaskWoken);
-
-		taskProfilerADC_IRQ_Handler2++;
-
-		portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
-
-	}
-}
-
-
 /* Clock Configuration */
 void SystemClock_Config(void)
 {
@@ -0,0 +1,133 @@
+/*
+ * *** Purpose:
+ * Size the task stacks and the FreeRTOS heap from measurements instead of guesses.
+ *
+ * *** How it works
+ * 1. FreeRTOSConfig.h hooks traceTASK_CREATE, so every task records its stack size here when it is created.
+ * 2. memory_profile_print() reads the stack high water mark of every task (uxTaskGetSystemState) and the minimum
+ *    ever free heap, and adds MEMORY_PROFILE_MARGIN % to the measured use for the recommended sizes.
+ * 3. memory_profile_init() starts a task that lets the application run, drives every command through the command
+ *    channel (the deepest printf paths), and prints the report after MEMORY_PROFILE_RUN_MS.
+ * A high water mark only covers the paths that ran: compare with the static worst case of Host/stack_report.py.
+ * On the host build the heap figures are valid, the stack figures only show the one pointer
+ * the host port keeps on a task stack (Host/Src/sim_port.c).
+ *
+ * *** Output
+ * over printf (UART on target, stdout on host), also on the "memory" command:
+ * stack,<task>,<size_words>,<used_words>,<recommended_words>
+ * heap,<total_bytes>,<peak_used_bytes>,<recommended_bytes>
+ */
+
+/* Includes */
+#include <stdio.h>
+#include "cmsis_os.h"
+#include "memory_profile.h"
+#include "command_channel.h"
+
+/* Define macros */
+#define STACK_SIZE 					256
+#define MEMORY_PROFILE_PRIORITY		1
+#define MEMORY_PROFILE_ROUND_WORDS	8
+#define MEMORY_PROFILE_COMMANDS		"state 0\nlatency\nthreshold 99 0\nrate 99 1\nmemory\nunknown\n"	// invalid sensors: parsed, nothing changed
+
+/* Declare types */
+typedef struct
+{
+	void *task;
+	uint32_t stack_words;
+} TaskStack_t;
+
+/* Declare private functions */
+static void vTaskMemoryProfile(void *pvParameters);
+static uint32_t memory_profile_stack_words(void *task);
+static uint32_t memory_profile_recommended(uint32_t used);
+
+/* Declare private variables */
+static TaskStack_t task_stacks[MEMORY_PROFILE_MAX_TASKS];
+static uint32_t task_stacks_count;
+
+
+/* Start the profiling task, the report is printed once the application ran MEMORY_PROFILE_RUN_MS */
+void memory_profile_init(void)
+{
+	xTaskCreate(vTaskMemoryProfile, "Task memory profile", STACK_SIZE, NULL, MEMORY_PROFILE_PRIORITY, NULL);
+}
+
+/* Called by traceTASK_CREATE with the lowest and highest word of the new task's stack */
+void memory_profile_task_created(void *task, void *stack_low, void *stack_high)
+{
+	uint32_t i;
+
+	for(i = 0; i < task_stacks_count; i++)
+	{
+		if(task_stacks[i].task == task)
+		{
+			break;									// handle of a deleted task reused
+		}
+	}
+	if(i == MEMORY_PROFILE_MAX_TASKS)
+	{
+		return;
+	}
+
+	task_stacks[i].task = task;
+	task_stacks[i].stack_words = ((StackType_t *)stack_high - (StackType_t *)stack_low) + 1;
+	if(i == task_stacks_count) task_stacks_count++;
+}
+
+void memory_profile_print(void)
+{
+	static TaskStatus_t status[MEMORY_PROFILE_MAX_TASKS];	// too large for the caller's stack
+	uint32_t tasks, i, size, used;
+	size_t heap_used = configTOTAL_HEAP_SIZE - xPortGetMinimumEverFreeHeapSize();
+
+	tasks = uxTaskGetSystemState(status, MEMORY_PROFILE_MAX_TASKS, NULL);
+
+	for(i = 0; i < tasks; i++)
+	{
+		size = memory_profile_stack_words(status[i].xHandle);
+		used = (size > status[i].usStackHighWaterMark) ? (size - status[i].usStackHighWaterMark) : 0;
+		printf("stack,%s,%lu,%lu,%lu\n", status[i].pcTaskName, (unsigned long)size, (unsigned long)used,
+			   (unsigned long)memory_profile_recommended(used));
+	}
+
+	printf("heap,%lu,%lu,%lu\n", (unsigned long)configTOTAL_HEAP_SIZE, (unsigned long)heap_used,
+		   (unsigned long)memory_profile_recommended(heap_used));
+}
+
+/*** task functions */
+
+static void vTaskMemoryProfile(void *pvParameters)
+{
+	vTaskDelay(pdMS_TO_TICKS(MEMORY_PROFILE_RUN_MS / 2));
+	command_channel_inject(MEMORY_PROFILE_COMMANDS);
+
+	vTaskDelay(pdMS_TO_TICKS(MEMORY_PROFILE_RUN_MS / 2));
+	memory_profile_print();
+
+	while(1)
+	{
+		vTaskSuspend(NULL);
+	}
+}
+
+static uint32_t memory_profile_stack_words(void *task)
+{
+	uint32_t i;
+
+	for(i = 0; i < task_stacks_count; i++)
+	{
+		if(task_stacks[i].task == task)
+		{
+			return task_stacks[i].stack_words;
+		}
+	}
+	return 0;										// created before the hook, or table full
+}
+
+static uint32_t memory_profile_recommended(uint32_t used)
+{
+	uint32_t recommended = used + (used * MEMORY_PROFILE_MARGIN) / 100;
+
+	return ((recommended + MEMORY_PROFILE_ROUND_WORDS - 1) / MEMORY_PROFILE_ROUND_WORDS) * MEMORY_PROFILE_ROUND_WORDS;
+}
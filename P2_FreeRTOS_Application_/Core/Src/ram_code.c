@@ -0,0 +1,37 @@
+#include  "ram_code.h"
+#include  "stm32f4xx_hal.h"
+
+#define RAM_VECTOR_COUNT	(16 + SPI4_IRQn + 1)	// 16 system exceptions + the STM32F401 interrupts
+
+extern const uint32_t g_pfnVectors[];				// flash vector table of the startup code
+
+static uint32_t ram_vector_table[RAM_VECTOR_COUNT] __attribute__((section(".ram_vector"), aligned(512)));	// VTOR needs the table size rounded up to a power of 2
+
+/* Copy the flash vector table to SRAM and point VTOR at the copy: vector fetches no longer wait on flash */
+void ram_vector_table_init(void)
+{
+	uint32_t primask = __get_PRIMASK();
+
+	__disable_irq();
+	for(uint32_t i = 0; i < RAM_VECTOR_COUNT; i++)
+	{
+		ram_vector_table[i] = g_pfnVectors[i];
+	}
+	SCB->VTOR = (uint32_t)ram_vector_table;
+	__DSB();
+	__ISB();
+	__set_PRIMASK(primask);
+}
+
+/* Back to the flash vector table */
+void ram_vector_table_restore(void)
+{
+	SCB->VTOR = (uint32_t)g_pfnVectors;
+	__DSB();
+	__ISB();
+}
+
+uint8_t ram_vector_table_active(void)
+{
+	return (SCB->VTOR == (uint32_t)ram_vector_table) ? 1 : 0;
+}
@@ -0,0 +1,414 @@
+/*
+ * *** Purpose:
+ * Run the read -> process -> take action pipeline for every sensor of a descriptor table,
+ * with a fixed number of tasks whatever the number of sensors.
+ *
+ * *** How it works
+ * 1. TIM2 triggers one ADC scan of all sensor channels at the fastest rate of the table, DMA stores the scan
+ *    into one half of a double buffer and interrupts once per scan (DMA2 Stream 0 handler).
+ *    With ADC_TIMER_TRIGGER 0, Task Read data starts every scan by software (SWSTART) after a vTaskDelay instead,
+ *    the path before TIM2: sensor_pipeline_scan_interval() compares the jitter of both.
+ * 2. Task Process data, notified with the buffer half that is ready, walks the table once: every sensor takes
+ *    its sample when its own rate is due, runs it through its streaming filter (stream_filter.c) and publishes
+ *    the filtered value on every sample through its sequence lock.
+ * 3. Task Take action, notified with one bit per sensor that has a new value, sets each actuator.
+ *
+ * Every scan is stamped with the cycle counter in the DMA interrupt, the stamp travels with the filtered value
+ * and Take action records interrupt to actuator latency in latency_histogram.c. A latency that spans a clock
+ * switch (clock epoch of the stamp changed) is not recorded, its cycles have no single clock to convert with.
+ *
+ * RAM grows with the number of sensors by sizeof(SensorRuntime_t) plus two samples of scan buffer,
+ * CPU by one pass of the loop body per scan. The cost is measured by sensor_pipeline_ram_bytes()
+ * and sensor_pipeline_scan_cycles().
+ */
+
+/* Includes */
+#include "cmsis_os.h"
+#include "sensor_pipeline.h"
+#include "adc_interrupt.h"
+#include "seqlock.h"
+#include "stream_filter.h"
+#include "cycle_counter.h"
+#include "latency_histogram.h"
+#include "ram_code.h"
+
+/* Define macros */
+#define STACK_SIZE 				256
+#define PROCESS_TASK_PRIORITY	2				// above Take action, a scan must be consumed before DMA comes back to its half
+#define ACTION_TASK_PRIORITY	1
+#define READ_TASK_PRIORITY		3				// ADC_TIMER_TRIGGER 0: starts the scans as close to the tick as it can
+
+#ifndef ADC_TIMER_TRIGGER
+#define ADC_TIMER_TRIGGER		1				// 1 = TIM2 starts every scan, 0 = Task Read data starts every scan by software (SWSTART)
+#endif
+
+/* Declare types */
+typedef struct
+{
+	uint32_t decimation;						// scans per sample of this sensor, may be changed by sensor_pipeline_set_rate
+	uint32_t threshold;							// copy of the table threshold, may be changed by sensor_pipeline_set_threshold
+	uint32_t decimation_counter;
+	StreamFilter_t filter;
+	uint32_t data_counter;						// samples of the current window, for min and max
+	uint32_t data_min;
+	uint32_t data_max;
+	uint32_t window_min;						// min and max of the last complete window
+	uint32_t window_max;
+	SensorState_t state;						// published state, read through lock
+	seqlock_t lock;
+} SensorRuntime_t;
+
+/* Declare private functions */
+#if !ADC_TIMER_TRIGGER
+static void vTaskReadData(void *pvParameters);
+#endif
+static void vTaskProcessData(void *pvParameters);
+static void vTaskTakeAction(void *pvParameters);
+static uint32_t sensor_pipeline_process_scan(const volatile uint16_t *scan, uint32_t scan_end, uint32_t scan_epoch);
+
+/* Declare private variables */
+static const SensorDescriptor_t *sensor_table;
+static uint32_t sensor_count;
+static uint32_t scan_rate_hz;
+static SensorRuntime_t *sensor_runtime;
+static volatile uint16_t *scan_buffer;			// two scans of sensor_count samples, filled by DMA
+static volatile uint32_t scan_end_cycles[2];	// cycle count at the end of the scan in each half, set by the DMA interrupt
+static volatile uint32_t scan_end_epoch[2];		// clock epoch of scan_end_cycles
+static uint32_t pipeline_ram_bytes;
+
+/* Declare Task Handles */
+#if !ADC_TIMER_TRIGGER
+static TaskHandle_t xTaskHandleReadData;
+#endif
+static TaskHandle_t xTaskHandleProcessData;
+static TaskHandle_t xTaskHandleTakeAction;
+
+/* Task Profilers, for debugging only */
+typedef uint32_t TaskProfiler;
+TaskProfiler	taskProfilerReadData, taskProfilerScanIRQ, taskProfilerScanOverrun,
+				taskProfilerProcessData, taskProfilerTakeAction, taskProfilerLatencyDiscarded;
+
+/* Cycle Profilers, for debugging only: time between two scans (jitter = max - min) and cost of processing one scan */
+typedef uint32_t CycleProfiler;
+CycleProfiler	cycleProfilerScanInterval, cycleProfilerScanIntervalMin = UINT32_MAX, cycleProfilerScanIntervalMax,
+				cycleProfilerProcessScan, cycleProfilerProcessScanMax;
+
+/* Sum of the processing cycles and scans processed since the start: mean cost of one scan = sum / scans.
+ * Unlike the last and the largest scan it averages out the preemptions, and shows the cost per sensor. */
+static uint64_t process_cycles_sum;
+static uint32_t process_scans;
+
+/* Cycle Profilers, for debugging only: cost of publishing and reading the state of one sensor through its sequence lock */
+CycleProfiler	cycleProfilerPublishState, cycleProfilerReadState;
+
+
+/* Create buffers and tasks for the table and start sampling. The table must stay valid (static or const). */
+void sensor_pipeline_init(const SensorDescriptor_t *table, uint32_t count)
+{
+	uint8_t channels[SENSOR_MAX];
+	size_t free_heap_before = xPortGetFreeHeapSize();
+	uint32_t i;
+
+	configASSERT((count > 0) && (count <= SENSOR_MAX));
+
+	sensor_table = table;
+	sensor_count = count;
+
+	/* The fastest sensor sets the scan rate, the others take one scan out of decimation */
+	scan_rate_hz = 0;
+	for(i = 0; i < count; i++)
+	{
+		if(table[i].rate_hz > scan_rate_hz) scan_rate_hz = table[i].rate_hz;
+	}
+
+	sensor_runtime = pvPortMalloc(count * sizeof(SensorRuntime_t));
+	scan_buffer = pvPortMalloc(2 * count * sizeof(uint16_t));
+	configASSERT((sensor_runtime != NULL) && (scan_buffer != NULL));
+
+	for(i = 0; i < count; i++)
+	{
+		configASSERT((scan_rate_hz % table[i].rate_hz) == 0);
+		configASSERT((table[i].filter_window > 0) && (table[i].filter_window <= FILTER_WINDOW_MAX));
+
+		sensor_runtime[i].decimation = scan_rate_hz / table[i].rate_hz;
+		sensor_runtime[i].threshold = table[i].threshold;
+		sensor_runtime[i].decimation_counter = 0;
+		stream_filter_init(&sensor_runtime[i].filter, table[i].filter, table[i].filter_window);
+		sensor_runtime[i].data_counter = 0;
+		sensor_runtime[i].data_min = UINT32_MAX;
+		sensor_runtime[i].data_max = 0;
+		sensor_runtime[i].window_min = 0;
+		sensor_runtime[i].window_max = 0;
+		sensor_runtime[i].state = (SensorState_t){0};
+		seqlock_init(&sensor_runtime[i].lock);
+
+		channels[i] = table[i].adc_channel;
+		GPIO_OUT_pin_init(table[i].actuator_port, table[i].actuator_pin);
+	}
+
+	/* Create Tasks */
+	xTaskCreate(vTaskProcessData, "Task process sensor data",	STACK_SIZE, NULL, PROCESS_TASK_PRIORITY, &xTaskHandleProcessData);
+	xTaskCreate(vTaskTakeAction,  "Task take action with data", STACK_SIZE, NULL, ACTION_TASK_PRIORITY,  &xTaskHandleTakeAction);
+#if !ADC_TIMER_TRIGGER
+	xTaskCreate(vTaskReadData,    "Task read sensor data",      STACK_SIZE, NULL, READ_TASK_PRIORITY,    &xTaskHandleReadData);
+#endif
+
+	pipeline_ram_bytes = free_heap_before - xPortGetFreeHeapSize();	// runtime, buffer, task stacks and TCBs
+
+	/* Start sampling, the first scan arrives one period later */
+	adc_scan_init(channels, count, scan_buffer);
+#if ADC_TIMER_TRIGGER
+	adc_timer_trigger_init(scan_rate_hz);
+#endif
+}
+
+/* Copy the latest state of one sensor, returns its version (0 = no sample yet, SEQLOCK_BUSY = no copy) */
+uint32_t sensor_pipeline_get_state(uint32_t sensor, SensorState_t *state)
+{
+	return seqlock_read(&sensor_runtime[sensor].lock, &sensor_runtime[sensor].state, state, sizeof(*state));
+}
+
+uint32_t sensor_pipeline_count(void)
+{
+	return sensor_count;
+}
+
+/* Change the actuator threshold of one sensor while running, returns 1 on success */
+uint8_t sensor_pipeline_set_threshold(uint32_t sensor, uint32_t threshold)
+{
+	if(sensor >= sensor_count)
+	{
+		return 0;
+	}
+
+	sensor_runtime[sensor].threshold = threshold;			// single word store, Take action sees old or new value
+	return 1;
+}
+
+/* Change the sample rate of one sensor while running, returns 1 on success.
+ * The scan rate is fixed at init, so the new rate must divide it. */
+uint8_t sensor_pipeline_set_rate(uint32_t sensor, uint32_t rate_hz)
+{
+	if((sensor >= sensor_count) || (rate_hz == 0) || (rate_hz > scan_rate_hz) || ((scan_rate_hz % rate_hz) != 0))
+	{
+		return 0;
+	}
+
+	sensor_runtime[sensor].decimation = scan_rate_hz / rate_hz;	// single word store, takes effect on the next scan
+	return 1;
+}
+
+/* Scans lost because processing fell behind DMA, the deadline of the pipeline */
+uint32_t sensor_pipeline_overruns(void)
+{
+	return taskProfilerScanOverrun;
+}
+
+uint32_t sensor_pipeline_ram_bytes(void)
+{
+	return pipeline_ram_bytes;
+}
+
+uint32_t sensor_pipeline_scan_cycles(void)
+{
+	return cycleProfilerProcessScanMax;
+}
+
+/* Mean cost of processing one scan in cycles, 0 before the first scan */
+uint32_t sensor_pipeline_scan_cycles_mean(void)
+{
+	return (process_scans > 0) ? (uint32_t)(process_cycles_sum / process_scans) : 0;
+}
+
+/* Shortest and longest time between two scans in cycles, jitter = max - min (0, 0 before two scans) */
+void sensor_pipeline_scan_interval(uint32_t *min_cycles, uint32_t *max_cycles)
+{
+	*min_cycles = (cycleProfilerScanIntervalMax > 0) ? cycleProfilerScanIntervalMin : 0;
+	*max_cycles = cycleProfilerScanIntervalMax;
+}
+
+/*** task functions */
+
+#if !ADC_TIMER_TRIGGER
+/* One scan per scan period, at best one per tick: the delay runs from the wake-up, not from the last scan */
+static void vTaskReadData(void *pvParameters)
+{
+	TickType_t period = (configTICK_RATE_HZ / scan_rate_hz > 0) ? (configTICK_RATE_HZ / scan_rate_hz) : 1;
+
+	while(1)
+	{
+		adc_start_conversion();					// SWSTART: one scan of all channels, DMA interrupts at its end
+		taskProfilerReadData++;
+
+		vTaskDelay(period);
+	}
+}
+#endif
+
+static void vTaskProcessData(void *pvParameters)
+{
+	uint32_t halves_ready;
+	uint32_t sensors_ready;
+	uint32_t cycles_start;
+
+	while(1)
+	{
+		xTaskNotifyWait(0, UINT32_MAX, &halves_ready, portMAX_DELAY);
+		taskProfilerProcessData++;
+
+		if((halves_ready & ADC_SCAN_FIRST_HALF) && (halves_ready & ADC_SCAN_SECOND_HALF))
+		{
+			taskProfilerScanOverrun++;				// both halves pending: one scan was overwritten before we got to it
+		}
+
+		cycles_start = cycle_counter_get();
+
+		sensors_ready = 0;
+		if(halves_ready & ADC_SCAN_FIRST_HALF)
+		{
+			sensors_ready |= sensor_pipeline_process_scan(&scan_buffer[0], scan_end_cycles[0], scan_end_epoch[0]);
+			process_scans++;
+		}
+		if(halves_ready & ADC_SCAN_SECOND_HALF)
+		{
+			sensors_ready |= sensor_pipeline_process_scan(&scan_buffer[sensor_count], scan_end_cycles[1], scan_end_epoch[1]);
+			process_scans++;
+		}
+
+		cycleProfilerProcessScan = cycle_counter_get() - cycles_start;
+		if(cycleProfilerProcessScan > cycleProfilerProcessScanMax) cycleProfilerProcessScanMax = cycleProfilerProcessScan;
+		process_cycles_sum += cycleProfilerProcessScan;
+
+		if(sensors_ready != 0)
+		{
+			xTaskNotify(xTaskHandleTakeAction, sensors_ready, eSetBits);	// wake-up only, the data travels through the sequence locks
+		}
+	}
+}
+
+static void vTaskTakeAction(void *pvParameters)
+{
+	uint32_t sensors_ready;
+	SensorState_t state;
+	uint32_t cycles_start;
+	uint32_t cycles_now;
+	uint32_t version;
+	uint32_t i;
+
+	while(1)
+	{
+		xTaskNotifyWait(0, UINT32_MAX, &sensors_ready, portMAX_DELAY);
+		taskProfilerTakeAction++;
+
+		for(i = 0; i < sensor_count; i++)
+		{
+			if(sensors_ready & (1U << i))
+			{
+				cycles_start = cycle_counter_get();
+				version = sensor_pipeline_get_state(i, &state);		// never blocks, retries only if Process data was writing
+				cycleProfilerReadState = cycle_counter_get() - cycles_start;
+
+				if(version == SEQLOCK_BUSY)
+				{
+					continue;						// preempted the writer, the next scan updates the output
+				}
+				GPIO_OUT_pin_write(sensor_table[i].actuator_port, sensor_table[i].actuator_pin,
+								   state.value >= sensor_runtime[i].threshold);
+
+				cycles_now = cycle_counter_get();
+				if(state.sample_clock_epoch == cycle_counter_clock_epoch())	// epoch read after the cycles: conservative
+				{
+					latency_histogram_record(cycle_counter_to_us(cycles_now - state.sample_cycles));
+				}
+				else
+				{
+					taskProfilerLatencyDiscarded++;		// spans a clock switch
+				}
+			}
+		}
+	}
+}
+
+/* One pass over the table for one scan, returns one bit per sensor that published a new value */
+static uint32_t sensor_pipeline_process_scan(const volatile uint16_t *scan, uint32_t scan_end, uint32_t scan_epoch)
+{
+	SensorRuntime_t *sensor;
+	SensorState_t new_state;
+	uint32_t sensors_ready = 0;
+	uint32_t cycles_start;
+	uint32_t data;
+	uint32_t i;
+
+	for(i = 0; i < sensor_count; i++)
+	{
+		sensor = &sensor_runtime[i];
+
+		if(++sensor->decimation_counter < sensor->decimation)
+		{
+			continue;								// not this sensor's turn
+		}
+		sensor->decimation_counter = 0;
+
+		data = scan[i];
+		if(data < sensor->data_min) sensor->data_min = data;
+		if(data > sensor->data_max) sensor->data_max = data;
+
+		if(++sensor->data_counter == sensor_table[i].filter_window)
+		{
+			sensor->window_min = sensor->data_min;
+			sensor->window_max = sensor->data_max;
+			sensor->data_counter = 0;
+			sensor->data_min = UINT32_MAX;
+			sensor->data_max = 0;
+		}
+
+		/* A new output on every sample, the decision no longer waits for the end of a window */
+		new_state.value = stream_filter_update(&sensor->filter, (uint16_t)data);
+		new_state.min = sensor->window_min;
+		new_state.max = sensor->window_max;
+		new_state.timestamp = xTaskGetTickCount();
+		new_state.sample_cycles = scan_end;
+		new_state.sample_clock_epoch = scan_epoch;
+
+		cycles_start = cycle_counter_get();
+		seqlock_write(&sensor->lock, &sensor->state, &new_state, sizeof(new_state));	// never blocks, no priority inheritance
+		cycleProfilerPublishState = cycle_counter_get() - cycles_start;
+
+		sensors_ready |= (1U << i);
+	}
+
+	return sensors_ready;
+}
+
+/* DMA interrupt handler: one scan is complete, runs from SRAM */
+RAMFUNC void DMA2_Stream0_IRQHandler(void)
+{
+	BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+	static uint32_t cycles_last_scan;
+	uint32_t cycles_now;
+	uint32_t halves;
+
+	halves = adc_scan_irq_status();
+	if(halves != 0)
+	{
+		cycles_now = cycle_counter_get();
+		if(taskProfilerScanIRQ > 0)
+		{
+			cycleProfilerScanInterval = cycles_now - cycles_last_scan;
+			if(cycleProfilerScanInterval < cycleProfilerScanIntervalMin) cycleProfilerScanIntervalMin = cycleProfilerScanInterval;
+			if(cycleProfilerScanInterval > cycleProfilerScanIntervalMax) cycleProfilerScanIntervalMax = cycleProfilerScanInterval;
+		}
+		cycles_last_scan = cycles_now;
+
+		if(halves & ADC_SCAN_FIRST_HALF) scan_end_cycles[0] = cycles_now;		// start of the latency measurement
+		if(halves & ADC_SCAN_SECOND_HALF) scan_end_cycles[1] = cycles_now;
+		if(halves & ADC_SCAN_FIRST_HALF) scan_end_epoch[0] = cycle_counter_clock_epoch();
+		if(halves & ADC_SCAN_SECOND_HALF) scan_end_epoch[1] = cycle_counter_clock_epoch();
+
+		taskProfilerScanIRQ++;
+
+		xTaskNotifyFromISR(xTaskHandleProcessData, halves, eSetBits, &xHigherPriorityTaskWoken);
+
+		portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+	}
+}
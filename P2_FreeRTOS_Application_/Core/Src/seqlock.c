@@ -0,0 +1,48 @@
+#include  <string.h>
+#include  "seqlock.h"
+
+#define SEQLOCK_BARRIER()	__atomic_thread_fence(__ATOMIC_SEQ_CST)		// DMB on Cortex-M4, keeps the copy between the sequence updates
+
+void seqlock_init(seqlock_t *lock)
+{
+	lock->sequence = 0;
+}
+
+/* Publish a new snapshot: sequence goes odd, data is copied, sequence goes even again */
+void seqlock_write(seqlock_t *lock, void *shared, const void *data, size_t size)
+{
+	lock->sequence++;
+	SEQLOCK_BARRIER();
+
+	memcpy(shared, data, size);
+
+	SEQLOCK_BARRIER();
+	lock->sequence++;
+}
+
+/* Copy a consistent snapshot and return its version (sequence/2 = number of writes so far), or SEQLOCK_BUSY */
+uint32_t seqlock_read(const seqlock_t *lock, const void *shared, void *copy, size_t size)
+{
+	uint32_t sequence_before;
+	uint32_t sequence_after;
+	uint32_t retries = 0;
+
+	do
+	{
+		if(retries++ == SEQLOCK_READ_RETRIES)
+		{
+			return SEQLOCK_BUSY;				// the writer cannot go on while this reader runs
+		}
+
+		sequence_before = lock->sequence;
+		SEQLOCK_BARRIER();
+
+		memcpy(copy, shared, size);
+
+		SEQLOCK_BARRIER();
+		sequence_after = lock->sequence;
+	}
+	while((sequence_before & 1U) || (sequence_before != sequence_after));	// retry if a write was in progress or happened meanwhile
+
+	return (sequence_after >> 1);
+}
@@ -0,0 +1,30 @@
+#include  "soft_irq.h"
+#include  "stm32f4xx_hal.h"
+
+#define SOFT_IRQn			EXTI1_IRQn		// EXTI line 1 is not used by the application, it is only pended by software
+#define SOFT_IRQ_PRIORITY	6				// Must not be above configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY to call FromISR API
+
+static void (*soft_irq_handler)(void);
+
+void soft_irq_init(void (*handler)(void))
+{
+	soft_irq_handler = handler;
+
+	NVIC_SetPriority(SOFT_IRQn, SOFT_IRQ_PRIORITY);
+	NVIC_EnableIRQ(SOFT_IRQn);
+}
+
+void soft_irq_trigger(void)
+{
+	NVIC_SetPendingIRQ(SOFT_IRQn);			// Raise the interrupt as if the peripheral had requested it
+	__DSB();
+	__ISB();								// The handler has run when this returns
+}
+
+void EXTI1_IRQHandler(void)
+{
+	if(soft_irq_handler != NULL)
+	{
+		soft_irq_handler();
+	}
+}
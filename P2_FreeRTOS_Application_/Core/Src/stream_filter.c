@@ -0,0 +1,270 @@
+/*
+ * *** Purpose:
+ * Streaming filters that give an updated output on every sample, instead of one output per block of samples.
+ *
+ * *** How it works
+ * 1. Mean: the sample leaving the window is subtracted from a running sum, the new one added. O(1).
+ * 2. EMA: output += alpha * (sample - output), alpha = 2 / (window + 1) so its lag matches the mean of the window. O(1).
+ * 3. Median: the window is split into a max heap of the lower half and a min heap of the upper half, the median
+ *    is at their tops. Every ring slot knows its heap position, so the oldest sample is overwritten in place and
+ *    sifted up or down, and at most one swap of both tops restores the order. O(log window).
+ */
+
+/* Includes */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "stream_filter.h"
+
+/* Define macros */
+#define MEDIAN_LOW		0					// max heap, lower half of the window
+#define MEDIAN_HIGH		1					// min heap, upper half of the window
+#define Q16_ONE			(1L<<16)
+
+/* Declare private functions */
+static uint8_t median_above(const MedianFilter_t *filter, uint8_t heap, uint8_t slot_a, uint8_t slot_b);
+static void median_place(MedianFilter_t *filter, uint8_t heap, uint8_t index, uint8_t slot);
+static void median_sift_up(MedianFilter_t *filter, uint8_t heap, uint8_t index);
+static void median_sift_down(MedianFilter_t *filter, uint8_t heap, uint8_t index);
+static void median_push(MedianFilter_t *filter, uint8_t heap, uint8_t slot);
+static uint8_t median_pop(MedianFilter_t *filter, uint8_t heap);
+static void median_order_tops(MedianFilter_t *filter);
+
+
+void stream_filter_init(StreamFilter_t *filter, FilterType_t type, uint32_t window)
+{
+	filter->type = type;
+
+	switch(type)
+	{
+	case FILTER_EMA:	ema_filter_init(&filter->ema, window);			break;
+	case FILTER_MEDIAN:	median_filter_init(&filter->median, window);	break;
+	default:			mean_filter_init(&filter->mean, window);		break;
+	}
+}
+
+uint32_t stream_filter_update(StreamFilter_t *filter, uint16_t sample)
+{
+	switch(filter->type)
+	{
+	case FILTER_EMA:	return ema_filter_update(&filter->ema, sample);
+	case FILTER_MEDIAN:	return median_filter_update(&filter->median, sample);
+	default:			return mean_filter_update(&filter->mean, sample);
+	}
+}
+
+/*** Sliding mean */
+
+void mean_filter_init(MeanFilter_t *filter, uint32_t window)
+{
+	configASSERT((window > 0) && (window <= FILTER_WINDOW_MAX));
+
+	filter->window = window;
+	filter->next = 0;
+	filter->count = 0;
+	filter->sum = 0;
+}
+
+uint32_t mean_filter_update(MeanFilter_t *filter, uint16_t sample)
+{
+	if(filter->count == filter->window)
+	{
+		filter->sum -= filter->samples[filter->next];			// oldest sample leaves the window
+	}
+	else
+	{
+		filter->count++;										// window still filling, mean of what we have
+	}
+
+	filter->samples[filter->next] = sample;
+	filter->sum += sample;
+	filter->next = (filter->next + 1 == filter->window) ? 0 : filter->next + 1;
+
+	return filter->sum / filter->count;
+}
+
+/*** Exponential moving average */
+
+void ema_filter_init(EmaFilter_t *filter, uint32_t window)
+{
+	configASSERT(window > 0);
+
+	filter->alpha = (int32_t)((2 * Q16_ONE) / (window + 1));
+	filter->output = 0;
+	filter->primed = 0;
+}
+
+uint32_t ema_filter_update(EmaFilter_t *filter, uint16_t sample)
+{
+	int32_t input = (int32_t)sample << 16;
+
+	if(!filter->primed)
+	{
+		filter->output = input;									// start from the first sample, not from 0
+		filter->primed = 1;
+	}
+	else
+	{
+		filter->output += (int32_t)(((int64_t)(input - filter->output) * filter->alpha) >> 16);
+	}
+
+	return (uint32_t)(filter->output + (Q16_ONE / 2)) >> 16;
+}
+
+/*** Sliding median */
+
+void median_filter_init(MedianFilter_t *filter, uint32_t window)
+{
+	configASSERT((window > 0) && (window <= FILTER_WINDOW_MAX));
+
+	filter->window = window;
+	filter->next = 0;
+	filter->count = 0;
+	filter->heap_count[MEDIAN_LOW] = 0;
+	filter->heap_count[MEDIAN_HIGH] = 0;
+}
+
+uint32_t median_filter_update(MedianFilter_t *filter, uint16_t sample)
+{
+	uint8_t slot = filter->next;
+	uint16_t old_sample = filter->samples[slot];
+	uint8_t heap;
+
+	filter->samples[slot] = sample;
+	filter->next = (slot + 1 == filter->window) ? 0 : slot + 1;
+
+	if(filter->count < filter->window)
+	{
+		/* Window still filling: new slot into the half it belongs to, then keep the halves balanced (low may hold one more) */
+		filter->count++;
+		heap = ((filter->heap_count[MEDIAN_LOW] == 0) || (sample <= filter->samples[filter->heap[MEDIAN_LOW][0]])) ? MEDIAN_LOW : MEDIAN_HIGH;
+		median_push(filter, heap, slot);
+
+		if(filter->heap_count[MEDIAN_LOW] > filter->heap_count[MEDIAN_HIGH] + 1)
+		{
+			median_push(filter, MEDIAN_HIGH, median_pop(filter, MEDIAN_LOW));
+		}
+		else if(filter->heap_count[MEDIAN_HIGH] > filter->heap_count[MEDIAN_LOW])
+		{
+			median_push(filter, MEDIAN_LOW, median_pop(filter, MEDIAN_HIGH));
+		}
+	}
+	else
+	{
+		/* Window full: the new sample takes the slot of the oldest one, in its heap */
+		heap = filter->heap_of[slot];
+		if((heap == MEDIAN_LOW) ? (sample > old_sample) : (sample < old_sample))
+		{
+			median_sift_up(filter, heap, filter->index_of[slot]);
+		}
+		else
+		{
+			median_sift_down(filter, heap, filter->index_of[slot]);
+		}
+		median_order_tops(filter);
+	}
+
+	if(filter->heap_count[MEDIAN_LOW] > filter->heap_count[MEDIAN_HIGH])
+	{
+		return filter->samples[filter->heap[MEDIAN_LOW][0]];
+	}
+	return ((uint32_t)filter->samples[filter->heap[MEDIAN_LOW][0]] + filter->samples[filter->heap[MEDIAN_HIGH][0]]) / 2;
+}
+
+/* 1 if slot_a must sit above slot_b in heap */
+static uint8_t median_above(const MedianFilter_t *filter, uint8_t heap, uint8_t slot_a, uint8_t slot_b)
+{
+	if(heap == MEDIAN_LOW)
+	{
+		return filter->samples[slot_a] > filter->samples[slot_b];
+	}
+	return filter->samples[slot_a] < filter->samples[slot_b];
+}
+
+static void median_place(MedianFilter_t *filter, uint8_t heap, uint8_t index, uint8_t slot)
+{
+	filter->heap[heap][index] = slot;
+	filter->heap_of[slot] = heap;
+	filter->index_of[slot] = index;
+}
+
+static void median_sift_up(MedianFilter_t *filter, uint8_t heap, uint8_t index)
+{
+	uint8_t slot = filter->heap[heap][index];
+	uint8_t parent;
+
+	while(index > 0)
+	{
+		parent = (index - 1) / 2;
+		if(!median_above(filter, heap, slot, filter->heap[heap][parent]))
+		{
+			break;
+		}
+		median_place(filter, heap, index, filter->heap[heap][parent]);
+		index = parent;
+	}
+	median_place(filter, heap, index, slot);
+}
+
+static void median_sift_down(MedianFilter_t *filter, uint8_t heap, uint8_t index)
+{
+	uint8_t slot = filter->heap[heap][index];
+	uint8_t count = filter->heap_count[heap];
+	uint8_t child;
+
+	while((child = 2 * index + 1) < count)
+	{
+		if((child + 1 < count) && median_above(filter, heap, filter->heap[heap][child + 1], filter->heap[heap][child]))
+		{
+			child++;
+		}
+		if(!median_above(filter, heap, filter->heap[heap][child], slot))
+		{
+			break;
+		}
+		median_place(filter, heap, index, filter->heap[heap][child]);
+		index = child;
+	}
+	median_place(filter, heap, index, slot);
+}
+
+static void median_push(MedianFilter_t *filter, uint8_t heap, uint8_t slot)
+{
+	uint8_t index = filter->heap_count[heap]++;
+
+	median_place(filter, heap, index, slot);
+	median_sift_up(filter, heap, index);
+}
+
+static uint8_t median_pop(MedianFilter_t *filter, uint8_t heap)
+{
+	uint8_t top = filter->heap[heap][0];
+	uint8_t last = filter->heap[heap][--filter->heap_count[heap]];
+
+	if(filter->heap_count[heap] > 0)
+	{
+		median_place(filter, heap, 0, last);
+		median_sift_down(filter, heap, 0);
+	}
+	return top;
+}
+
+/* After one slot changed value, the top of the lower half may be above the top of the upper half: swap them */
+static void median_order_tops(MedianFilter_t *filter)
+{
+	uint8_t low_top, high_top;
+
+	if(filter->heap_count[MEDIAN_HIGH] == 0)
+	{
+		return;
+	}
+
+	low_top = filter->heap[MEDIAN_LOW][0];
+	high_top = filter->heap[MEDIAN_HIGH][0];
+	if(filter->samples[low_top] > filter->samples[high_top])
+	{
+		median_place(filter, MEDIAN_LOW, 0, high_top);
+		median_place(filter, MEDIAN_HIGH, 0, low_top);
+		median_sift_down(filter, MEDIAN_LOW, 0);
+		median_sift_down(filter, MEDIAN_HIGH, 0);
+	}
+}
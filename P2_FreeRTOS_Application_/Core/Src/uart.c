@@ -1,8 +1,20 @@
 #include "uart.h"
 #include "stm32f4xx_hal.h"
 
+#define DMA1EN				(1U<<21)
+#define DMA_SCR_EN			(1U<<0)
+#define DMA_SCR_CIRC		(1U<<8)
+#define DMA_SCR_MINC		(1U<<10)
+#define DMA_SCR_CHSEL4		(4U<<25)		// DMA1 Stream 5 channel 4 is USART2_RX
+#define DMA_ALLIF5			(0xF40U)		// FEIF5, DMEIF5, TEIF5, HTIF5, TCIF5
+#define DMA_HTIF5			(1U<<10)		// Set without HTIE too, read by uart2_rx_idle_status
+#define DMA_TCIF5			(1U<<11)
+#define USART_RX_PRIORITY	6				// Must not be above configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY to call FromISR API
+
 UART_HandleTypeDef huart2;
 extern void Error_Handler(void);
+
+static uint32_t uart2_rx_size;
 /**
   * @brief USART2 Initialization Function
   * @param None
@@ -65,6 +77,87 @@ void USART2_UART_RX_Init(void)
 
 }
 
+/*
+ * Circular DMA reception: DMA copies every received byte into buffer and wraps around, the USART
+ * interrupts only when the line goes idle after a frame, so the CPU is touched once per frame.
+ * buffer must hold the bytes that can arrive between two reads of uart2_rx_idle_status().
+ */
+void USART2_UART_RX_DMA_Init(volatile uint8_t *buffer, uint16_t size)
+{
+	USART2_UART_RX_Init();				// Baud rate, TX and RX pins
+
+	/* 1. Configure DMA1 Stream 5 to move USART2->DR into buffer */
+
+	RCC->AHB1ENR |= DMA1EN;				// Enable clock access to DMA1
+
+	DMA1_Stream5->CR = 0;				// Disable the stream before configuring it
+	while(DMA1_Stream5->CR & DMA_SCR_EN){}
+
+	DMA1->HIFCR = DMA_ALLIF5;			// Clear any old flag of stream 5
+	DMA1_Stream5->PAR = (uint32_t)&USART2->DR;
+	DMA1_Stream5->M0AR = (uint32_t)buffer;
+	DMA1_Stream5->NDTR = size;
+	DMA1_Stream5->CR = DMA_SCR_CHSEL4 | DMA_SCR_MINC | DMA_SCR_CIRC;	// Byte size, peripheral to memory, no DMA interrupt
+	DMA1_Stream5->CR |= DMA_SCR_EN;
+
+	uart2_rx_size = size;
+
+	/* 2. USART: DMA request per byte, interrupt on idle line only */
+
+	USART2->CR3 |= USART_CR3_DMAR;
+	USART2->CR1 |= USART_CR1_IDLEIE;
+
+	NVIC_SetPriority(USART2_IRQn, USART_RX_PRIORITY);
+	NVIC_EnableIRQ(USART2_IRQn);
+}
+
+/*
+ * Read and clear the idle line flag: the index DMA writes next, or UART_RX_NOT_IDLE.
+ * passes gets UART_RX_PASS_HALF / UART_RX_PASS_END for the ring positions DMA went through since the last call,
+ * from the half and transfer complete flags, so the caller can tell a full turn of the ring from no byte at all.
+ */
+uint32_t uart2_rx_idle_status(uint32_t *passes)
+{
+	uint32_t ndtr;
+	uint32_t flags;
+
+	if(!(USART2->SR & USART_SR_IDLE))
+	{
+		return UART_RX_NOT_IDLE;
+	}
+
+	(void)USART2->DR;					// SR then DR read clears IDLE, RXNE is already cleared by DMA
+
+	do
+	{
+		ndtr = DMA1_Stream5->NDTR;
+		flags = DMA1->HISR & (DMA_HTIF5 | DMA_TCIF5);
+	}
+	while(DMA1_Stream5->NDTR != ndtr);	// a byte arrived in between: flags and index must belong together
+	DMA1->HIFCR = flags;				// a flag set after the loop is lost: an overrun may be missed, never invented
+
+	*passes = ((flags & DMA_HTIF5) ? UART_RX_PASS_HALF : 0) | ((flags & DMA_TCIF5) ? UART_RX_PASS_END : 0);
+	return uart2_rx_size - ndtr;
+}
+
+/* Wait until the last byte has left the shift register, before the baud rate clock changes */
+void uart2_tx_flush(void)
+{
+	if(USART2->CR1 & USART_CR1_TE)
+	{
+		while(!(USART2->SR & USART_SR_TC)){}
+	}
+}
+
+/* Keep the baud rate after a system clock change */
+void uart2_update_baud_rate(void)
+{
+	if(huart2.Instance == USART2)
+	{
+		USART2->BRR = UART_BRR_SAMPLING16(HAL_RCC_GetPCLK1Freq(), huart2.Init.BaudRate);
+	}
+}
+
  int uart2_write(int ch)
  	{
  	/*Make sure the transmit data register is empty*/
@@ -0,0 +1,73 @@
+/*
+ * Host build: FreeRTOS configuration for the host port (Src/sim_port.c).
+ * Mirrors Core/Inc/FreeRTOSConfig.h where it matters for the application (tick rate, features),
+ * everything Cortex-M specific (NVIC priorities, handler names, FPU/MPU) is left out.
+ */
+#ifndef FREERTOS_CONFIG_H
+#define FREERTOS_CONFIG_H
+
+#include <assert.h>
+#include <stdint.h>
+
+void cycle_counter_init(void);
+uint32_t cycle_counter_get(void);
+void memory_profile_task_created(void *task, void *stack_low, void *stack_high);
+
+#define configUSE_TASK_NOTIFICATIONS			 1
+#define configUSE_QUEUE_SETS					 1
+#define configUSE_PREEMPTION                     1
+#define configUSE_TIME_SLICING                   1
+#define configSUPPORT_STATIC_ALLOCATION          0
+#define configSUPPORT_DYNAMIC_ALLOCATION         1
+#define configUSE_IDLE_HOOK                      1		// WFI of the simulator (sim_hal.c)
+#define configUSE_TICK_HOOK                      0
+#define configTICK_RATE_HZ                       ((TickType_t)1000)
+#define configMAX_PRIORITIES                     ( 56 )
+#define configMINIMAL_STACK_SIZE                 ((unsigned short)128)
+#define configTOTAL_HEAP_SIZE                    ((size_t)(1024*1024))
+#define configMAX_TASK_NAME_LEN                  ( 32 )
+#define configUSE_TRACE_FACILITY                 1
+#define configUSE_16_BIT_TICKS                   0
+#define configUSE_MUTEXES                        1
+#define configQUEUE_REGISTRY_SIZE                8
+#define configUSE_RECURSIVE_MUTEXES              1
+#define configUSE_COUNTING_SEMAPHORES            1
+#define configUSE_PORT_OPTIMISED_TASK_SELECTION  0
+#define configMESSAGE_BUFFER_LENGTH_TYPE         size_t
+#define configUSE_CO_ROUTINES                    0
+#define configMAX_CO_ROUTINE_PRIORITIES          ( 2 )
+#define configCHECK_FOR_STACK_OVERFLOW           0
+#define configUSE_MALLOC_FAILED_HOOK             0
+
+#define configUSE_TIMERS                         1
+#define configTIMER_TASK_PRIORITY                ( 2 )
+#define configTIMER_QUEUE_LENGTH                 10
+#define configTIMER_TASK_STACK_DEPTH             256
+
+#define INCLUDE_vTaskPrioritySet             1
+#define INCLUDE_uxTaskPriorityGet            1
+#define INCLUDE_vTaskDelete                  1
+#define INCLUDE_vTaskCleanUpResources        0
+#define INCLUDE_vTaskSuspend                 1
+#define INCLUDE_vTaskDelayUntil              1
+#define INCLUDE_vTaskDelay                   1
+#define INCLUDE_xTaskGetSchedulerState       1
+#define INCLUDE_xTimerPendFunctionCall       1
+#define INCLUDE_xQueueGetMutexHolder         1
+#define INCLUDE_uxTaskGetStackHighWaterMark  1
+#define INCLUDE_xTaskGetCurrentTaskHandle    1
+#define INCLUDE_eTaskGetState                1
+#define INCLUDE_xTaskGetIdleTaskHandle       1
+
+/* Run time statistics count host nanoseconds (sim_cycle_counter.c) */
+#define configGENERATE_RUN_TIME_STATS             1
+#define portCONFIGURE_TIMER_FOR_RUN_TIME_STATS()  cycle_counter_init()
+#define portGET_RUN_TIME_COUNTER_VALUE()          cycle_counter_get()
+
+/* Task stacks reported to memory_profile.c */
+#define configRECORD_STACK_HIGH_ADDRESS           1
+#define traceTASK_CREATE(pxNewTCB)                memory_profile_task_created((pxNewTCB), (pxNewTCB)->pxStack, (pxNewTCB)->pxEndOfStack)
+
+#define configASSERT( x ) assert( x )
+
+#endif /* FREERTOS_CONFIG_H */
@@ -0,0 +1,60 @@
+/*
+ * Host build: FreeRTOS port macros of the ucontext port, see Src/sim_port.c.
+ * Interrupts are POSIX signals: disabling interrupts blocks them, an interrupt handler is a signal handler.
+ */
+#ifndef PORTMACRO_H
+#define PORTMACRO_H
+
+#include <stdint.h>
+
+#define portCHAR		char
+#define portFLOAT		float
+#define portDOUBLE		double
+#define portLONG		long
+#define portSHORT		short
+#define portSTACK_TYPE	uintptr_t
+#define portBASE_TYPE	long
+
+typedef portSTACK_TYPE StackType_t;
+typedef long BaseType_t;
+typedef unsigned long UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define portMAX_DELAY				((TickType_t)0xffffffffUL)
+#define portTICK_TYPE_IS_ATOMIC		1
+
+#define portSTACK_GROWTH			(-1)
+#define portTICK_PERIOD_MS			((TickType_t)1000 / configTICK_RATE_HZ)
+#define portBYTE_ALIGNMENT			16
+#define portPOINTER_SIZE_TYPE		uintptr_t
+
+void vPortYield(void);
+void vPortYieldFromISR(void);
+void vPortEnterCritical(void);
+void vPortExitCritical(void);
+void vPortDisableInterrupts(void);
+void vPortEnableInterrupts(void);
+UBaseType_t xPortSetInterruptMask(void);
+void vPortClearInterruptMask(UBaseType_t uxMask);
+void vPortDeleteThread(void *pxTCB);
+void vPortWaitForInterrupt(void);
+
+#define portYIELD()									vPortYield()
+#define portEND_SWITCHING_ISR(xSwitchRequired)		do { if(xSwitchRequired) vPortYieldFromISR(); } while(0)
+#define portYIELD_FROM_ISR(x)						portEND_SWITCHING_ISR(x)
+
+#define portDISABLE_INTERRUPTS()					vPortDisableInterrupts()
+#define portENABLE_INTERRUPTS()						vPortEnableInterrupts()
+#define portENTER_CRITICAL()						vPortEnterCritical()
+#define portEXIT_CRITICAL()							vPortExitCritical()
+#define portSET_INTERRUPT_MASK_FROM_ISR()			xPortSetInterruptMask()
+#define portCLEAR_INTERRUPT_MASK_FROM_ISR(x)		vPortClearInterruptMask(x)
+
+#define portCLEAN_UP_TCB(pxTCB)						vPortDeleteThread(pxTCB)
+
+#define portTASK_FUNCTION_PROTO(vFunction, pvParameters)	void vFunction(void *pvParameters)
+#define portTASK_FUNCTION(vFunction, pvParameters)			void vFunction(void *pvParameters)
+
+#define portNOP()
+
+#endif /* PORTMACRO_H */
@@ -0,0 +1,19 @@
+/*
+ * Host build: simulated peripherals and pipeline statistics.
+ */
+#ifndef HOST_SIM_H
+#define HOST_SIM_H
+
+#include <stdint.h>
+
+uint64_t sim_now_ns(void);					// monotonic time since process start
+
+uint64_t sim_adc_last_sample_ns(void);		// time of the most recent simulated end of scan
+uint32_t sim_adc_samples(void);				// number of simulated samples so far, all channels
+int      sim_adc_finished(void);			// 1 once SIM_SAMPLES samples have been produced
+
+void sim_gpio_report(void);
+void sim_clock_report(void);
+void sim_report(void);
+
+#endif /* HOST_SIM_H */
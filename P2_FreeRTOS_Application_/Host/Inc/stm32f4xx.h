@@ -0,0 +1,49 @@
+/*
+ * Host build: register mock of the STM32F401 peripherals used by the application.
+ * The peripherals are plain structs in RAM, the simulator (Host/Src) plays the hardware side.
+ */
+#ifndef HOST_STM32F4XX_H
+#define HOST_STM32F4XX_H
+
+#include <stdint.h>
+
+#define __IO	volatile
+
+typedef struct
+{
+	__IO uint32_t SR;
+	__IO uint32_t CR1;
+	__IO uint32_t CR2;
+	__IO uint32_t SQR1;
+	__IO uint32_t SQR3;
+	__IO uint32_t DR;
+} ADC_TypeDef;
+
+typedef struct
+{
+	__IO uint32_t MODER;
+	__IO uint32_t ODR;
+	__IO uint32_t AFR[2];
+} GPIO_TypeDef;
+
+typedef struct
+{
+	__IO uint32_t AHB1ENR;
+	__IO uint32_t APB1ENR;
+	__IO uint32_t APB2ENR;
+} RCC_TypeDef;
+
+extern ADC_TypeDef  sim_ADC1;
+extern GPIO_TypeDef sim_GPIOA;
+extern RCC_TypeDef  sim_RCC;
+
+#define ADC1		(&sim_ADC1)
+#define GPIOA		(&sim_GPIOA)
+#define RCC			(&sim_RCC)
+
+#define ADC_SR_EOC	(1U<<1)
+
+#define __disable_irq()
+#define __enable_irq()
+
+#endif /* HOST_STM32F4XX_H */
@@ -0,0 +1,67 @@
+/*
+ * Host build: the subset of the STM32F4 HAL used by main.c.
+ * Clock configuration has no meaning on the host, the calls succeed and do nothing.
+ */
+#ifndef HOST_STM32F4XX_HAL_H
+#define HOST_STM32F4XX_HAL_H
+
+#include "stm32f4xx.h"
+
+typedef enum
+{
+	HAL_OK = 0,
+	HAL_ERROR
+} HAL_StatusTypeDef;
+
+typedef struct
+{
+	uint32_t PLLState;
+	uint32_t PLLSource;
+	uint32_t PLLM;
+	uint32_t PLLN;
+	uint32_t PLLP;
+	uint32_t PLLQ;
+} RCC_PLLInitTypeDef;
+
+typedef struct
+{
+	uint32_t OscillatorType;
+	uint32_t HSIState;
+	uint32_t HSICalibrationValue;
+	RCC_PLLInitTypeDef PLL;
+} RCC_OscInitTypeDef;
+
+typedef struct
+{
+	uint32_t ClockType;
+	uint32_t SYSCLKSource;
+	uint32_t AHBCLKDivider;
+	uint32_t APB1CLKDivider;
+	uint32_t APB2CLKDivider;
+} RCC_ClkInitTypeDef;
+
+#define RCC_OSCILLATORTYPE_HSI			0x00000002U
+#define RCC_HSI_ON						1U
+#define RCC_HSICALIBRATION_DEFAULT		0x10U
+#define RCC_PLL_ON						2U
+#define RCC_PLLSOURCE_HSI				0U
+#define RCC_PLLP_DIV4					4U
+#define RCC_CLOCKTYPE_SYSCLK			0x00000001U
+#define RCC_CLOCKTYPE_HCLK				0x00000002U
+#define RCC_CLOCKTYPE_PCLK1				0x00000004U
+#define RCC_CLOCKTYPE_PCLK2				0x00000008U
+#define RCC_SYSCLKSOURCE_PLLCLK			2U
+#define RCC_SYSCLK_DIV1					1U
+#define RCC_HCLK_DIV1					1U
+#define RCC_HCLK_DIV2					2U
+#define FLASH_LATENCY_2					2U
+#define PWR_REGULATOR_VOLTAGE_SCALE2	2U
+
+#define __HAL_RCC_PWR_CLK_ENABLE()
+#define __HAL_PWR_VOLTAGESCALING_CONFIG(__REGULATOR__)
+
+HAL_StatusTypeDef HAL_Init(void);
+HAL_StatusTypeDef HAL_RCC_OscConfig(RCC_OscInitTypeDef *RCC_OscInitStruct);
+HAL_StatusTypeDef HAL_RCC_ClockConfig(RCC_ClkInitTypeDef *RCC_ClkInitStruct, uint32_t FLatency);
+
+#endif /* HOST_STM32F4XX_HAL_H */
@@ -0,0 +1,185 @@
+/*
+ * Host build: simulated ADC1 scan with DMA into a double buffer.
+ *
+ * A POSIX interval timer raises SIM_ADC_SIGNAL at the sample rate set by adc_timer_trigger_init, like TIM2 TRGO.
+ * adc_start_conversion (SWSTART) raises it once, from the calling task.
+ * The signal handler plays the ADC and DMA hardware: it writes one sample per channel into the next half of
+ * the scan buffer, flags the half as complete and calls the application's DMA2_Stream0_IRQHandler, just like
+ * the NVIC would. The host port (Src/sim_port.c) blocks all signals inside critical sections, so the handler
+ * behaves like an interrupt at configMAX_SYSCALL_INTERRUPT_PRIORITY.
+ *
+ * Samples come from the file named by SIM_ADC_FILE (one value 0..4095 per line, replayed in a loop),
+ * otherwise from a triangle wave generator. SIM_SAMPLES sets how many samples (all channels) are produced before the report.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include  <signal.h>
+#include  <stdio.h>
+#include  <stdlib.h>
+#include  <time.h>
+#include  "adc_interrupt.h"
+#include  "stm32f4xx.h"
+#include  "sim.h"
+
+#define SIM_ADC_SIGNAL			(SIGRTMIN)
+#define SIM_SAMPLES				5000			// default number of samples before the report
+#define SIM_FILE_MAX_SAMPLES	65536
+#define SIM_TRIANGLE_PERIOD		200				// samples per triangle wave period
+#define ADC_MAX_VALUE			4095
+
+extern void DMA2_Stream0_IRQHandler(void);
+
+static uint32_t file_samples[SIM_FILE_MAX_SAMPLES];
+static uint32_t file_length;
+
+static volatile uint32_t samples_produced;
+static volatile uint32_t samples_target = SIM_SAMPLES;
+static volatile uint64_t last_sample_ns;
+static timer_t sim_adc_timer;
+
+static volatile uint16_t *scan_buffer;
+static uint32_t scan_count;
+static uint32_t scan_next_half;
+static volatile uint32_t scan_halves_pending;
+
+static void sim_adc_load_file(const char *path);
+static uint32_t sim_adc_next_sample(void);
+static void sim_adc_signal_handler(int signal_number);
+static void sim_adc_set_period(long period_us);
+
+void adc_scan_init(const uint8_t *channels, uint32_t count, volatile uint16_t *buffer)
+{
+	struct sigaction action = {0};
+	struct sigevent event = {0};
+	const char *env;
+
+	(void)channels;						// every channel sees the same signal source
+
+	/* 1. Configure the sample source */
+	if((env = getenv("SIM_ADC_FILE")) != NULL) sim_adc_load_file(env);
+	if((env = getenv("SIM_SAMPLES")) != NULL) samples_target = (uint32_t)strtoul(env, NULL, 10);
+
+	/* 2. The DMA destination, two scans of count samples */
+	scan_buffer = buffer;
+	scan_count = count;
+	scan_next_half = 0;
+
+	/* 3. Timer signal that plays the trigger, started by adc_timer_trigger_init */
+	action.sa_handler = sim_adc_signal_handler;
+	action.sa_flags = SA_RESTART;
+	sigfillset(&action.sa_mask);
+	sigaction(SIM_ADC_SIGNAL, &action, NULL);
+
+	event.sigev_notify = SIGEV_SIGNAL;
+	event.sigev_signo = SIM_ADC_SIGNAL;
+	if(timer_create(CLOCK_MONOTONIC, &event, &sim_adc_timer) != 0)
+	{
+		perror("sim adc timer_create");
+		exit(1);
+	}
+}
+
+void adc_timer_trigger_init(uint32_t sample_rate_hz)
+{
+	sim_adc_set_period(1000000L / (long)sample_rate_hz);	// Every timer signal is one scan, like TIM2 TRGO
+}
+
+/* The scan completes before the function returns, the host does not model the conversion time */
+void adc_start_conversion(void)
+{
+	raise(SIM_ADC_SIGNAL);
+}
+
+uint32_t adc_scan_irq_status(void)
+{
+	uint32_t halves = scan_halves_pending;
+
+	scan_halves_pending = 0;			// Like writing LIFCR
+	return halves;
+}
+
+uint64_t sim_adc_last_sample_ns(void)
+{
+	return last_sample_ns;
+}
+
+uint32_t sim_adc_samples(void)
+{
+	return samples_produced;
+}
+
+int sim_adc_finished(void)
+{
+	return (samples_produced >= samples_target);
+}
+
+static void sim_adc_signal_handler(int signal_number)
+{
+	volatile uint16_t *half;
+	uint32_t i;
+
+	(void)signal_number;
+
+	if((scan_buffer == NULL) || sim_adc_finished())
+	{
+		return;
+	}
+
+	half = &scan_buffer[scan_next_half * scan_count];
+	for(i = 0; i < scan_count; i++)
+	{
+		half[i] = (uint16_t)sim_adc_next_sample();
+		samples_produced++;
+	}
+
+	scan_halves_pending |= (scan_next_half == 0) ? ADC_SCAN_FIRST_HALF : ADC_SCAN_SECOND_HALF;
+	scan_next_half ^= 1;
+	last_sample_ns = sim_now_ns();
+
+	DMA2_Stream0_IRQHandler();
+}
+
+static void sim_adc_set_period(long period_us)
+{
+	struct itimerspec period = {0};
+
+	period.it_interval.tv_sec = period_us / 1000000;
+	period.it_interval.tv_nsec = (period_us % 1000000) * 1000;
+	period.it_value = period.it_interval;
+	timer_settime(sim_adc_timer, 0, &period, NULL);
+}
+
+static uint32_t sim_adc_next_sample(void)
+{
+	uint32_t phase;
+
+	if(file_length > 0)
+	{
+		return file_samples[samples_produced % file_length];
+	}
+
+	phase = samples_produced % SIM_TRIANGLE_PERIOD;
+	if(phase < SIM_TRIANGLE_PERIOD/2)
+	{
+		return (phase * ADC_MAX_VALUE) / (SIM_TRIANGLE_PERIOD/2);
+	}
+	return ((SIM_TRIANGLE_PERIOD - phase) * ADC_MAX_VALUE) / (SIM_TRIANGLE_PERIOD/2);
+}
+
+static void sim_adc_load_file(const char *path)
+{
+	FILE *file = fopen(path, "r");
+	unsigned long value;
+
+	if(file == NULL)
+	{
+		perror(path);
+		exit(1);
+	}
+
+	while((file_length < SIM_FILE_MAX_SAMPLES) && (fscanf(file, "%lu", &value) == 1))
+	{
+		file_samples[file_length++] = (uint32_t)(value & ADC_MAX_VALUE);
+	}
+
+	fclose(file);
+}
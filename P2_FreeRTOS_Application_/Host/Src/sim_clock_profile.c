@@ -0,0 +1,45 @@
+/*
+ * Host build: clock profiles have no hardware to switch, the choice of the governor is recorded for the report.
+ */
+#include  <stdio.h>
+#include  "clock_profile.h"
+#include  "clock_governor.h"
+#include  "cycle_counter.h"
+#include  "sim.h"
+
+static const uint32_t profile_hz[CLOCK_PROFILE_COUNT] = { 16000000, 42000000, 84000000 };
+static ClockProfile_t profile_current = CLOCK_PROFILE_84MHZ;
+static uint32_t switches;
+
+uint8_t clock_profile_set(ClockProfile_t profile)
+{
+	if(profile >= CLOCK_PROFILE_COUNT)
+	{
+		return 0;
+	}
+	if(profile != profile_current)
+	{
+		cycle_counter_clock_changed();
+		profile_current = profile;
+		switches++;
+		cycle_counter_clock_changed();
+	}
+	return 1;
+}
+
+ClockProfile_t clock_profile_get(void)
+{
+	return profile_current;
+}
+
+uint32_t clock_profile_hz(ClockProfile_t profile)
+{
+	return profile_hz[profile];
+}
+
+void sim_clock_report(void)
+{
+	printf("clock_profile_hz=%u\n", profile_hz[profile_current]);
+	printf("clock_switches=%u\n", switches);
+	printf("idle_percent=%u\n", clock_governor_idle_percent());
+}
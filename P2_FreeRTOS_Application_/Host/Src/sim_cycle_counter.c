@@ -0,0 +1,37 @@
+/*
+ * Host build: the DWT cycle counter is replaced by nanoseconds, so the cycle profilers read in ns on the host.
+ */
+#include  "cycle_counter.h"
+#include  "sim.h"
+
+static volatile uint32_t clock_epoch;
+
+void cycle_counter_init(void)
+{
+}
+
+uint32_t cycle_counter_get(void)
+{
+	return (uint32_t)sim_now_ns();
+}
+
+uint32_t cycle_counter_to_us(uint32_t cycles)
+{
+	return cycles / 1000U;
+}
+
+uint32_t cycle_counter_clock_epoch(void)
+{
+	return clock_epoch;
+}
+
+/* Nanoseconds do not change with the clock, the epoch does: the application discards the same samples as on target */
+void cycle_counter_clock_changed(void)
+{
+	clock_epoch++;
+}
+
+const char *cycle_counter_unit(void)
+{
+	return "ns";
+}
@@ -0,0 +1,69 @@
+/*
+ * Host build: simulated GPIO outputs (PA5 and the actuator pins of the sensor table).
+ * Every call is an actuation of the pipeline, its latency is measured from the last simulated end of scan.
+ */
+#include  <stdio.h>
+#include  "gpio_out.h"
+#include  "sim.h"
+
+static uint32_t actuations;
+static uint32_t edges;
+static uint64_t latency_min_ns = UINT64_MAX;
+static uint64_t latency_max_ns;
+static uint64_t latency_sum_ns;
+
+static void sim_gpio_record(GPIO_TypeDef *port, uint32_t new_odr, uint32_t pins);
+
+void GPIO_OUT_init(void)
+{
+	GPIOA->MODER &=~ (1<<11);
+	GPIOA->MODER |= (1<<10);
+}
+
+void GPIO_OUT_on(void)
+{
+	sim_gpio_record(GPIOA, GPIOA->ODR | GPIO_OUT_PIN, GPIO_OUT_PIN);
+}
+
+void GPIO_OUT_off(void)
+{
+	sim_gpio_record(GPIOA, GPIOA->ODR & ~GPIO_OUT_PIN, GPIO_OUT_PIN);
+}
+
+void GPIO_OUT_pin_init(GPIO_TypeDef *port, uint8_t pin)
+{
+	port->MODER &=~ (3U << (2 * pin));
+	port->MODER |= (1U << (2 * pin));
+}
+
+void GPIO_OUT_pin_write(GPIO_TypeDef *port, uint8_t pin, uint8_t state)
+{
+	uint32_t mask = (1U << pin);
+
+	sim_gpio_record(port, state ? (port->ODR | mask) : (port->ODR & ~mask), mask);
+}
+
+void sim_gpio_report(void)
+{
+	printf("actuations=%u\n", actuations);
+	printf("output_edges=%u\n", edges);
+	if(actuations > 0)
+	{
+		printf("latency_ns_min=%llu\n", (unsigned long long)latency_min_ns);
+		printf("latency_ns_avg=%llu\n", (unsigned long long)(latency_sum_ns / actuations));
+		printf("latency_ns_max=%llu\n", (unsigned long long)latency_max_ns);
+	}
+}
+
+static void sim_gpio_record(GPIO_TypeDef *port, uint32_t new_odr, uint32_t pins)
+{
+	uint64_t latency = sim_now_ns() - sim_adc_last_sample_ns();
+
+	if((new_odr ^ port->ODR) & pins) edges++;
+	port->ODR = new_odr;
+
+	actuations++;
+	latency_sum_ns += latency;
+	if(latency < latency_min_ns) latency_min_ns = latency;
+	if(latency > latency_max_ns) latency_max_ns = latency;
+}
@@ -0,0 +1,119 @@
+/*
+ * Host build: register instances, HAL stubs, time base and the end of the run.
+ *
+ * HAL_Init creates the end of run task (highest priority): it ends the run with vTaskEndScheduler once a benchmark
+ * is done or SIM_SAMPLES samples went through the pipeline (after the report), or with exit status 1 when
+ * nothing finished within SIM_TIMEOUT_S seconds.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include  <stdio.h>
+#include  <stdlib.h>
+#include  <time.h>
+#include  "stm32f4xx_hal.h"
+#include  "FreeRTOS.h"
+#include  "task.h"
+#include  "ipc_benchmark.h"
+#include  "filter_benchmark.h"
+#include  "latency_histogram.h"
+#include  "sensor_pipeline.h"
+#include  "cycle_counter.h"
+#include  "sim.h"
+
+#define SIM_END_POLL_MS		10
+#define SIM_TIMEOUT_S		60				// default, SIM_TIMEOUT_S in the environment
+
+ADC_TypeDef  sim_ADC1;
+GPIO_TypeDef sim_GPIOA;
+RCC_TypeDef  sim_RCC;
+
+static uint64_t start_ns;
+
+static void sim_end_task(void *parameters);
+static uint64_t sim_monotonic_ns(void);
+
+HAL_StatusTypeDef HAL_Init(void)
+{
+	start_ns = sim_monotonic_ns();
+	xTaskCreate(sim_end_task, "Sim end of run", configMINIMAL_STACK_SIZE, NULL, configMAX_PRIORITIES - 1, NULL);
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_RCC_OscConfig(RCC_OscInitTypeDef *RCC_OscInitStruct)
+{
+	(void)RCC_OscInitStruct;
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_RCC_ClockConfig(RCC_ClkInitTypeDef *RCC_ClkInitStruct, uint32_t FLatency)
+{
+	(void)RCC_ClkInitStruct;
+	(void)FLatency;
+	return HAL_OK;
+}
+
+uint64_t sim_now_ns(void)
+{
+	return sim_monotonic_ns() - start_ns;
+}
+
+/* Machine readable report, one key=value per line */
+void sim_report(void)
+{
+	uint64_t elapsed_ns = sim_now_ns();
+	uint32_t samples = sim_adc_samples();
+	uint32_t interval_min, interval_max;
+
+	printf("samples=%u\n", samples);
+	printf("elapsed_ns=%llu\n", (unsigned long long)elapsed_ns);
+	printf("throughput_samples_per_s=%.1f\n", (elapsed_ns > 0) ? (samples * 1e9 / (double)elapsed_ns) : 0.0);
+	printf("pipeline_ram_bytes=%u\n", sensor_pipeline_ram_bytes());
+	printf("process_scan_max_%s=%u\n", cycle_counter_unit(), sensor_pipeline_scan_cycles());
+	printf("process_scan_mean_%s=%u\n", cycle_counter_unit(), sensor_pipeline_scan_cycles_mean());
+	sensor_pipeline_scan_interval(&interval_min, &interval_max);
+	printf("scan_interval_min_%s=%u\n", cycle_counter_unit(), interval_min);
+	printf("scan_interval_max_%s=%u\n", cycle_counter_unit(), interval_max);
+	printf("scan_jitter_%s=%u\n", cycle_counter_unit(), interval_max - interval_min);
+	sim_gpio_report();
+	sim_clock_report();
+	latency_histogram_print();
+	fflush(stdout);
+}
+
+/* WFI: the host sleeps until the next tick or simulated interrupt */
+void vApplicationIdleHook(void)
+{
+	vPortWaitForInterrupt();
+}
+
+static void sim_end_task(void *parameters)
+{
+	const char *env = getenv("SIM_TIMEOUT_S");
+	uint64_t timeout_ns = (env != NULL ? strtoull(env, NULL, 10) : SIM_TIMEOUT_S) * 1000000000ULL;
+
+	(void)parameters;
+
+	while(!ipc_benchmark_finished() && !filter_benchmark_finished() && !sim_adc_finished())
+	{
+		if(sim_now_ns() > timeout_ns)
+		{
+			printf("timeout=%llu\n", (unsigned long long)(timeout_ns / 1000000000ULL));
+			fflush(stdout);
+			exit(1);
+		}
+		vTaskDelay(pdMS_TO_TICKS(SIM_END_POLL_MS));
+	}
+
+	if(sim_adc_finished())
+	{
+		sim_report();
+	}
+	vTaskEndScheduler();
+}
+
+static uint64_t sim_monotonic_ns(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+}
@@ -0,0 +1,268 @@
+/*
+ * Host build: FreeRTOS port on ucontext, all tasks share the one process thread.
+ *
+ * Every task runs on its own host stack (SIM_PORT_STACK bytes, the FreeRTOS stack of the task only holds a pointer
+ * to its context), so the stack high water marks of the host build do not measure the application.
+ * Interrupts are signals: the tick (SIGALRM, configTICK_RATE_HZ) and the simulated peripherals (Src/sim_*.c).
+ * Critical sections block every signal, a handler runs with every signal blocked, like one NVIC priority level.
+ * A switch requested inside a critical section waits for its end, like PendSV. A switch requested by a handler
+ * (tick or portYIELD_FROM_ISR) happens in the handler: the preempted task continues in it when it runs again.
+ * As on Cortex-M, interrupts stay disabled from the first critical section until the first task starts.
+ */
+#define _XOPEN_SOURCE 700
+#include  <signal.h>
+#include  <stdio.h>
+#include  <stdlib.h>
+#include  <time.h>
+#include  <ucontext.h>
+#include  "FreeRTOS.h"
+#include  "task.h"
+
+/* Define macros */
+#define SIM_PORT_STACK			(64 * 1024)
+#define SIM_PORT_TICK_SIGNAL	SIGALRM
+#define SIM_PORT_NESTING_BOOT	0xaaaaaaaaUL	// before the scheduler: exiting a critical section keeps them disabled
+
+typedef struct
+{
+	ucontext_t context;
+	void *stack;
+	TaskFunction_t code;
+	void *parameters;
+} SimThread_t;
+
+/* Kernel data read by the port */
+extern void * volatile pxCurrentTCB;
+
+/* Declare private functions */
+static SimThread_t *sim_port_thread(void *tcb);
+static void sim_port_thread_start(void);
+static void sim_port_switch(void);
+static void sim_port_tick(int signal_number);
+static void sim_port_block(sigset_t *previous);
+static void sim_port_unblock(void);
+
+/* Declare private variables */
+static ucontext_t launcher;
+static volatile UBaseType_t critical_nesting = SIM_PORT_NESTING_BOOT;
+static volatile BaseType_t yield_pending;
+static volatile BaseType_t scheduler_running;
+static timer_t tick_timer;
+
+
+StackType_t *pxPortInitialiseStack(StackType_t *pxTopOfStack, TaskFunction_t pxCode, void *pvParameters)
+{
+	sigset_t previous;
+	SimThread_t *thread;
+
+	sim_port_block(&previous);					// libc malloc is not reentrant, a task may be preempted
+	thread = malloc(sizeof(SimThread_t));
+	configASSERT(thread != NULL);
+	thread->stack = malloc(SIM_PORT_STACK);
+	configASSERT(thread->stack != NULL);
+	sigprocmask(SIG_SETMASK, &previous, NULL);
+
+	thread->code = pxCode;
+	thread->parameters = pvParameters;
+	getcontext(&thread->context);
+	thread->context.uc_stack.ss_sp = thread->stack;
+	thread->context.uc_stack.ss_size = SIM_PORT_STACK;
+	thread->context.uc_link = NULL;
+	sigfillset(&thread->context.uc_sigmask);	// every switch happens with signals blocked
+	makecontext(&thread->context, sim_port_thread_start, 0);
+
+	pxTopOfStack--;
+	*pxTopOfStack = (StackType_t)thread;		// pxTopOfStack never moves: the context is always found here
+	return pxTopOfStack;
+}
+
+BaseType_t xPortStartScheduler(void)
+{
+	struct sigaction action = {0};
+	struct sigevent event = {0};
+	struct itimerspec period = {0};
+
+	action.sa_handler = sim_port_tick;
+	action.sa_flags = SA_RESTART;
+	sigfillset(&action.sa_mask);
+	sigaction(SIM_PORT_TICK_SIGNAL, &action, NULL);
+
+	event.sigev_notify = SIGEV_SIGNAL;
+	event.sigev_signo = SIM_PORT_TICK_SIGNAL;
+	if(timer_create(CLOCK_MONOTONIC, &event, &tick_timer) != 0)
+	{
+		perror("sim port timer_create");
+		exit(1);
+	}
+	period.it_interval.tv_nsec = 1000000000L / configTICK_RATE_HZ;
+	period.it_value = period.it_interval;
+	timer_settime(tick_timer, 0, &period, NULL);
+
+	vPortDisableInterrupts();
+	scheduler_running = pdTRUE;
+	swapcontext(&launcher, &sim_port_thread(pxCurrentTCB)->context);
+
+	return pdFALSE;								// vPortEndScheduler
+}
+
+/* main() would spin in its infinite loop after vTaskStartScheduler, the run ends here */
+void vPortEndScheduler(void)
+{
+	vPortDisableInterrupts();
+	scheduler_running = pdFALSE;
+	fflush(stdout);
+	exit(0);
+}
+
+void vPortYield(void)
+{
+	sigset_t previous;
+
+	if(!scheduler_running)
+	{
+		return;
+	}
+	if(critical_nesting > 0)
+	{
+		yield_pending = pdTRUE;					// PendSV waits for the end of the critical section
+		return;
+	}
+
+	sim_port_block(&previous);
+	sim_port_switch();
+	sigprocmask(SIG_SETMASK, &previous, NULL);
+}
+
+/* In a signal handler, every signal is blocked */
+void vPortYieldFromISR(void)
+{
+	if(scheduler_running)
+	{
+		sim_port_switch();
+	}
+}
+
+void vPortEnterCritical(void)
+{
+	vPortDisableInterrupts();
+	critical_nesting++;
+}
+
+void vPortExitCritical(void)
+{
+	critical_nesting--;
+	if(critical_nesting == 0)
+	{
+		if(yield_pending)
+		{
+			yield_pending = pdFALSE;
+			sim_port_switch();					// still blocked from the critical section
+		}
+		vPortEnableInterrupts();
+	}
+}
+
+void vPortDisableInterrupts(void)
+{
+	sim_port_block(NULL);
+}
+
+void vPortEnableInterrupts(void)
+{
+	sim_port_unblock();
+}
+
+/* Returns 1 if interrupts were disabled already */
+UBaseType_t xPortSetInterruptMask(void)
+{
+	sigset_t previous;
+
+	sim_port_block(&previous);
+	return sigismember(&previous, SIM_PORT_TICK_SIGNAL) == 1;
+}
+
+void vPortClearInterruptMask(UBaseType_t uxMask)
+{
+	if(!uxMask)
+	{
+		sim_port_unblock();
+	}
+}
+
+/* portCLEAN_UP_TCB: the task does not run anymore (deleted by another task, or by the idle task afterwards) */
+void vPortDeleteThread(void *pxTCB)
+{
+	SimThread_t *thread = sim_port_thread(pxTCB);
+	sigset_t previous;
+
+	sim_port_block(&previous);
+	free(thread->stack);
+	free(thread);
+	sigprocmask(SIG_SETMASK, &previous, NULL);
+}
+
+/* WFI: sleep until the next signal, from a task (the idle hook) */
+void vPortWaitForInterrupt(void)
+{
+	sigset_t previous;
+
+	sim_port_block(&previous);
+	sigsuspend(&previous);						// unblocks and sleeps atomically, no signal is missed
+	sigprocmask(SIG_SETMASK, &previous, NULL);
+}
+
+/*** switching, signals blocked */
+
+static void sim_port_switch(void)
+{
+	void *previous = pxCurrentTCB;
+
+	vTaskSwitchContext();
+	if(pxCurrentTCB != previous)
+	{
+		swapcontext(&sim_port_thread(previous)->context, &sim_port_thread(pxCurrentTCB)->context);
+	}
+}
+
+static void sim_port_tick(int signal_number)
+{
+	(void)signal_number;
+
+	if(scheduler_running && xTaskIncrementTick() != pdFALSE)
+	{
+		sim_port_switch();
+	}
+}
+
+static SimThread_t *sim_port_thread(void *tcb)
+{
+	StackType_t *top = *(StackType_t **)tcb;	// pxTopOfStack, the first member of the TCB
+
+	return (SimThread_t *)*top;
+}
+
+static void sim_port_thread_start(void)
+{
+	SimThread_t *thread = sim_port_thread(pxCurrentTCB);
+
+	critical_nesting = 0;
+	vPortEnableInterrupts();
+	thread->code(thread->parameters);
+	vTaskDelete(NULL);							// a FreeRTOS task must not return
+}
+
+static void sim_port_block(sigset_t *previous)
+{
+	sigset_t all;
+
+	sigfillset(&all);
+	sigprocmask(SIG_BLOCK, &all, previous);
+}
+
+static void sim_port_unblock(void)
+{
+	sigset_t all;
+
+	sigfillset(&all);
+	sigprocmask(SIG_UNBLOCK, &all, NULL);
+}
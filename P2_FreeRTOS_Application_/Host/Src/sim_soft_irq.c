@@ -0,0 +1,41 @@
+/*
+ * Host build: software interrupt on a real-time signal.
+ * raise() delivers the signal to the calling task thread before it returns, like a pended NVIC interrupt.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include  <signal.h>
+#include  <stddef.h>
+#include  "soft_irq.h"
+
+#define SIM_SOFT_IRQ_SIGNAL		(SIGRTMIN + 1)
+
+static void (*soft_irq_handler)(void);
+
+static void sim_soft_irq_signal_handler(int signal_number);
+
+void soft_irq_init(void (*handler)(void))
+{
+	struct sigaction action = {0};
+
+	soft_irq_handler = handler;
+
+	action.sa_handler = sim_soft_irq_signal_handler;
+	action.sa_flags = SA_RESTART;
+	sigfillset(&action.sa_mask);
+	sigaction(SIM_SOFT_IRQ_SIGNAL, &action, NULL);
+}
+
+void soft_irq_trigger(void)
+{
+	raise(SIM_SOFT_IRQ_SIGNAL);
+}
+
+static void sim_soft_irq_signal_handler(int signal_number)
+{
+	(void)signal_number;
+
+	if(soft_irq_handler != NULL)
+	{
+		soft_irq_handler();
+	}
+}
@@ -0,0 +1,139 @@
+/*
+ * Host build: USART2 is the process standard output, and its receiver reads the file or pty named by SIM_UART_RX.
+ *
+ * A POSIX interval timer raises SIM_UART_SIGNAL every millisecond and plays the DMA: it copies at most the bytes
+ * 115200 baud carries in 1 ms into the circular buffer, stopping after a newline. The first tick without new bytes
+ * plays the idle line and calls the application's USART2_IRQHandler. The tick after a newline reads nothing, so
+ * every line of a file is one frame. With a pty (e.g. one end of `socat -d -d pty,raw,echo=0 pty,raw,echo=0`)
+ * frames are whatever the writer sends, cut after each newline.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include  <fcntl.h>
+#include  <signal.h>
+#include  <stdio.h>
+#include  <stdlib.h>
+#include  <time.h>
+#include  <unistd.h>
+#include  "uart.h"
+
+#define SIM_UART_SIGNAL			(SIGRTMIN + 2)
+#define SIM_UART_TICK_US		1000
+#define SIM_UART_BYTES_PER_TICK	11				// 115200 baud, 10 bits per byte
+
+extern void USART2_IRQHandler(void);
+
+static int rx_fd = -1;
+static volatile uint8_t *rx_buffer;
+static uint32_t rx_size;
+static uint32_t rx_head;						// like size - NDTR
+static volatile uint32_t rx_passes;				// like HTIF and TCIF
+static volatile uint8_t rx_idle;
+static uint8_t rx_active;						// bytes received since the last idle line
+static uint8_t rx_line_end;						// the frame ended with a newline, the next tick is the idle line
+
+static void sim_uart_signal_handler(int signal_number);
+
+void USART2_UART_TX_Init(void)
+{
+}
+
+void USART2_UART_RX_Init(void)
+{
+}
+
+void USART2_UART_RX_DMA_Init(volatile uint8_t *buffer, uint16_t size)
+{
+	struct sigaction action = {0};
+	struct sigevent event = {0};
+	struct itimerspec period = {0};
+	timer_t timer;
+	const char *path = getenv("SIM_UART_RX");
+
+	rx_buffer = buffer;
+	rx_size = size;
+	rx_head = 0;
+
+	if(path == NULL)
+	{
+		return;									// nothing connected to RX
+	}
+
+	rx_fd = open(path, O_RDONLY | O_NONBLOCK);
+	if(rx_fd < 0)
+	{
+		perror(path);
+		exit(1);
+	}
+
+	action.sa_handler = sim_uart_signal_handler;
+	action.sa_flags = SA_RESTART;
+	sigfillset(&action.sa_mask);
+	sigaction(SIM_UART_SIGNAL, &action, NULL);
+
+	event.sigev_notify = SIGEV_SIGNAL;
+	event.sigev_signo = SIM_UART_SIGNAL;
+	if(timer_create(CLOCK_MONOTONIC, &event, &timer) != 0)
+	{
+		perror("sim uart timer_create");
+		exit(1);
+	}
+
+	period.it_interval.tv_nsec = SIM_UART_TICK_US * 1000;
+	period.it_value = period.it_interval;
+	timer_settime(timer, 0, &period, NULL);
+}
+
+uint32_t uart2_rx_idle_status(uint32_t *passes)
+{
+	if(!rx_idle)
+	{
+		return UART_RX_NOT_IDLE;
+	}
+
+	rx_idle = 0;
+	*passes = rx_passes;
+	rx_passes = 0;
+	return rx_head;
+}
+
+int uart2_write(int ch)
+{
+	putchar(ch);
+	return ch;
+}
+
+int __io_putchar(int ch)
+{
+	uart2_write(ch);
+	return ch;
+}
+
+static void sim_uart_signal_handler(int signal_number)
+{
+	uint8_t byte;
+	uint32_t count = 0;
+
+	(void)signal_number;
+
+	while(!rx_line_end && (count < SIM_UART_BYTES_PER_TICK) && (read(rx_fd, &byte, 1) == 1))
+	{
+		rx_buffer[rx_head] = byte;
+		rx_head = (rx_head + 1) % rx_size;
+		if(rx_head == rx_size / 2) rx_passes |= UART_RX_PASS_HALF;
+		if(rx_head == 0) rx_passes |= UART_RX_PASS_END;
+		count++;
+		if(byte == '\n') rx_line_end = 1;
+	}
+
+	if(count > 0)
+	{
+		rx_active = 1;
+	}
+	else if(rx_active)
+	{
+		rx_active = 0;
+		rx_line_end = 0;
+		rx_idle = 1;
+		USART2_IRQHandler();
+	}
+}
@@ -0,0 +1,291 @@
+#!/usr/bin/env python3
+"""
+Flash and RAM of a firmware image per module, from the GNU ld map file (P1 and P2).
+
+*** Purpose:
+Show where the 512 KB flash and 96 KB SRAM of the STM32F401 go (kernel, HAL, app, newlib), follow it between
+builds (e.g. while the sensor count grows) and fail a build that exceeds its budget.
+
+*** How it works
+1. The map file lists every input section with its size and object file: the object decides the module
+   (FreeRTOS or P1 os*.o -> kernel, HAL/CMSIS/Cube drivers -> hal, lib*.a and syscalls -> newlib, startup, else app).
+2. Output sections are placed by their address in the Memory Configuration regions. A section with a load address
+   in another region (.data, .ramfunc) counts in both: its initial values take flash, the section takes RAM.
+   Uninitialized sections (.bss, heap and stack reserves) only take RAM: known by name, or by type with --elf.
+3. Whatever an output section holds beyond its input sections (heap and stack reserves, alignment) is "linker".
+4. With --elf the largest symbols are read from the symbol table (readelf -sW), for builds without -fdata-sections.
+
+*** Usage
+  python3 memory_budget.py report ../Debug/P2_FreeRTOS_Application_.map --top 10
+  python3 memory_budget.py report p2.map --budget ram=80K --budget flash.app=32K
+  python3 memory_budget.py diff old.map new.map --budget ram=80K
+
+*** Output
+module,flash_bytes,ram_bytes                  one line per module, then total
+region,<name>,<used>,<size>,<percent>
+top,<flash|ram>,<bytes>,<module>,<section>,<object>
+diff: module,flash_old,flash_new,flash_delta,ram_old,ram_new,ram_delta
+budget,<key>,<used>,<limit>,<ok|EXCEEDED>     exit status 1 if any budget is exceeded
+Budget keys: flash, ram, flash.<module>, ram.<module>; limits in bytes, with K or M suffix.
+"""
+
+import argparse
+import re
+import subprocess
+import sys
+
+MODULES = ("app", "kernel", "hal", "newlib", "startup", "linker")
+
+MODULE_RULES = (
+    (re.compile(r"FreeRTOS|(^|/)os[A-Z]\w*\.o\b"), "kernel"),     # P1: osKernel.o, osMutex.o, osQueue.o...
+    (re.compile(r"startup_"), "startup"),
+    (re.compile(r"STM32F4xx_HAL_Driver|CMSIS|stm32f4xx_|system_stm32f4xx"), "hal"),
+    (re.compile(r"lib[^/]*\.a\(|syscalls\.o|sysmem\.o"), "newlib"),
+)
+
+OUTPUT_SECTION = re.compile(r"^(\.\S+|COMMON)\s+0x([0-9a-f]+)\s+0x([0-9a-f]+)(?:\s+load address 0x([0-9a-f]+))?")
+OUTPUT_NAME = re.compile(r"^(\.\S+)\s*$")
+OUTPUT_ADDRESS = re.compile(r"^\s+0x([0-9a-f]+)\s+0x([0-9a-f]+)(?:\s+load address 0x([0-9a-f]+))?\s*$")
+INPUT_SECTION = re.compile(r"^ (\S+)\s+0x([0-9a-f]+)\s+0x([0-9a-f]+)\s*(\S.*)?$")
+INPUT_NAME = re.compile(r"^ (\S+)\s*$")
+INPUT_ADDRESS = re.compile(r"^\s{2,}0x([0-9a-f]+)\s+0x([0-9a-f]+)\s+(\S.*)$")
+REGION = re.compile(r"^(\S+)\s+0x([0-9a-f]+)\s+0x([0-9a-f]+)")
+NOBITS = re.compile(r"^\.(bss|sbss|noinit|ram_vector|_user_heap_stack)\b")
+
+
+def module_of(obj, rules):
+    for pattern, module in rules:
+        if pattern.search(obj):
+            return module
+    return "app"
+
+
+class Image:
+    def __init__(self, path, rules, nobits=None):
+        self.regions = {}                    # name -> (origin, length)
+        self.usage = {}                      # (kind, module) -> bytes
+        self.items = []                      # (kind, bytes, module, section, object)
+        self.nobits = nobits                 # output sections without content, from the ELF if given
+        self.parse(path, rules)
+
+    def region_of(self, address):
+        for name, (origin, length) in self.regions.items():
+            if origin <= address < origin + length:
+                return name
+        return None
+
+    def kinds(self, name, vma, lma):
+        """flash and/or ram, for the output section name at vma loaded from lma."""
+        nobits = (name in self.nobits) if self.nobits is not None else bool(NOBITS.match(name))
+        kinds = set()
+        for address in (vma, lma if (lma is not None and not nobits) else vma):
+            region = self.region_of(address)
+            if region is not None:
+                kinds.add("flash" if "FLASH" in region.upper() or "ROM" in region.upper() else "ram")
+        return kinds
+
+    def add(self, kinds, size, module, section, obj):
+        for kind in kinds:
+            self.usage[(kind, module)] = self.usage.get((kind, module), 0) + size
+            if module != "linker":
+                self.items.append((kind, size, module, section, obj))
+
+    def parse(self, path, rules):
+        with open(path) as f:
+            lines = f.read().splitlines()
+
+        i = 0
+        while i < len(lines) and not lines[i].startswith("Memory Configuration"):
+            i += 1
+        while i < len(lines) and not lines[i].startswith("Linker script and memory map"):
+            region = REGION.match(lines[i])
+            if region and region.group(1) not in ("Name", "*default*"):
+                self.regions[region.group(1)] = (int(region.group(2), 16), int(region.group(3), 16))
+            i += 1
+        if not self.regions:
+            sys.exit(path + ": no Memory Configuration, not a GNU ld map file")
+
+        kinds, remaining = set(), 0
+        pending_input = None
+        pending_output = None
+
+        def close():
+            if kinds and remaining > 0:
+                self.add(kinds, remaining, "linker", "", "")
+
+        for line in lines[i + 1:]:
+            if pending_output is not None:
+                address = OUTPUT_ADDRESS.match(line)
+                name = pending_output
+                pending_output = None
+                if address:
+                    close()
+                    vma, size = int(address.group(1), 16), int(address.group(2), 16)
+                    lma = int(address.group(3), 16) if address.group(3) else None
+                    kinds, remaining = self.kinds(name, vma, lma), size
+                    continue
+            if pending_input is not None:
+                address = INPUT_ADDRESS.match(line)
+                section = pending_input
+                pending_input = None
+                if address:
+                    size = int(address.group(2), 16)
+                    obj = address.group(3).strip()
+                    if kinds and size:
+                        self.add(kinds, size, module_of(obj, rules), section, obj)
+                        remaining -= size
+                    continue
+
+            output = OUTPUT_SECTION.match(line)
+            if output and not line.startswith(" "):
+                close()
+                vma, size = int(output.group(2), 16), int(output.group(3), 16)
+                lma = int(output.group(4), 16) if output.group(4) else None
+                kinds, remaining = self.kinds(output.group(1), vma, lma), size
+                continue
+            if OUTPUT_NAME.match(line):
+                pending_output = line.strip()
+                continue
+
+            if line.startswith(" *fill*"):
+                continue                     # counted as linker with the rest of the output section
+            entry = INPUT_SECTION.match(line)
+            if entry and entry.group(4) and not entry.group(1).startswith("*"):
+                size = int(entry.group(3), 16)
+                if kinds and size:
+                    obj = entry.group(4).strip()
+                    self.add(kinds, size, module_of(obj, rules), entry.group(1), obj)
+                    remaining -= size
+                continue
+            name = INPUT_NAME.match(line)
+            if name and not name.group(1).startswith("*"):
+                pending_input = name.group(1)
+        close()
+
+    def used(self, kind, module=None):
+        if module is not None:
+            return self.usage.get((kind, module), 0)
+        return sum(size for (k, _), size in self.usage.items() if k == kind)
+
+    def region_size(self, kind):
+        return sum(length for name, (_, length) in self.regions.items()
+                   if ("flash" if "FLASH" in name.upper() or "ROM" in name.upper() else "ram") == kind)
+
+
+def elf_sections(readelf, path):
+    """section index -> (name, type) from the ELF section headers."""
+    sections = {}
+    for line in subprocess.run([readelf, "-SW", path], capture_output=True, text=True, check=True).stdout.splitlines():
+        section = re.match(r"^\s*\[\s*(\d+)\]\s+(\S+)\s+(\S+)\s+([0-9a-f]+)", line)
+        if section:
+            sections[section.group(1)] = (section.group(2), section.group(3))
+    return sections
+
+
+def elf_symbols(readelf, path, sections):
+    """(kind, size, name, section) of the sized objects and functions in the ELF symbol table."""
+    symbols = []
+    for line in subprocess.run([readelf, "-sW", path], capture_output=True, text=True, check=True).stdout.splitlines():
+        fields = line.split()
+        if len(fields) < 8 or fields[3] not in ("FUNC", "OBJECT") or fields[6] not in sections:
+            continue
+        size = int(fields[2], 0)
+        name, kind = sections[fields[6]]
+        if size:
+            symbols.append(("ram" if kind == "NOBITS" or name.startswith(".data") else "flash", size, fields[7], name))
+    return symbols
+
+
+def parse_size(text):
+    scale = {"K": 1024, "M": 1024 * 1024}.get(text[-1].upper(), 1)
+    return int(text[:-1] if scale != 1 else text, 0) * scale
+
+
+def check_budgets(image, budgets):
+    failed = False
+    for key, limit in budgets:
+        kind, _, module = key.partition(".")
+        used = image.used(kind, module or None)
+        ok = used <= limit
+        failed |= not ok
+        print("budget,%s,%d,%d,%s" % (key, used, limit, "ok" if ok else "EXCEEDED"))
+    return failed
+
+
+def report(image, top, symbols):
+    print("module,flash_bytes,ram_bytes")
+    for module in MODULES:
+        print("%s,%d,%d" % (module, image.used("flash", module), image.used("ram", module)))
+    print("total,%d,%d" % (image.used("flash"), image.used("ram")))
+    for kind in ("flash", "ram"):
+        size = image.region_size(kind)
+        used = image.used(kind)
+        print("region,%s,%d,%d,%.1f" % (kind, used, size, 100.0 * used / size if size else 0.0))
+    for kind in ("flash", "ram"):
+        items = sorted((item for item in image.items if item[0] == kind), key=lambda item: -item[1])
+        for item in items[:top]:
+            print("top,%s,%d,%s,%s,%s" % item)
+    for kind, size, name, section in sorted(symbols, key=lambda symbol: -symbol[1])[:top]:
+        print("symbol,%s,%d,%s,%s" % (kind, size, name, section))
+
+
+def diff(old, new):
+    print("module,flash_old,flash_new,flash_delta,ram_old,ram_new,ram_delta")
+    for module in MODULES + (None,):
+        values = []
+        for kind in ("flash", "ram"):
+            a, b = old.used(kind, module), new.used(kind, module)
+            values += [a, b, b - a]
+        print("%s,%d,%d,%+d,%d,%d,%+d" % tuple([module or "total"] + values))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("command", choices=("report", "diff"))
+    parser.add_argument("maps", nargs="+", help="map file (report) or old and new map files (diff)")
+    parser.add_argument("--elf", help="ELF of the report, for the largest symbols")
+    parser.add_argument("--readelf", default="arm-none-eabi-readelf")
+    parser.add_argument("--top", type=int, default=5, help="largest input sections per memory")
+    parser.add_argument("--module", action="append", default=[], metavar="REGEX=MODULE",
+                        help="extra rule checked before the defaults, e.g. 'sensor_=app'")
+    parser.add_argument("--budget", action="append", default=[], metavar="KEY=BYTES")
+    args = parser.parse_args()
+
+    rules = []
+    for item in args.module:
+        pattern, module = item.rsplit("=", 1)
+        if module not in MODULES:
+            parser.error("module must be one of " + ", ".join(MODULES))
+        rules.append((re.compile(pattern), module))
+    rules += list(MODULE_RULES)
+
+    budgets = []
+    for item in args.budget:
+        key, limit = item.split("=")
+        if key.partition(".")[0] not in ("flash", "ram"):
+            parser.error("budget key must start with flash or ram: " + key)
+        budgets.append((key, parse_size(limit)))
+
+    if args.command == "report":
+        if len(args.maps) != 1:
+            parser.error("report takes one map file")
+        if args.elf:
+            sections = elf_sections(args.readelf, args.elf)
+            nobits = {name for name, kind in sections.values() if kind == "NOBITS"}
+            image = Image(args.maps[0], rules, nobits)
+            report(image, args.top, elf_symbols(args.readelf, args.elf, sections))
+        else:
+            image = Image(args.maps[0], rules)
+            report(image, args.top, [])
+    else:
+        if len(args.maps) != 2:
+            parser.error("diff takes the old and the new map file")
+        image = Image(args.maps[1], rules)
+        diff(Image(args.maps[0], rules), image)
+
+    if check_budgets(image, budgets):
+        sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
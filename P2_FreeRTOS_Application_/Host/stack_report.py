@@ -0,0 +1,174 @@
+#!/usr/bin/env python3
+"""
+Static worst-case stack of every task and interrupt handler.
+
+*** Purpose:
+Complements memory_profile.c: the high water mark only covers the paths that ran, this walks every path the
+compiler can see.
+
+*** How it works
+1. Frame sizes come from the .su files of -fstack-usage, complexity from the .cyclo files of -fcyclomatic-complexity
+   (both written next to the objects by the STM32CubeIDE Debug build).
+2. The .su/.cyclo files have no call graph: it is read from the relocations of the objects (readelf -rW), which
+   needs -ffunction-sections so every function has its own .rel.text.<name> section.
+3. Every entry point is walked, the deepest path is reported. Calls resolved in the same object first, otherwise
+   by name; functions without a .su entry (library, assembly) count 0 unless given with --extra.
+
+*** Usage
+  python3 stack_report.py --debug ../Debug
+  python3 stack_report.py --debug ../../P1_RTOS_Kernel_/Debug --entry main --extra printf=96
+
+*** Output
+entry,stack_bytes,stack_words,max_cyclomatic,flags,path
+flags: D dynamic frame, R recursion (cut), U unresolved callee (counted 0)
+"""
+
+import argparse
+import os
+import re
+import subprocess
+import sys
+
+DEFAULT_ENTRY = re.compile(r"^(main|vTask\w+|task\w+|\w+_Handler|\w+_IRQHandler)$")
+# readelf -rW: offset, info, type, symbol value, symbol name, then " + 4" / " - 4" on RELA lines
+RELOCATION = re.compile(r"^\s*[0-9a-f]+\s+[0-9a-f]+\s+(\S+)\s+[0-9a-f]+\s+(\S+)(?:\s+[+-]\s*[0-9a-f]+)?\s*$")
+CALL_TYPES = ("CALL", "JUMP24", "PLT32")
+
+
+def read_su(path):
+    """name -> (bytes, dynamic) from a .su file."""
+    frames = {}
+    with open(path) as f:
+        for line in f:
+            fields = line.rstrip("\n").split("\t")
+            if len(fields) < 3:
+                continue
+            name = fields[0].rsplit(":", 1)[-1]
+            frames[name] = (int(fields[1]), "dynamic" in fields[2])
+    return frames
+
+
+def read_cyclo(path):
+    """name -> cyclomatic complexity from a .cyclo file."""
+    cyclo = {}
+    with open(path) as f:
+        for line in f:
+            fields = line.rstrip("\n").split("\t")
+            if len(fields) == 2:
+                cyclo[fields[0].rsplit(":", 1)[-1]] = int(fields[1])
+    return cyclo
+
+
+def read_calls(readelf, path):
+    """caller -> set of callees from the relocations of an object built with -ffunction-sections."""
+    output = subprocess.run([readelf, "-rW", path], capture_output=True, text=True, check=True).stdout
+    calls = {}
+    caller = None
+    for line in output.splitlines():
+        section = re.match(r"Relocation section '\.rela?\.text\.(\S+)'", line)
+        if section:
+            caller = section.group(1)
+            calls.setdefault(caller, set())
+            continue
+        if line.startswith("Relocation section"):
+            caller = None
+            continue
+        relocation = RELOCATION.match(line) if caller else None
+        if relocation and any(kind in relocation.group(1) for kind in CALL_TYPES):
+            calls[caller].add(relocation.group(2).split("@")[0])
+    return calls
+
+
+class Program:
+    def __init__(self, debug, readelf, extra):
+        self.frames = {}        # (object, name) -> (bytes, dynamic)
+        self.cyclo = {}         # (object, name) -> complexity
+        self.calls = {}         # (object, name) -> callees
+        self.by_name = {}       # name -> [objects]
+        self.extra = extra
+        for root, _, files in os.walk(debug):
+            for file in sorted(files):
+                if not file.endswith(".su"):
+                    continue
+                stem = os.path.join(root, file[:-3])
+                for name, frame in read_su(stem + ".su").items():
+                    self.frames[(stem, name)] = frame
+                    self.by_name.setdefault(name, []).append(stem)
+                if os.path.exists(stem + ".cyclo"):
+                    for name, value in read_cyclo(stem + ".cyclo").items():
+                        self.cyclo[(stem, name)] = value
+                if os.path.exists(stem + ".o"):
+                    for name, callees in read_calls(readelf, stem + ".o").items():
+                        self.calls[(stem, name)] = callees
+
+    def resolve(self, obj, name):
+        if (obj, name) in self.frames:
+            return (obj, name)
+        objects = self.by_name.get(name, [])
+        if not objects:
+            return None
+        return max(((o, name) for o in objects), key=lambda key: self.frames[key][0])   # ambiguous: largest frame
+
+    def worst(self, key, stack, memo):
+        """(bytes, max cyclomatic, flags, path) of the deepest path from key."""
+        if key in memo:
+            return memo[key]
+        frame, dynamic = self.frames[key]
+        flags = {"D"} if dynamic else set()
+        best = (0, 0, set(), [])
+        for callee in sorted(self.calls.get(key, ())):
+            target = self.resolve(key[0], callee)
+            if target is None:
+                extra = self.extra.get(callee)
+                result = (extra or 0, 0, set() if extra is not None else {"U"}, [callee])
+            elif target in stack:
+                result = (0, 0, {"R"}, [callee + "(recursion)"])
+            else:
+                result = self.worst(target, stack | {target}, memo)
+            flags |= result[2]
+            if result[0] > best[0] or not best[3]:
+                best = result
+        result = (frame + best[0], max(self.cyclo.get(key, 0), best[1]), flags, [key[1]] + best[3])
+        if "R" not in flags:
+            memo[key] = result                      # a cut recursion depends on the path that led here
+        return result
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--debug", required=True, help="build directory with .su, .cyclo and .o files")
+    parser.add_argument("--readelf", default="arm-none-eabi-readelf")
+    parser.add_argument("--entry", action="append", help="entry point (default: main, tasks and handlers)")
+    parser.add_argument("--extra", action="append", default=[], metavar="NAME=BYTES",
+                        help="stack of a function without a .su entry, e.g. printf=96")
+    parser.add_argument("--context-bytes", type=int, default=68,
+                        help="exception frame and saved registers added per entry (Cortex-M4 without FPU context)")
+    args = parser.parse_args()
+
+    extra = {}
+    for item in args.extra:
+        name, value = item.split("=")
+        extra[name] = int(value)
+
+    program = Program(args.debug, args.readelf, extra)
+    if not program.frames:
+        sys.exit("no .su files in " + args.debug)
+
+    if args.entry:
+        entries = args.entry
+    else:
+        entries = sorted({name for (_, name) in program.frames if DEFAULT_ENTRY.match(name)})
+
+    print("entry,stack_bytes,stack_words,max_cyclomatic,flags,path")
+    for entry in entries:
+        key = program.resolve(None, entry)
+        if key is None:
+            print("%s,,,,U," % entry)
+            continue
+        total, cyclo, flags, path = program.worst(key, {key}, {})
+        total += args.context_bytes
+        print("%s,%d,%d,%d,%s,%s" % (entry, total, (total + 3) // 4, cyclo, "".join(sorted(flags)), " > ".join(path)))
+
+
+if __name__ == "__main__":
+    main()